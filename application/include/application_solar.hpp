@@ -6,6 +6,38 @@
 #include "application.hpp"
 #include "model.hpp"
 #include "structs.hpp"
+#include "texture_array_builder.hpp"
+#include "render_queue.hpp"
+#include "frustum_culling.hpp"
+#include "sphere_lod.hpp"
+#include "star_field.hpp"
+#include "post_chain.hpp"
+
+// per instance data of a planet, read by all variants of simple.vert from a buffer texture
+struct planet_instance {
+    glm::fmat4 model_matrix;
+    glm::fmat4 normal_matrix;
+    // x: material index, y: ambient intensity, z: texture layer, w: normal map layer
+    glm::fvec4 parameters;
+};
+static_assert(sizeof(planet_instance) == 9 * sizeof(glm::fvec4), "planet_instance must be a whole number of texels");
+
+// shared by all planets with the same name
+struct planet_material {
+    texture_layer texture;
+    texture_layer normal_texture;
+    float ambient_intensity;
+    // index of the pair of texture arrays holding the textures
+    unsigned texture_set;
+};
+
+// consecutive instances whose textures lie in the same arrays and which use the same sphere level
+struct planet_batch {
+    unsigned texture_set;
+    unsigned level;
+    GLint first;
+    GLsizei count;
+};
 
 // gpu representation of model
 class ApplicationSolar : public Application {
@@ -28,6 +60,9 @@ public:
     // draw all objects
     void render() const;
 
+    // animate planets, propagate world transforms and fill the instance data
+    void updatePlanets() const;
+
     void renderPlanets() const;
 
     void renderStars() const;
@@ -55,20 +90,85 @@ protected:
 
     void initializeScreenquad();
 
-    // create the framebuffer 
-    bool initializeFramebuffer(unsigned width, unsigned height);
+    // create the uniform buffer shared by all programs
+    void initializeFrameData();
 
     // update uniform values
     void uploadUniforms();
 
-    // upload projection matrix
-    void uploadProjection();
-
-    // upload view matrix
-    void uploadView();
-
-    // scenegraph
-    SceneGraph solar_system_;
+    // compile the post processing programs, on failure the previous ones stay in use
+    void reloadPrograms(bool throwing);
+
+    // enable or disable a post processing effect, it stays disabled if its programs do not compile
+    void togglePostEffect(post_chain::effect effect);
+
+    // write camera, light and time into the shared uniform buffer, once per frame
+    void uploadFrameData() const;
+
+    // scenegraph, animated every frame
+    mutable SceneGraph solar_system_;
+    // draws of the current frame, sorted by state before they are issued
+    mutable render_queue render_queue_;
+    // orbit polylines packed into orbit_object, drawn with one glMultiDrawArrays call
+    std::vector<GLint> orbit_firsts_;
+    std::vector<GLsizei> orbit_counts_;
+    // node whose world transform places each orbit
+    std::vector<NodeHandle> orbit_frames_;
+    // sphere around each orbit in the space of its frame
+    std::vector<glm::fvec4> orbit_bounds_;
+    // ranges of the orbits inside the view frustum
+    mutable std::vector<GLint> visible_orbit_firsts_;
+    mutable std::vector<GLsizei> visible_orbit_counts_;
+    // model matrix per orbit, read by the orbit shader from a buffer texture
+    mutable std::vector<glm::fmat4> orbit_matrices_;
+    GLuint orbit_matrix_BO_ = 0;
+    texture_object orbit_matrix_texture_;
+
+    // binding point of the FrameData block in all programs
+    static const GLuint frame_data_binding = 0;
+    GLuint frame_data_BO_ = 0;
+
+    // per frame model and normal matrices in render list order, computed in one batch
+    mutable std::vector<glm::fmat4> model_matrices_;
+    mutable std::vector<glm::fmat4> normal_matrices_;
+
+    // planet materials by name, colors are uploaded as one uniform array
+    std::vector<planet_material> planet_materials_;
+    // textures and normal maps of all planets, usually one array each
+    std::vector<texture_object> planet_texture_arrays_;
+    std::vector<texture_object> planet_normal_arrays_;
+    // distinct pairs of texture and normal map array used by the materials
+    std::vector<std::pair<unsigned, unsigned>> planet_texture_sets_;
+    std::vector<glm::fvec3> material_colors_;
+    std::map<std::string, unsigned> material_indices_;
+    // size of MaterialColors in the planet shaders
+    static const std::size_t max_materials = 64;
+    // material per render list entry, rebuilt when the graph structure changes
+    mutable std::vector<unsigned> render_materials_;
+    mutable std::size_t render_materials_version_ = TransformStore::npos;
+    // instances sorted by material, drawn with one glDrawElementsInstanced per batch
+    mutable std::vector<planet_instance> planet_instances_;
+    mutable std::vector<planet_batch> planet_batches_;
+    GLuint planet_instance_BO_ = 0;
+    texture_object planet_instance_texture_;
+
+    // sphere around the planet model, the bounds of every planet node
+    glm::fvec4 planet_bounds_;
+    // the planet vertices are packed, positions are planet_position_offset_ + planet_position_scale_ * position
+    glm::fvec3 planet_position_scale_;
+    glm::fvec3 planet_position_offset_;
+    // index ranges of the sphere levels in planet_object, coarsest first
+    std::vector<sphere_lod::level> planet_levels_;
+    static const unsigned planet_level_count = 7;
+    // level per render list entry, kept between frames for the hysteresis
+    mutable std::vector<unsigned> render_levels_;
+    // planes of projection * view of the current frame
+    mutable frustum_culling::frustum view_frustum_;
+
+    // stars sorted into chunks, only the visible chunks are drawn
+    star_field star_field_;
+    mutable std::vector<GLint> star_firsts_;
+    mutable std::vector<GLsizei> star_counts_;
 
     // cpu representation of model
     model_object planet_object;
@@ -78,8 +178,8 @@ protected:
 
     model_object screenquad_object;
 
-    // create the framebuffer object with InitializeFramebuffer()
-    framebuffer_object framebuffer_object;
+    // post processing between the scene and the screen, the scene is drawn into its target
+    mutable post_chain post_chain_;
 
     // camera transform matrix
     glm::fmat4 m_view_transform;
@@ -90,20 +190,18 @@ protected:
 
     std::map<std::string, Color> color_map;
 
-    std::map<std::string, texture_object> texture_map;
-
     // need vector to hold pixel-data of skybox-tex
     std::vector<pixel_data> skybox_contain_pixdata_;
     // add skybox texture_object
     texture_object skybox_texture_obj_;
 
 private:
-    bool horizontal_mirroring = false;
-    bool vertical_mirroring = false;
-    bool greyscale = false;
-    bool blur = false;
-    unsigned img_width;
-    unsigned img_height;
+    post_chain::effect horizontal_mirroring_;
+    post_chain::effect vertical_mirroring_;
+    post_chain::effect greyscale_;
+    post_chain::effect blur_;
+    unsigned img_width = initial_resolution.x;
+    unsigned img_height = initial_resolution.y;
     bool time = true;
 };
 
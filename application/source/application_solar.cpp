@@ -4,6 +4,7 @@
 #include "utils.hpp"
 #include "shader_loader.hpp"
 #include "model_loader.hpp"
+#include "matrix_kernels.hpp"
 
 #include <glbinding/gl/gl.h>
 // use gl definitions from glbinding 
@@ -18,8 +19,11 @@ using namespace gl;
 #include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
 #include <memory>
+#include <thread>
 #include <Node.hpp>
 #include <SceneGraph.hpp>
 #include <GeometryNode.hpp>
@@ -27,13 +31,35 @@ using namespace gl;
 #include <PointLightNode.hpp>
 #include <pixel_data.hpp>
 #include <texture_loader.hpp>
+#include <texture_array_builder.hpp>
+#include <render_queue.hpp>
+#include <star_field.hpp>
+#include <vertex_quantization.hpp>
+
+// passes in the order they are drawn
+static const unsigned SKYBOX_PASS = 0;
+static const unsigned OPAQUE_PASS = 1;
+
+// per batch offset into the planet instances, data points to the uniform table of the program
+static void set_first_instance(draw_command const &command) {
+    uniform::table const &locations = *static_cast<uniform::table const *>(command.data);
+    glUniform1i(locations[uniform::FIRST_INSTANCE], command.parameter);
+}
+
+// enables the vertex attribute at location in the encoding described by attribute
+static void set_vertex_attribute(GLuint location, model::attribute const &attribute, GLsizei stride, GLvoid *offset) {
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location, attribute.components, attribute.type, GLboolean(attribute.normalized), stride, offset);
+}
 
 ApplicationSolar::ApplicationSolar(std::string const &resource_path)
         : Application{resource_path}, planet_object{}, star_object{}, skybox_object{},
           m_view_transform{glm::translate(glm::fmat4{}, glm::fvec3{0.0f, 0.0f, 4.0f})},
           m_view_projection{utils::calculate_projection_matrix(initial_aspect_ratio)},
           solar_system_{},
-          current_planet_shader_{"planet"}, color_map{}, texture_map{}, screenquad_object{}, framebuffer_object{} {
+          current_planet_shader_{"planet"}, color_map{}, screenquad_object{},
+          post_chain_{m_programs, resource_path + "shaders/simple_screen_quad.vert",
+                      resource_path + "shaders/simple_screen_quad.frag"} {
     initializeGeometry();
     initializeShaderPrograms();
     initializeSolarSystem();
@@ -41,9 +67,14 @@ ApplicationSolar::ApplicationSolar(std::string const &resource_path)
     initializeStarsGeometry();
     initializeOrbits();
     initializeScreenquad();
-
-    // create framebuffer in Application constructor
-    initializeFramebuffer(initial_resolution.x, initial_resolution.y);
+    initializeFrameData();
+
+    // mirroring and greyscale are folded into the final pass, blur runs as two passes before it
+    horizontal_mirroring_ = post_chain_.add_composite("HORIZONTAL_MIRRORING");
+    vertical_mirroring_ = post_chain_.add_composite("VERTICAL_MIRRORING");
+    greyscale_ = post_chain_.add_composite("GREYSCALE");
+    blur_ = post_chain_.add_separable(m_resource_path + "shaders/blur.frag");
+    post_chain_.resize(initial_resolution.x, initial_resolution.y);
 }
 
 ApplicationSolar::~ApplicationSolar() {
@@ -57,6 +88,17 @@ ApplicationSolar::~ApplicationSolar() {
     glDeleteBuffers(1, &orbit_object.vertex_BO);
     glDeleteBuffers(1, &orbit_object.element_BO);
     glDeleteVertexArrays(1, &orbit_object.vertex_AO);
+    glDeleteBuffers(1, &orbit_matrix_BO_);
+    glDeleteTextures(1, &orbit_matrix_texture_.handle);
+
+    glDeleteBuffers(1, &planet_instance_BO_);
+    glDeleteTextures(1, &planet_instance_texture_.handle);
+    for (texture_object const &array : planet_texture_arrays_)
+        glDeleteTextures(1, &array.handle);
+    for (texture_object const &array : planet_normal_arrays_)
+        glDeleteTextures(1, &array.handle);
+
+    glDeleteBuffers(1, &frame_data_BO_);
 
     glDeleteBuffers(1, &skybox_object.vertex_BO);
     glDeleteBuffers(1, &skybox_object.element_BO);
@@ -68,255 +110,301 @@ ApplicationSolar::~ApplicationSolar() {
 }
 
 void ApplicationSolar::render() const {
-    // bind the framebuffer to the object handle
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_object.handle);
+    // without post processing the scene is drawn to the screen directly
+    glBindFramebuffer(GL_FRAMEBUFFER, post_chain_.target());
     // clear the color buffers and set to the below values
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     // clear color and depth buffer
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     // enable depth comparisons and update depth buffer
     glEnable(GL_DEPTH_TEST);
-    // render everything
+    // move planets before drawing them
+    updatePlanets();
+    // camera and light for all programs
+    uploadFrameData();
+    // collect everything, the queue sorts the draws by pass and state
     renderSkybox();
     renderPlanets();
     renderStars();
     renderOrbits();
-    // default rendering (binds framebuffer to 0)
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    // default color buffer is white
-    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    // disable depth comparison before rendering screenquad
-    glDisable(GL_DEPTH_TEST);
+    render_queue_.execute();
     renderScreenQuad();
 }
 
 void ApplicationSolar::renderScreenQuad() const {
+    // passes of the enabled effects, nothing if none is enabled
+    post_chain_.execute(screenquad_object.vertex_AO, screenquad_object.draw_mode, screenquad_object.num_elements);
+}
 
-    glUseProgram(m_shaders.at("simple_screen_quad").handle);
-
-    glActiveTexture(GL_TEXTURE0);
-    // render screenquad on framebuffer object
-    glBindTexture(GL_TEXTURE_2D, framebuffer_object.texture_handle);
+void ApplicationSolar::updatePlanets() const {
+    double const seconds = glfwGetTime() * time;
+    // orbit transform relative to the parent, parent transforms are applied by the scenegraph
+    // runs in parallel for large graphs, so only the given node may be accessed
+    solar_system_.animate([seconds](Node &node, glm::fmat4 &local) {
+        // same nodes as the render list
+        if (node.getDepth() == 0 || !node.isDrawable())
+            return false;
+        local = glm::rotate(glm::fmat4{}, float(seconds * node.getSpeed()), glm::fvec3{0.0f, 1.0f, 0.0f});
+        local = glm::translate(local, glm::fvec3{0.0f, 0.0f, node.getDistance()});
+        local = glm::scale(local, glm::vec3(node.getSize(), node.getSize(), node.getSize()));
+        return true;
+    });
+    // only subtrees whose local transform changed are recomputed
+    solar_system_.updateWorldTransforms();
+    // planets outside the view are skipped, whole systems at once if their bounds are outside
+    glm::fmat4 const view_projection = m_view_projection * glm::inverse(m_view_transform);
+    view_frustum_ = frustum_culling::extract(view_projection);
+    solar_system_.cull(view_projection);
+
+    auto children = solar_system_.getRenderList();
+
+    model_matrices_.resize(children.size());
+    normal_matrices_.resize(children.size());
+    for (std::size_t i = 0; i < children.size(); ++i) {
+        model_matrices_[i] = children.begin()[i]->getWorldTransform();
+    }
+    matrix_kernels::normal_matrices(glm::inverse(m_view_transform), model_matrices_.data(),
+                                    normal_matrices_.data(), model_matrices_.size());
+
+    // materials only change with the structure of the graph
+    if (render_materials_version_ != solar_system_.getTransforms().getVersion()) {
+        render_levels_.assign(children.size(), 0);
+        render_materials_.resize(children.size());
+        for (std::size_t i = 0; i < children.size(); ++i) {
+            auto material = material_indices_.find(children.begin()[i]->getName());
+            render_materials_[i] = material != material_indices_.end() ? material->second : 0;
+        }
+        render_materials_version_ = solar_system_.getTransforms().getVersion();
+    }
 
-    // add sampler
-    int samplerLocation = glGetUniformLocation(m_shaders.at("simple_screen_quad").handle, "screenTexture");
-    glUniform1i(samplerLocation, 0);//framebuffer_obj.texture_obj.handle);
+    // sphere level from the size on screen, the sphere is scaled like the planet
+    glm::fmat4 const view = glm::inverse(m_view_transform);
+    for (std::size_t i = 0; i < children.size(); ++i) {
+        if (!children.begin()[i]->isVisible())
+            continue;
+        glm::fvec4 bounds;
+        frustum_culling::transform(&model_matrices_[i], &planet_bounds_, &bounds, 1);
+        float pixels = sphere_lod::screen_radius(glm::fvec3(view * glm::fvec4(glm::fvec3(bounds), 1.0f)), bounds.w,
+                                                 m_view_projection, float(img_height));
+        render_levels_[i] = sphere_lod::select(pixels, render_levels_[i], planet_level_count);
+    }
 
-    //render quad
-    glBindVertexArray(screenquad_object.vertex_AO);
-    glDrawArrays(screenquad_object.draw_mode, 0, screenquad_object.num_elements);
+    // counting sort by level and texture arrays, so every combination is one contiguous batch of instances
+    // instances of one level stay adjacent, so programs without textures can draw them at once
+    std::size_t const sets = planet_texture_sets_.size();
+    planet_batches_.assign(sets * planet_level_count, planet_batch{0, 0, 0, 0});
+    std::size_t visible = 0;
+    for (std::size_t i = 0; i < children.size(); ++i) {
+        if (!children.begin()[i]->isVisible())
+            continue;
+        ++planet_batches_[render_levels_[i] * sets + planet_materials_[render_materials_[i]].texture_set].count;
+        ++visible;
+    }
+    GLint first = 0;
+    for (std::size_t bucket = 0; bucket < planet_batches_.size(); ++bucket) {
+        planet_batches_[bucket].texture_set = unsigned(bucket % sets);
+        planet_batches_[bucket].level = unsigned(bucket / sets);
+        planet_batches_[bucket].first = first;
+        first += planet_batches_[bucket].count;
+        // reused as insert position
+        planet_batches_[bucket].count = 0;
+    }
+    planet_instances_.resize(visible);
+    for (std::size_t i = 0; i < children.size(); ++i) {
+        if (!children.begin()[i]->isVisible())
+            continue;
+        planet_material const &material = planet_materials_[render_materials_[i]];
+        planet_batch &batch = planet_batches_[render_levels_[i] * sets + material.texture_set];
+        planet_instance &instance = planet_instances_[std::size_t(batch.first + batch.count++)];
+        instance.model_matrix = model_matrices_[i];
+        // shaders only use the upper 3x3
+        instance.normal_matrix = normal_matrices_[i];
+        instance.parameters = glm::fvec4(float(render_materials_[i]), material.ambient_intensity,
+                                         float(material.texture.layer), float(material.normal_texture.layer));
+    }
+    planet_batches_.erase(std::remove_if(planet_batches_.begin(), planet_batches_.end(),
+                                         [](planet_batch const &batch) { return batch.count == 0; }),
+                          planet_batches_.end());
 }
 
 void ApplicationSolar::renderPlanets() const {
-    auto children = solar_system_.getRoot()->getDrawable();
-    int index = 0;
-    // iteration through all planets and moons
-    for (auto child: children) {
-        auto parent = child->getParent();
-
-        child->setLocalTransform(
-                glm::rotate(parent->getLocalTransform(), float(glfwGetTime() * time * child->getSpeed()),
-                            glm::fvec3{0.0f, 1.0f, 0.0f}));
-
-        child->setLocalTransform(
-                glm::translate(child->getLocalTransform(), glm::fvec3{0.0f, 0.0f, child->getDistance()}));
-
-        child->setLocalTransform(glm::scale(child->getLocalTransform(),
-                                            glm::vec3(child->getSize(), child->getSize(), child->getSize())));
-
-        // bind shader to upload uniforms
-        glUseProgram(m_shaders.at(current_planet_shader_).handle);
-
-        auto model_mat = child->getLocalTransform();
-        glUniformMatrix4fv(m_shaders.at(current_planet_shader_).u_locs.at("ModelMatrix"),
-                           1, GL_FALSE, glm::value_ptr(model_mat));
-
-        auto normal_mat = glm::inverseTranspose(glm::inverse(m_view_transform) * child->getLocalTransform());
-        glUniformMatrix4fv(m_shaders.at(current_planet_shader_).u_locs.at("NormalMatrix"),
-                           1, GL_FALSE, glm::value_ptr(normal_mat));
-
-        // bind the VAO to draw
-        glBindVertexArray(planet_object.vertex_AO);
-
-        texture_object texture = texture_map.at(child->getName() + "_tex");
-        texture_object normal_texture = texture_map.at(child->getName() + "_normal_tex");
-
-        glActiveTexture(GL_TEXTURE1 + 2 * index);
-        // bind texture
-        glBindTexture(texture.target, texture.handle);
-        // add sampler
-        int samplerLocation = glGetUniformLocation(m_shaders.at(current_planet_shader_).handle, "TextureSampler");
-        glUniform1i(samplerLocation, texture.handle);
-
-        glActiveTexture(GL_TEXTURE1 + 2 * index + 1);
-        glBindTexture(normal_texture.target, normal_texture.handle);
-        int normalSamplerLocation = glGetUniformLocation(m_shaders.at(current_planet_shader_).handle, "NormalSampler");
-        glUniform1i(normalSamplerLocation, normal_texture.handle);
-
-        // add planet color
-        int planetColorLocation = glGetUniformLocation(m_shaders.at(current_planet_shader_).handle, "planet_color");
-        Color planet_color = color_map.find(child->getName())->second;
-        glUniform3f(planetColorLocation, planet_color.r / 255.0f, planet_color.g / 255.0f, planet_color.b / 255.0f);
-
-        //update the position, intensity and color of the point light
-        auto light_node = solar_system_.getRoot()->getChildren("sun");
-        auto light = std::static_pointer_cast<PointLightNode>(light_node);
-        Color light_color = light->getColor();
-        float light_intensity = light->getLightIntensity();
-        glm::fvec4 light_position = light->getWorldTransform() * glm::fvec4(0.0f, 0.0f, 0.0f, 1.0f);
-
-        int lightPositionLocation = glGetUniformLocation(m_shaders.at(current_planet_shader_).handle, "light_position");
-        glUniform3f(lightPositionLocation, light_position.x, light_position.y, light_position.z);
-
-        int lightIntensityLocation = glGetUniformLocation(m_shaders.at(current_planet_shader_).handle,
-                                                          "light_intensity");
-        glUniform1f(lightIntensityLocation, light_intensity);
-
-        int lightColorLocation = glGetUniformLocation(m_shaders.at(current_planet_shader_).handle, "light_color");
-        glUniform3f(lightColorLocation, light_color.r / 255.0f, light_color.g / 255.0f, light_color.b / 255.0f);
-
-        int ambientStrengthLocation = glGetUniformLocation(m_shaders.at(current_planet_shader_).handle,
-                                                           "ambient_intensity");
-
-        if (child->getName() == "sun") {
-            glUniform1f(ambientStrengthLocation, 1.0);
-        } else {
-            glUniform1f(ambientStrengthLocation, 0.5);
+    if (planet_instances_.empty())
+        return;
+    // respecify the whole buffer so the driver does not wait for the previous frame
+    glBindBuffer(GL_TEXTURE_BUFFER, planet_instance_BO_);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(planet_instance) * planet_instances_.size(), planet_instances_.data(),
+                 GL_STREAM_DRAW);
+
+    // all planets use the same program, look it up once
+    shader_program const &program = m_shaders.at(current_planet_shader_);
+    draw_command planets;
+    planets.program = program.handle;
+    planets.vertex_array = planet_object.vertex_AO;
+    planets.textures[0] = planet_instance_texture_;
+    planets.mode = planet_object.draw_mode;
+    planets.index_type = model::INDEX.type;
+    planets.uniforms = &set_first_instance;
+    planets.data = &program.locations;
+
+    // programs without textures draw all planets of a level at once, batches of a level are adjacent
+    if (program.locations[uniform::TEXTURE_SAMPLER] == -1 && program.locations[uniform::NORMAL_SAMPLER] == -1) {
+        planets.key = render_queue::key(OPAQUE_PASS, planets.program, planets.vertex_array);
+        for (std::size_t i = 0; i < planet_batches_.size();) {
+            sphere_lod::level const &level = planet_levels_[planet_batches_[i].level];
+            planets.first = GLint(level.first * model::INDEX.size);
+            planets.count = level.count;
+            planets.parameter = planet_batches_[i].first;
+            planets.instances = 0;
+            for (unsigned current = planet_batches_[i].level;
+                 i < planet_batches_.size() && planet_batches_[i].level == current; ++i)
+                planets.instances += planet_batches_[i].count;
+            render_queue_.submit(planets);
         }
+        return;
+    }
 
-        // draw bound vertex array using bound shader
-        glDrawElements(planet_object.draw_mode, planet_object.num_elements, model::INDEX.type, nullptr);
-        index++;
+    // one draw for all planets whose textures lie in the same arrays and which use the same level
+    for (planet_batch const &batch : planet_batches_) {
+        std::pair<unsigned, unsigned> const &arrays = planet_texture_sets_[batch.texture_set];
+        planets.textures[1] = planet_texture_arrays_[arrays.first];
+        planets.textures[2] = planet_normal_arrays_[arrays.second];
+        planets.key = render_queue::key(OPAQUE_PASS, planets.program, planets.vertex_array,
+                                        planets.textures[1].handle);
+        // first is a byte offset into the element buffer
+        planets.first = GLint(planet_levels_[batch.level].first * model::INDEX.size);
+        planets.count = planet_levels_[batch.level].count;
+        planets.instances = batch.count;
+        planets.parameter = batch.first;
+        render_queue_.submit(planets);
     }
 }
 
 void ApplicationSolar::renderStars() const {
-    glUseProgram(m_shaders.at("star").handle);
-    // bind the VAO to draw
-    glBindVertexArray(star_object.vertex_AO);
-    // draw bound vertex array using bound shader
-    glDrawArrays(star_object.draw_mode, GLint(0), star_object.num_elements);
+    // chunks outside the view are skipped, distant ones only draw their brightest stars
+    glm::fvec3 const eye{m_view_transform[3]};
+    if (star_field_.select(view_frustum_, eye, 20.0f, 0.05f, star_firsts_, star_counts_) == 0)
+        return;
+    draw_command stars;
+    stars.program = m_shaders.at("star").handle;
+    stars.vertex_array = star_object.vertex_AO;
+    stars.key = render_queue::key(OPAQUE_PASS, stars.program, stars.vertex_array);
+    stars.kind = draw_command::MULTI_ARRAYS;
+    stars.mode = star_object.draw_mode;
+    stars.firsts = star_firsts_.data();
+    stars.counts = star_counts_.data();
+    stars.count = GLsizei(star_counts_.size());
+    render_queue_.submit(stars);
 }
 
 void ApplicationSolar::renderOrbits() const {
-    //declare the shader we want to use
-    glUseProgram(m_shaders.at("orbit").handle);
-    auto drawables = solar_system_.getRoot()->getDrawable();
-    //for every orbit of a planet draw it
-    for (auto object : drawables) {
-        if (object->getName() == "moon") {
+    // the polylines never change, only the frames they are placed in move
+    visible_orbit_firsts_.clear();
+    visible_orbit_counts_.clear();
+    for (std::size_t i = 0; i < orbit_frames_.size(); ++i) {
+        Node const *frame = solar_system_.get(orbit_frames_[i]);
+        if (frame != nullptr)
+            orbit_matrices_[i] = frame->getWorldTransform();
+        glm::fvec4 bounds;
+        frustum_culling::transform(&orbit_matrices_[i], &orbit_bounds_[i], &bounds, 1);
+        if (frustum_culling::classify(view_frustum_, bounds) == frustum_culling::OUTSIDE)
             continue;
-        }
-        //get the geometry of the orbit that is stored in the node
-        auto orbit = object->getChildren(object->getName() + "_geom_orbit");
-
-        auto orbit_geom = std::static_pointer_cast<GeometryNode>(orbit);
-        auto orbit_world_transform = orbit->getWorldTransform();
-        model orbit_model = orbit_geom->getGeometry();
-        std::vector<GLfloat> orbit_data = (*orbit_geom).getGeometry().data;
-
-        //create the ModelMatrix using the WorldTransform of the orbit
-        glUniformMatrix4fv(m_shaders.at("orbit").u_locs.at("ModelMatrix"),
-                           1, GL_FALSE, glm::value_ptr(orbit_world_transform));
-
-        //bind the buffer of the orbit to set the data of the current orbit
-        glBindBuffer(GL_ARRAY_BUFFER, orbit_object.vertex_BO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * orbit_data.size(), orbit_data.data(), GL_STATIC_DRAW);
-
-        //bind the VertexArray for drawing
-        glBindVertexArray(orbit_object.vertex_AO);
-
-        //draw the array
-        glDrawArrays(orbit_object.draw_mode, GLint(0), orbit_object.num_elements);
+        visible_orbit_firsts_.push_back(orbit_firsts_[i]);
+        visible_orbit_counts_.push_back(orbit_counts_[i]);
     }
+    if (visible_orbit_counts_.empty())
+        return;
+    // respecify the whole buffer so the driver does not wait for the previous frame
+    glBindBuffer(GL_TEXTURE_BUFFER, orbit_matrix_BO_);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::fmat4) * orbit_matrices_.size(), orbit_matrices_.data(),
+                 GL_STREAM_DRAW);
+
+    //draw all orbits at once
+    draw_command orbits;
+    orbits.program = m_shaders.at("orbit").handle;
+    orbits.vertex_array = orbit_object.vertex_AO;
+    orbits.textures[0] = orbit_matrix_texture_;
+    orbits.key = render_queue::key(OPAQUE_PASS, orbits.program, orbits.vertex_array);
+    orbits.kind = draw_command::MULTI_ARRAYS;
+    orbits.mode = orbit_object.draw_mode;
+    orbits.firsts = visible_orbit_firsts_.data();
+    orbits.counts = visible_orbit_counts_.data();
+    orbits.count = GLsizei(visible_orbit_counts_.size());
+    render_queue_.submit(orbits);
 }
 
 void ApplicationSolar::renderSkybox() const {
-    glDepthMask(GL_FALSE);
-    glUseProgram(m_shaders.at("skybox").handle);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, skybox_texture_obj_.handle);
-    glBindVertexArray(skybox_object.vertex_AO);
-    glDrawElements(skybox_object.draw_mode, skybox_object.num_elements, model::INDEX.type, nullptr);
-    glDepthMask(GL_TRUE);
+    draw_command skybox;
+    skybox.program = m_shaders.at("skybox").handle;
+    skybox.vertex_array = skybox_object.vertex_AO;
+    skybox.textures[0] = skybox_texture_obj_;
+    // drawn first and behind everything else
+    skybox.key = render_queue::key(SKYBOX_PASS, skybox.program, skybox.vertex_array);
+    skybox.depth_write = false;
+    skybox.mode = skybox_object.draw_mode;
+    skybox.index_type = model::INDEX.type;
+    skybox.count = skybox_object.num_elements;
+    render_queue_.submit(skybox);
 }
 
-void ApplicationSolar::uploadView() {
+void ApplicationSolar::uploadFrameData() const {
+    frame_data data;
     // vertices are transformed in camera space, so camera transform must be inverted
-    glm::fmat4 view_matrix = glm::inverse(m_view_transform);
-
-    glUseProgram(m_shaders.at("star").handle);
-
-    glUniformMatrix4fv(m_shaders.at("star").u_locs.at("ModelViewMatrix"),
-                       1, GL_FALSE, glm::value_ptr(view_matrix));
-
-    glUseProgram(m_shaders.at("planet").handle);
-    // upload matrix to gpu
-    glUniformMatrix4fv(m_shaders.at("planet").u_locs.at("ViewMatrix"),
-                       1, GL_FALSE, glm::value_ptr(view_matrix));
-
-    glUseProgram(m_shaders.at("cel_shading").handle);
-    // upload matrix to gpu
-    glUniformMatrix4fv(m_shaders.at("cel_shading").u_locs.at("ViewMatrix"),
-                       1, GL_FALSE, glm::value_ptr(view_matrix));
-
-    glUseProgram(m_shaders.at("orbit").handle);
-
-    glUniformMatrix4fv(m_shaders.at("orbit").u_locs.at("ViewMatrix"),
-                       1, GL_FALSE, glm::value_ptr(view_matrix));
-
-    //bind & upload ViewMatric for skybox
-    glUseProgram(m_shaders.at("skybox").handle);
-    glUniformMatrix4fv(m_shaders.at("skybox").u_locs.at("ViewMatrix"),
-                       1, GL_FALSE, glm::value_ptr(view_matrix));
-
-    glUseProgram(m_shaders.at("simple_screen_quad").handle);
-
-    glUniform1i(m_shaders.at("simple_screen_quad").u_locs.at("horizontalMirroring"), horizontal_mirroring);
-    glUniform1i(m_shaders.at("simple_screen_quad").u_locs.at("verticalMirroring"), vertical_mirroring);
-    glUniform1i(m_shaders.at("simple_screen_quad").u_locs.at("greyscale"), greyscale);
-    glUniform1i(m_shaders.at("simple_screen_quad").u_locs.at("blur"), blur);
-    glUniform2f(m_shaders.at("simple_screen_quad").u_locs.at("textureSize"), img_width, img_height);
+    data.view_matrix = glm::inverse(m_view_transform);
+    data.projection_matrix = m_view_projection;
+
+    // position, intensity and color of the point light
+    auto light = solar_system_.get<PointLightNode>(solar_system_.findByName("sun"));
+    Color const &light_color = light->getColor();
+    data.light_position = light->getWorldTransform() * glm::fvec4(0.0f, 0.0f, 0.0f, 1.0f);
+    data.light_color = glm::fvec4(light_color.r / 255.0f, light_color.g / 255.0f, light_color.b / 255.0f,
+                                  light->getLightIntensity());
+
+    data.viewport_size = glm::fvec2(img_width, img_height);
+    data.time = float(glfwGetTime());
+    data.padding = 0.0f;
+
+    // respecify the whole buffer so the driver does not wait for the previous frame
+    glBindBuffer(GL_UNIFORM_BUFFER, frame_data_BO_);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(frame_data), &data, GL_STREAM_DRAW);
 }
 
-void ApplicationSolar::uploadProjection() {
-    // bind shader to which to upload unforms
-    glUseProgram(m_shaders.at("star").handle);
-
-    // upload matrix to gpu
-    glUniformMatrix4fv(m_shaders.at("star").u_locs.at("ProjectionMatrix"),
-                       1, GL_FALSE, glm::value_ptr(m_view_projection));
-
-    glUseProgram(m_shaders.at("planet").handle);
-
-    // upload matrix to gpu
-    glUniformMatrix4fv(m_shaders.at("planet").u_locs.at("ProjectionMatrix"),
-                       1, GL_FALSE, glm::value_ptr(m_view_projection));
-
-    glUseProgram(m_shaders.at("cel_shading").handle);
-
-    // upload matrix to gpu
-    glUniformMatrix4fv(m_shaders.at("cel_shading").u_locs.at("ProjectionMatrix"),
-                       1, GL_FALSE, glm::value_ptr(m_view_projection));
-
-    // upload matrix to gpu
+void ApplicationSolar::uploadUniforms() {
+    // block bindings are program state, so they are lost when shaders are reloaded
+    for (auto const &shader : m_shaders) {
+        utils::bind_uniform_block(shader.second.handle, "FrameData", frame_data_binding);
+    }
+    // texture units and materials do not change between frames
+    // programs without these uniforms ignore them, so all planet variants are covered
+    for (auto const &shader : m_shaders) {
+        shader_program const &program = shader.second;
+        if (program.locations[uniform::INSTANCES] == -1)
+            continue;
+        glUseProgram(program.handle);
+        glUniform1i(program.locations[uniform::INSTANCES], 0);
+        glUniform1i(program.locations[uniform::TEXTURE_SAMPLER], 1);
+        glUniform1i(program.locations[uniform::NORMAL_SAMPLER], 2);
+        glUniform3fv(program.locations[uniform::POSITION_SCALE], 1, glm::value_ptr(planet_position_scale_));
+        glUniform3fv(program.locations[uniform::POSITION_OFFSET], 1, glm::value_ptr(planet_position_offset_));
+        std::size_t color_count = material_colors_.size() < max_materials ? material_colors_.size() : max_materials;
+        if (color_count > 0)
+            glUniform3fv(program.locations[uniform::MATERIAL_COLORS], GLsizei(color_count),
+                         glm::value_ptr(material_colors_.front()));
+    }
     glUseProgram(m_shaders.at("orbit").handle);
+    glUniform1i(m_shaders.at("orbit").locations[uniform::MODEL_MATRICES], 0);
+}
 
-    glUniformMatrix4fv(m_shaders.at("orbit").u_locs.at("ProjectionMatrix"),
-                       1, GL_FALSE, glm::value_ptr(m_view_projection));
-
-    // upload matrix to gpu
-    glUseProgram(m_shaders.at("skybox").handle);
-    glUniformMatrix4fv(m_shaders.at("skybox").u_locs.at("ProjectionMatrix"),
-                       1, GL_FALSE, glm::value_ptr(m_view_projection));
+void ApplicationSolar::reloadPrograms(bool throwing) {
+    // post processing variants are owned by the chain
+    post_chain_.reload(throwing);
 }
 
-// update uniform locations
-void ApplicationSolar::uploadUniforms() {
-    // upload uniform values to new locations
-    uploadView();
-    uploadProjection();
+void ApplicationSolar::initializeFrameData() {
+    glGenBuffers(1, &frame_data_BO_);
+    glBindBuffer(GL_UNIFORM_BUFFER, frame_data_BO_);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(frame_data), nullptr, GL_STREAM_DRAW);
+    // stays attached to the binding point, respecifying the storage keeps the binding
+    glBindBufferBase(GL_UNIFORM_BUFFER, frame_data_binding, frame_data_BO_);
 }
 
 void ApplicationSolar::initializeScreenquad() {
@@ -358,17 +446,17 @@ void ApplicationSolar::initializeScreenquad() {
 }
 
 void ApplicationSolar::initializeOrbits() {
-    auto drawables = solar_system_.getRoot()->getDrawable();
+    auto drawables = solar_system_.getRenderList();
     float angle = 0.1f;
     size_t num_points = 65;
 
     std::vector<GLfloat> orbit_points;
-    for (auto object: drawables) {
+    for (Node *object: drawables) {
         orbit_points.clear();
         glm::mat4x4 rot_mat{};
         if (object->getName().find("moon") != std::string::npos) {
 
-            rot_mat = glm::translate(object->getParent()->getLocalTransform(),
+            rot_mat = glm::translate(solar_system_.get(object->getParent())->getLocalTransform(),
                                      glm::fvec3{0.0f, 0.0f, object->getDistance()});
             rot_mat = glm::rotate(rot_mat, angle, glm::fvec3{0.0f, 1.0f, 0.0f});
         } else {
@@ -385,10 +473,36 @@ void ApplicationSolar::initializeOrbits() {
         orbit_model.data = orbit_points;
         orbit_model.vertex_num = num_points;
 
-        auto orbit_node = std::make_shared<GeometryNode>(object, object->getName() + "_geom_orbit", orbit_model);
-        object->addChildren(orbit_node);
+        solar_system_.create<GeometryNode>(object->getHandle(), object->getName() + "_geom_orbit", orbit_model);
     }
 
+    // pack all drawn orbits into one buffer, positions first, then the orbit index of every vertex
+    std::vector<GLfloat> positions;
+    std::vector<GLint> orbit_indices;
+    orbit_firsts_.clear();
+    orbit_counts_.clear();
+    orbit_frames_.clear();
+    orbit_bounds_.clear();
+    for (Node *object: solar_system_.getRenderList()) {
+        if (object->getName() == "moon") {
+            continue;
+        }
+        auto orbit = solar_system_.get<GeometryNode>(object->getChildren(object->getName() + "_geom_orbit"));
+        std::vector<GLfloat> const &points = orbit->getGeometry().data;
+        // orbit points are defined in the frame of the body the object circles around
+        orbit_frames_.push_back(object->getParent());
+        orbit_firsts_.push_back(GLint(positions.size() / 3));
+        orbit_counts_.push_back(GLsizei(points.size() / 3));
+        // orbits circle around the origin of their frame
+        float radius = 0.0f;
+        for (std::size_t i = 0; i + 2 < points.size(); i += 3)
+            radius = std::max(radius, glm::length(glm::fvec3{points[i], points[i + 1], points[i + 2]}));
+        orbit_bounds_.emplace_back(0.0f, 0.0f, 0.0f, radius);
+        positions.insert(positions.end(), points.begin(), points.end());
+        orbit_indices.insert(orbit_indices.end(), points.size() / 3, GLint(orbit_frames_.size() - 1));
+    }
+    orbit_matrices_.assign(orbit_frames_.size(), glm::fmat4{});
+
     // create new VAO
     glGenVertexArrays(1, &orbit_object.vertex_AO);
     glBindVertexArray(orbit_object.vertex_AO);
@@ -396,164 +510,119 @@ void ApplicationSolar::initializeOrbits() {
     // generate a new Buffer and bind it to the new VertexArray
     glGenBuffers(1, &orbit_object.vertex_BO);
     glBindBuffer(GL_ARRAY_BUFFER, orbit_object.vertex_BO);
-    //specify the size of the data
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * orbit_points.size(), orbit_points.data(), GL_STATIC_DRAW);
+    //specify the size of the data, uploaded only once
+    std::size_t const positions_size = sizeof(GLfloat) * positions.size();
+    glBufferData(GL_ARRAY_BUFFER, positions_size + sizeof(GLint) * orbit_indices.size(), nullptr, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, positions_size, positions.data());
+    glBufferSubData(GL_ARRAY_BUFFER, positions_size, sizeof(GLint) * orbit_indices.size(), orbit_indices.data());
 
     // attribute Array for positions
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, GLsizei(3 * sizeof(float)), 0);
+    // attribute Array for orbit indices, kept as integers
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(1, 1, GL_INT, GLsizei(sizeof(GLint)), (void *) positions_size);
 
-    // draw mode and the number of points
+    // draw mode, ranges are given per orbit
     orbit_object.draw_mode = GL_LINE_STRIP;
-    orbit_object.num_elements = GLsizei(num_points);
+    orbit_object.num_elements = GLsizei(positions.size() / 3);
+
+    // model matrices are read from a buffer texture, four RGBA texels per matrix
+    glGenBuffers(1, &orbit_matrix_BO_);
+    glBindBuffer(GL_TEXTURE_BUFFER, orbit_matrix_BO_);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::fmat4) * orbit_matrices_.size(), orbit_matrices_.data(),
+                 GL_STREAM_DRAW);
+    glGenTextures(1, &orbit_matrix_texture_.handle);
+    orbit_matrix_texture_.target = GL_TEXTURE_BUFFER;
+    glBindTexture(GL_TEXTURE_BUFFER, orbit_matrix_texture_.handle);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, orbit_matrix_BO_);
 }
 
 
-// init Framebuffer
-bool ApplicationSolar::initializeFramebuffer(unsigned width, unsigned height) {
-
-    //generate Framebuffer and bind it
-    glGenFramebuffers(1, &framebuffer_object.handle);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_object.handle);
-
-    // create tex obj to use as color
-    texture_object texture;
-    glActiveTexture(GL_TEXTURE0);
-    glGenTextures(1, &texture.handle);
-    glBindTexture(GL_TEXTURE_2D, texture.handle);
-
-    // specify 2d texture image
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-
-    // set tex parameter min and max filter to GL_NEAREST
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture.handle, 0);
-
-    framebuffer_object.texture_obj = texture;
-    framebuffer_object.texture_handle = texture.handle;
-
-    //create renderbuffer for depth attachment
-    unsigned int renderbuffer_object;
-    glGenRenderbuffers(1, &renderbuffer_object);
-    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer_object);
-
-    // establish storage for rednerbuffer object
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
-
-    // attach renderbuffer to framebuffer 
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffer_object);
-
-    framebuffer_object.renderbuffer_handle = renderbuffer_object;
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
-
-    GLenum draw_buffers[1] = {GL_COLOR_ATTACHMENT0};
-    glDrawBuffers(1, draw_buffers);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    return true;
-}
 
 
 ///////////////////////////// intialisation functions /////////////////////////
 void ApplicationSolar::initializeSolarSystem() {
     // scenegraph with root
-    std::shared_ptr<Node> root = std::make_shared<Node>("root");
-    solar_system_ = SceneGraph("solarSystem", root);
+    solar_system_ = SceneGraph("solarSystem");
+    NodeHandle root = solar_system_.getRoot();
+    // large graphs are updated in parallel, small ones stay on this thread
+    solar_system_.setThreadCount(std::thread::hardware_concurrency());
 
     // sun
-    std::shared_ptr<PointLightNode> sun_holder = std::make_shared<PointLightNode>("sun", root);
-    std::shared_ptr<GeometryNode> geo_sun = std::make_shared<GeometryNode>(sun_holder, "geo_sun");
-    root->addChildren(sun_holder);
+    PointLightNode *sun_holder = solar_system_.create<PointLightNode>(root, "sun");
+    solar_system_.create<GeometryNode>(sun_holder->getHandle(), "geo_sun");
     sun_holder->setLightIntensity(1);
     sun_holder->setColor(Color{255, 255, 255});
     sun_holder->setDistance(0.0f);
     sun_holder->setSize(7.0f);
-    sun_holder->addChildren(geo_sun);
 
     // merkur
-    std::shared_ptr<Node> merkur_holder = std::make_shared<Node>("mercury", root);
-    std::shared_ptr<GeometryNode> geo_merkur = std::make_shared<GeometryNode>(merkur_holder, "geo_mercury");
+    Node *merkur_holder = solar_system_.create<Node>(root, "mercury");
+    solar_system_.create<GeometryNode>(merkur_holder->getHandle(), "geo_mercury");
     merkur_holder->setSpeed(4.147f);
     merkur_holder->setDistance(5.0f + sun_holder->getSize());
     merkur_holder->setSize(0.38f);
-    root->addChildren(merkur_holder);
-    merkur_holder->addChildren(geo_merkur);
 
     // venus
-    std::shared_ptr<Node> venus_holder = std::make_shared<Node>("venus", root);
-    std::shared_ptr<GeometryNode> geo_venus = std::make_shared<GeometryNode>(merkur_holder, "geo_venus");
+    Node *venus_holder = solar_system_.create<Node>(root, "venus");
+    solar_system_.create<GeometryNode>(venus_holder->getHandle(), "geo_venus");
     venus_holder->setSpeed(2.624f);
     venus_holder->setDistance(9.31f + sun_holder->getSize());
     venus_holder->setSize(0.94f);
-    root->addChildren(venus_holder);
-    venus_holder->addChildren(geo_venus);
 
     // earth planet
-    std::shared_ptr<Node> earth_holder = std::make_shared<Node>("earth", root);
-    std::shared_ptr<GeometryNode> geo_earth = std::make_shared<GeometryNode>(earth_holder, "geo_earth");
+    Node *earth_holder = solar_system_.create<Node>(root, "earth");
+    solar_system_.create<GeometryNode>(earth_holder->getHandle(), "geo_earth");
     earth_holder->setSpeed(1.0f);
     earth_holder->setDistance(12.93f + sun_holder->getSize());
     earth_holder->setSize(1.0f);
-    root->addChildren(earth_holder);
-    earth_holder->addChildren(geo_earth);
 
     // moon
-    std::shared_ptr<Node> moon_holder = std::make_shared<Node>("moon", earth_holder);
-    std::shared_ptr<GeometryNode> geo_moon = std::make_shared<GeometryNode>(earth_holder, "geo_moon");
+    Node *moon_holder = solar_system_.create<Node>(earth_holder->getHandle(), "moon");
+    solar_system_.create<GeometryNode>(moon_holder->getHandle(), "geo_moon");
     moon_holder->setSpeed(0.5f);
     moon_holder->setDistance(0.4f + earth_holder->getSize());
     moon_holder->setSize(0.27f);
-    earth_holder->addChildren(moon_holder);
-    moon_holder->addChildren(geo_moon);
 
     // mars
-    std::shared_ptr<Node> mars_holder = std::make_shared<Node>("mars", root);
-    std::shared_ptr<GeometryNode> geo_mars = std::make_shared<GeometryNode>(mars_holder, "geo_mars");
+    Node *mars_holder = solar_system_.create<Node>(root, "mars");
+    solar_system_.create<GeometryNode>(mars_holder->getHandle(), "geo_mars");
     mars_holder->setSpeed(0.831f);
     mars_holder->setDistance(19.65f + sun_holder->getSize());
     mars_holder->setSize(0.53f);
-    root->addChildren(mars_holder);
-    mars_holder->addChildren(geo_mars);
 
     // jupiter
-    std::shared_ptr<Node> jupiter_holder = std::make_shared<Node>("jupiter", root);
-    std::shared_ptr<GeometryNode> geo_jupiter = std::make_shared<GeometryNode>(jupiter_holder, "geo_jupiter");
+    Node *jupiter_holder = solar_system_.create<Node>(root, "jupiter");
+    solar_system_.create<GeometryNode>(jupiter_holder->getHandle(), "geo_jupiter");
     jupiter_holder->setSpeed(0.943f);
     jupiter_holder->setDistance(30.0f + sun_holder->getSize()); //67.068
     jupiter_holder->setSize(4.0f);
-    root->addChildren(jupiter_holder);
-    jupiter_holder->addChildren(geo_jupiter);
 
     // saturn
-    std::shared_ptr<Node> saturn_holder = std::make_shared<Node>("saturn", root);
-    std::shared_ptr<GeometryNode> geo_saturn = std::make_shared<GeometryNode>(saturn_holder, "geo_saturn");
+    Node *saturn_holder = solar_system_.create<Node>(root, "saturn");
+    solar_system_.create<GeometryNode>(saturn_holder->getHandle(), "geo_saturn");
     saturn_holder->setSpeed(0.74f);
     saturn_holder->setDistance(38.0f + sun_holder->getSize()); // 123.017
     saturn_holder->setSize(3.0f);
-    root->addChildren(saturn_holder);
-    saturn_holder->addChildren(geo_saturn);
 
     // uranus
-    std::shared_ptr<Node> uranus_holder = std::make_shared<Node>("uranus", root);
-    std::shared_ptr<GeometryNode> geo_uranus = std::make_shared<GeometryNode>(uranus_holder, "geo_uranus");
+    Node *uranus_holder = solar_system_.create<Node>(root, "uranus");
+    solar_system_.create<GeometryNode>(uranus_holder->getHandle(), "geo_uranus");
     uranus_holder->setSpeed(0.65f);
     uranus_holder->setDistance(50.0f + sun_holder->getSize()); //248.620
     uranus_holder->setSize(2.0f);
-    root->addChildren(uranus_holder);
-    uranus_holder->addChildren(geo_uranus);
 
     // neptun
-    std::shared_ptr<Node> neptun_holder = std::make_shared<Node>("neptune", root);
-    std::shared_ptr<GeometryNode> geo_neptun = std::make_shared<GeometryNode>(saturn_holder, "geo_neptune");
+    Node *neptun_holder = solar_system_.create<Node>(root, "neptune");
+    solar_system_.create<GeometryNode>(neptun_holder->getHandle(), "geo_neptune");
     neptun_holder->setSpeed(0.607f);
     neptun_holder->setDistance(60.0f + sun_holder->getSize()); //388.706
     neptun_holder->setSize(2.0f);
-    root->addChildren(neptun_holder);
-    neptun_holder->addChildren(geo_neptun);
+
+    // every planet is drawn with the same sphere, scaled by its world transform
+    for (Node *object: solar_system_.getRenderList())
+        object->setBoundingSphere(planet_bounds_);
 
     color_map.insert({"sun", {255, 255, 0}});
     color_map.insert({"uranus", {188, 255, 252}});
@@ -572,106 +641,66 @@ void ApplicationSolar::initializeShaderPrograms() {
     // store shader program objects in container
     m_shaders.emplace("planet", shader_program{{{GL_VERTEX_SHADER, m_resource_path + "shaders/simple.vert"},
                                                        {GL_FRAGMENT_SHADER, m_resource_path + "shaders/simple.frag"}}});
-    // request uniform locations for shader program
-    m_shaders.at("planet").u_locs["NormalMatrix"] = -1;
-    m_shaders.at("planet").u_locs["ModelMatrix"] = -1;
-    m_shaders.at("planet").u_locs["ViewMatrix"] = -1;
-    m_shaders.at("planet").u_locs["ProjectionMatrix"] = -1;
-    m_shaders.at("planet").u_locs["TextureSampler"] = -1;
+    // cel shading is the variant "planet+CEL_SHADING", compiled when it is selected first
 
-
-    // store shader program objects in container
-    m_shaders.emplace("cel_shading", shader_program{{{GL_VERTEX_SHADER, m_resource_path + "shaders/cel_shading.vert"},
-                                                            {GL_FRAGMENT_SHADER,
-                                                                    m_resource_path + "shaders/cel_shading.frag"}}});
-    // request uniform locations for shader program
-    m_shaders.at("cel_shading").u_locs["NormalMatrix"] = -1;
-    m_shaders.at("cel_shading").u_locs["ModelMatrix"] = -1;
-    m_shaders.at("cel_shading").u_locs["ViewMatrix"] = -1;
-    m_shaders.at("cel_shading").u_locs["ProjectionMatrix"] = -1;
-    m_shaders.at("planet").u_locs["TextureSampler"] = -1;
-
-
-    m_shaders.emplace("star", shader_program{{{GL_VERTEX_SHADER, m_resource_path + "shaders/vao.vert"},
+    m_shaders.emplace("star", shader_program{{{GL_VERTEX_SHADER, m_resource_path + "shaders/star.vert"},
                                                      {GL_FRAGMENT_SHADER, m_resource_path + "shaders/vao.frag"}}});
 
-    // request uniform locations for shader program
-    m_shaders.at("star").u_locs["ModelViewMatrix"] = -1;
-    m_shaders.at("star").u_locs["ProjectionMatrix"] = -1;
-
     // store orbit shader in container
     m_shaders.emplace("orbit", shader_program{{{GL_VERTEX_SHADER, m_resource_path + "shaders/orbit.vert"},
                                                       {GL_FRAGMENT_SHADER, m_resource_path + "shaders/orbit.frag"}}});
-    // request uniform locations for shader program
-    m_shaders.at("orbit").u_locs["ModelMatrix"] = -1;
-    m_shaders.at("orbit").u_locs["ViewMatrix"] = -1;
-    m_shaders.at("orbit").u_locs["ProjectionMatrix"] = -1;
 
     // now initialize shaders for skybox
     m_shaders.emplace("skybox", shader_program{{{GL_VERTEX_SHADER, m_resource_path + "shaders/skybox.vert"},
                                                        {GL_FRAGMENT_SHADER, m_resource_path + "shaders/skybox.frag"}}});
 
-    // request uniform location for shader program
-    m_shaders.at("skybox").u_locs["ProjectionMatrix"] = -1;
-    m_shaders.at("skybox").u_locs["ViewMatrix"] = -1;
-
-    //store quad shader for working with extra framebuffer
-    m_shaders.emplace("simple_screen_quad",
-                      shader_program{{{GL_VERTEX_SHADER, m_resource_path + "shaders/simple_screen_quad.vert"},
-                                             {GL_FRAGMENT_SHADER,
-                                                     m_resource_path + "shaders/simple_screen_quad.frag"}}});
-
-    m_shaders.at("simple_screen_quad").u_locs["screenTexture"] = -1;
-    m_shaders.at("simple_screen_quad").u_locs["horizontalMirroring"] = 0;
-    m_shaders.at("simple_screen_quad").u_locs["verticalMirroring"] = 0;
-    m_shaders.at("simple_screen_quad").u_locs["greyscale"] = 0;
-    m_shaders.at("simple_screen_quad").u_locs["blur"] = 0;
-    m_shaders.at("simple_screen_quad").u_locs["textureSize"] = -1;
+    // screen quad shaders are requested by post_chain_ from m_programs, one program per combination of effects
+    // uniform locations are reflected from the linked programs in updateUniformLocations()
 }
 
 void ApplicationSolar::initializeStarsGeometry() {
-    int const numberStars = 5000;
-    std::vector<GLfloat> stars; //= std::vector<GLfloat>(6 * numberStars * sizeof(float));
-    stars.reserve(6 * numberStars * sizeof(float));
-
-    for (int i = 0; i < numberStars; i++) {
-        float rand_x = static_cast<float>(std::rand() % 100) - 50.0f;
-        stars.push_back(rand_x);
-        float rand_y = static_cast<float>(std::rand() % 100) - 50.0f;
-        stars.push_back(rand_y);
-        float rand_z = static_cast<float>(std::rand() % 100) - 50.0f;
-        stars.push_back(rand_z);
-        float rand_r = static_cast<float>(std::rand() % 255) / 255.0f;
-        stars.push_back(rand_r);
-        float rand_g = static_cast<float>(std::rand() % 255) / 255.0f;
-        stars.push_back(rand_g);
-        float rand_b = static_cast<float>(std::rand() % 255) / 255.0f;
-        stars.push_back(rand_b);
-    }
+    // reproducible for a seed, however many threads generate it
+    star_field::parameters params;
+    params.count = 1000000;
+    params.seed = 5000;
+    params.radius = 50.0f;
+    ThreadPool pool{std::thread::hardware_concurrency()};
+    star_field_ = star_field{params, &pool};
+    std::vector<star> const &stars = star_field_.stars();
 
     glGenVertexArrays(1, &star_object.vertex_AO);
     glBindVertexArray(star_object.vertex_AO);
 
     glGenBuffers(1, &star_object.vertex_BO);
     glBindBuffer(GL_ARRAY_BUFFER, star_object.vertex_BO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * stars.size(), stars.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(star) * stars.size(), stars.data(), GL_STATIC_DRAW);
 
     // first attribArray for positions
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, GLsizei(6 * sizeof(float)), nullptr);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, GLsizei(sizeof(star)), (void *) offsetof(star, position));
 
     // second attribArray for colors
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, GLsizei(6 * sizeof(float)), (void *) (sizeof(float) * 3));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, GLsizei(sizeof(star)), (void *) offsetof(star, color));
+
+    // third attribArray for magnitudes, they set the point size
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, GLsizei(sizeof(star)), (void *) offsetof(star, magnitude));
     //the index of the vertexattribarray corresponds to layout position
+    glEnable(GL_PROGRAM_POINT_SIZE);
 
     star_object.draw_mode = GL_POINTS;
-    star_object.num_elements = GLsizei(numberStars);
+    star_object.num_elements = GLsizei(stars.size());
 }
 
 // load models
 void ApplicationSolar::initializeGeometry() {
-    model planet_model = model_loader::obj(m_resource_path + "models/sphere.obj", model::NORMAL | model::TEXCOORD);
+    // all levels of detail of the planet sphere share one vertex and one element buffer
+    // vertices are packed into 20 instead of 48 bytes, the shader restores the positions
+    model planet_model = vertex_quantization::pack(sphere_lod::chain(planet_level_count, planet_levels_));
+    planet_bounds_ = planet_model.bounding_sphere;
+    planet_position_scale_ = planet_model.position_scale;
+    planet_position_offset_ = planet_model.position_offset;
 
     // generate vertex array object
     glGenVertexArrays(1, &planet_object.vertex_AO);
@@ -685,21 +714,15 @@ void ApplicationSolar::initializeGeometry() {
     // configure currently bound array buffer
     glBufferData(GL_ARRAY_BUFFER, sizeof(float) * planet_model.data.size(), planet_model.data.data(), GL_STATIC_DRAW);
 
-    // activate first attribute on gpu
-    glEnableVertexAttribArray(0);
-    // first attribute is 3 floats with no offset & stride
-    glVertexAttribPointer(0, model::POSITION.components, model::POSITION.type, GL_FALSE, planet_model.vertex_bytes,
-                          planet_model.offsets[model::POSITION]);
-    // activate second attribute on gpu
-    glEnableVertexAttribArray(1);
-    // second attribute is 3 floats with no offset & stride
-    glVertexAttribPointer(1, model::NORMAL.components, model::NORMAL.type, GL_FALSE, planet_model.vertex_bytes,
-                          planet_model.offsets[model::NORMAL]);
-    // activate third attribute on gpu
-    glEnableVertexAttribArray(2);
-    // third attribute is 2 floats with no offset & stride
-    glVertexAttribPointer(2, model::TEXCOORD.components, model::TEXCOORD.type, GL_FALSE, planet_model.vertex_bytes,
-                          planet_model.offsets[model::TEXCOORD]);
+    // first attribute is the position, second the normal, third the texture coordinate and fourth the tangent
+    set_vertex_attribute(0, planet_model.layout(model::POSITION), planet_model.vertex_bytes,
+                         planet_model.offsets[model::POSITION]);
+    set_vertex_attribute(1, planet_model.layout(model::NORMAL), planet_model.vertex_bytes,
+                         planet_model.offsets[model::NORMAL]);
+    set_vertex_attribute(2, planet_model.layout(model::TEXCOORD), planet_model.vertex_bytes,
+                         planet_model.offsets[model::TEXCOORD]);
+    set_vertex_attribute(3, planet_model.layout(model::TANGENT), planet_model.vertex_bytes,
+                         planet_model.offsets[model::TANGENT]);
 
     // generate generic buffer
     glGenBuffers(1, &planet_object.element_BO);
@@ -711,11 +734,21 @@ void ApplicationSolar::initializeGeometry() {
 
     // store type of primitive to draw
     planet_object.draw_mode = GL_TRIANGLES;
-    // transfer number of indices to model object
+    // transfer number of indices to model object, each draw uses the range of one level
     planet_object.num_elements = GLsizei(planet_model.indices.size());
 
-    // add skybox model
-    model skybox_model = model_loader::obj(m_resource_path + "models/skybox.obj");
+    // per instance data, filled every frame by updatePlanets()
+    glGenBuffers(1, &planet_instance_BO_);
+    glBindBuffer(GL_TEXTURE_BUFFER, planet_instance_BO_);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(planet_instance), nullptr, GL_STREAM_DRAW);
+    glGenTextures(1, &planet_instance_texture_.handle);
+    planet_instance_texture_.target = GL_TEXTURE_BUFFER;
+    glBindTexture(GL_TEXTURE_BUFFER, planet_instance_texture_.handle);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, planet_instance_BO_);
+
+    // add skybox model, mapped from the binary mesh so the buffers are filled without parsing
+    mesh_file skybox_model = model_loader::obj_mapped(m_resource_path + "models/skybox.obj",
+                                                      model::POSITION | model_loader::OPTIMIZE);
     // starting with VAO
     glGenVertexArrays(1, &skybox_object.vertex_AO);
     // bind that
@@ -725,106 +758,74 @@ void ApplicationSolar::initializeGeometry() {
     // again : binding as vertex array buffer with all attributes
     glBindBuffer(GL_ARRAY_BUFFER, skybox_object.vertex_BO);
     // configuration
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * skybox_model.data.size(), skybox_model.data.data(), GL_STATIC_DRAW);
-    // activation of first attribute on gpu
-    glEnableVertexAttribArray(0);
-    // first attribute is 3 floats with no offset & stride
-    glVertexAttribPointer(0, model::POSITION.components, model::POSITION.type, GL_FALSE, skybox_model.vertex_bytes,
-                          skybox_model.offsets[model::POSITION]);
+    glBufferData(GL_ARRAY_BUFFER, skybox_model.vertex_num() * skybox_model.vertex_bytes(), skybox_model.vertices(),
+                 GL_STATIC_DRAW);
+    // first attribute is the position, in clip space so it is not packed
+    set_vertex_attribute(0, skybox_model.layout(model::POSITION), skybox_model.vertex_bytes(),
+                         skybox_model.offset(model::POSITION));
     // generate generic buffer
     glGenBuffers(1, &skybox_object.element_BO);
     // bind as an vertex array buffer containing all attributes
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, skybox_object.element_BO);
     // configure currently bound array buffer
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, model::INDEX.size * skybox_model.indices.size(), skybox_model.indices.data(),
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, model::INDEX.size * skybox_model.index_num(), skybox_model.indices(),
                  GL_STATIC_DRAW);
     // store type of primitive to draw
     skybox_object.draw_mode = GL_TRIANGLES;
     // transfer number of indices to model object
-    skybox_object.num_elements = GLsizei(skybox_model.indices.size());
+    skybox_object.num_elements = GLsizei(skybox_model.index_num());
 }
 
 void ApplicationSolar::initializeTextures() {
-    auto drawables = solar_system_.getRoot()->getDrawable();
-    int planetIndex = 0;
-    pixel_data planet_texture;
-    for (auto object: drawables) {
+    auto drawables = solar_system_.getRenderList();
+    // planet textures are resampled to one size, so albedo and normal maps each fit into a single array
+    texture_array_builder textures{1024, 512};
+    texture_array_builder normal_textures{1024, 512};
+    for (Node *object: drawables) {
+        // planets with the same name share one material
+        if (material_indices_.count(object->getName()) != 0)
+            continue;
+
+        pixel_data planet_texture;
         try {
             planet_texture = texture_loader::file(m_resource_path + "textures/" + object->getName() + ".png");
         }
         catch (std::exception e) {
-            std::cout << "Error loading texturefile for " + object->getName() + ". \n " + e.what() + "\n";
+            planet_texture = pixel_data{{255, 255, 255, 255}, GL_RGBA, GL_UNSIGNED_BYTE, 1, 1};
+            std::cout << "Error loading texturefile for " + object->getName() + ". \n " + e.what() +
+                         ". White was used instead.\n";
         }
 
-        GLsizei width = (GLsizei) planet_texture.width;
-        GLsizei height = (GLsizei) planet_texture.height;
-        GLenum channel_number = planet_texture.channels;
-        GLenum channel_type = planet_texture.channel_type;
-
-        //glActiveTexture(GL_TEXTURE+planetIndex);
-        glActiveTexture(GL_TEXTURE1 + 2 * planetIndex);
-        texture_object texture;
-        glGenTextures(1, &texture.handle);
-        texture.target = GL_TEXTURE_2D;
-        std::string texture_name = object->getName() + "_tex";
-        texture_map.insert({texture_name, texture});
-
-        glBindTexture(texture.target, texture.handle);
-
-        //optional
-
-        //Texture wrapping
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-        //Texture filteriglTexImage2D(GL_TEXTURE_2D, 0, ng
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        glTexImage2D(GL_TEXTURE_2D, 0, channel_number, width, height, 0, channel_number, channel_type,
-                     planet_texture.ptr());
-        glGenerateMipmap(GL_TEXTURE_2D);
-        planetIndex++;
-
+        pixel_data normal_texture;
         try {
-            planet_texture = texture_loader::file(m_resource_path + "normal_maps/" + object->getName() + ".png");
+            normal_texture = texture_loader::file(m_resource_path + "normal_maps/" + object->getName() + ".png");
         }
         catch (std::exception e) {
-            planet_texture = texture_loader::file(m_resource_path + "normal_maps/sun.png");
+            normal_texture = texture_loader::file(m_resource_path + "normal_maps/sun.png");
             std::cout << "Error loading texturefile for " + object->getName() + ". \n " + e.what() +
                          ". Default normal was loaded.\n";
         }
 
-        width = (GLsizei) planet_texture.width;
-        height = (GLsizei) planet_texture.height;
-        channel_number = planet_texture.channels;
-        channel_type = planet_texture.channel_type;
-
-        //glActiveTexture(GL_TEXTURE+planetIndex);
-        glActiveTexture(GL_TEXTURE1 + 2 * planetIndex + 1);
-        texture_object normal_texture;
-        glGenTextures(1, &normal_texture.handle);
-        normal_texture.target = GL_TEXTURE_2D;
-        texture_name = object->getName() + "_normal_tex";
-        texture_map.insert({texture_name, normal_texture});
-
-        glBindTexture(normal_texture.target, normal_texture.handle);
-
-        //optional
-
-        //Texture wrapping
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-        //Texture filteriglTexImage2D(GL_TEXTURE_2D, 0, ng
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        glTexImage2D(GL_TEXTURE_2D, 0, channel_number, width, height, 0, channel_number, channel_type,
-                     planet_texture.ptr());
-        //glGenerateMipmap(GL_TEXTURE_2D);
-        planetIndex++;
+        planet_material material;
+        material.texture = textures.add(planet_texture);
+        material.normal_texture = normal_textures.add(normal_texture);
+        material.ambient_intensity = object->getName() == "sun" ? 1.0f : 0.5f;
+        // planets whose textures lie in the same arrays are drawn together
+        std::pair<unsigned, unsigned> arrays{material.texture.array, material.normal_texture.array};
+        auto set = std::find(planet_texture_sets_.begin(), planet_texture_sets_.end(), arrays);
+        material.texture_set = unsigned(set - planet_texture_sets_.begin());
+        if (set == planet_texture_sets_.end())
+            planet_texture_sets_.push_back(arrays);
+
+        material_indices_.insert({object->getName(), unsigned(planet_materials_.size())});
+        planet_materials_.push_back(material);
+        auto color = color_map.find(object->getName());
+        material_colors_.push_back(color != color_map.end() ?
+                                   glm::fvec3(color->second.r, color->second.g, color->second.b) / 255.0f :
+                                   glm::fvec3(1.0f));
     }
+    planet_texture_arrays_ = textures.build();
+    planet_normal_arrays_ = normal_textures.build();
 
     /* used as reference :
     https://learnopengl.com/Advanced-OpenGL/Cubemaps
@@ -881,48 +882,47 @@ void ApplicationSolar::initializeTextures() {
 void ApplicationSolar::keyCallback(int key, int action, int mods) {
     if (key == GLFW_KEY_W && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
         m_view_transform = glm::translate(m_view_transform, glm::fvec3{0.0f, 0.0f, -1.0f});
-        uploadView();
     } else if (key == GLFW_KEY_S && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
         m_view_transform = glm::translate(m_view_transform, glm::fvec3{0.0f, 0.0f, 1.0f});
-        uploadView();
     } else if (key == GLFW_KEY_A && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
         m_view_transform = glm::translate(m_view_transform, glm::fvec3{-1.0f, 0.0f, 0.0f});
-        uploadView();
     } else if (key == GLFW_KEY_D && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
         m_view_transform = glm::translate(m_view_transform, glm::fvec3{1.0f, 0.0f, 0.0f});
-        uploadView();
     } else if (key == GLFW_KEY_SPACE && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
         m_view_transform = glm::translate(glm::fmat4{}, glm::fvec3{0.0f, 0.0f, 4.0f});
-        uploadView();
     } else if (key == GLFW_KEY_U && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
         m_view_transform = glm::translate(glm::fmat4{}, glm::fvec3{0.0f, 50.0f, 0.0f});
-        uploadView();
     } else if (key == GLFW_KEY_1 && (action == GLFW_PRESS)) {
         current_planet_shader_ = "planet";
-        uploadView();
     } else if (key == GLFW_KEY_2 && (action == GLFW_PRESS)) {
-        current_planet_shader_ = "cel_shading";
-        uploadView();
+        // keep the current program if the variant does not compile
+        try {
+            current_planet_shader_ = shaderVariant("planet", {"CEL_SHADING"});
+        }
+        catch (std::exception &) {}
     } else if (key == GLFW_KEY_3 && (action == GLFW_PRESS)) {
         time = !time;
     }
 
     //postprocessing
     if (key == GLFW_KEY_4 && (action == GLFW_PRESS)) {
-        horizontal_mirroring = !horizontal_mirroring;
-        uploadView();
+        togglePostEffect(horizontal_mirroring_);
     } else if (key == GLFW_KEY_5 && (action == GLFW_PRESS)) {
-        vertical_mirroring = !vertical_mirroring;
-        uploadView();
+        togglePostEffect(vertical_mirroring_);
     } else if (key == GLFW_KEY_6 && (action == GLFW_PRESS)) {
-        greyscale = !greyscale;
-        uploadView();
+        togglePostEffect(greyscale_);
     } else if (key == GLFW_KEY_7 && (action == GLFW_PRESS)) {
-        blur = !blur;
-        uploadView();
+        togglePostEffect(blur_);
     }
 }
 
+void ApplicationSolar::togglePostEffect(post_chain::effect effect) {
+    // programs are compiled here instead of while drawing, effects which do not compile stay off
+    post_chain_.toggle(effect);
+    if (!post_chain_.reload(false))
+        post_chain_.toggle(effect);
+}
+
 //handle delta mouse movement input
 void ApplicationSolar::mouseCallback(double pos_x, double pos_y) {
     // mouse handling
@@ -936,18 +936,14 @@ void ApplicationSolar::mouseCallback(double pos_x, double pos_y) {
     } else {
         m_view_transform = glm::rotate(m_view_transform, glm::radians(angle_tilt), glm::vec3{1, 0, 0});
     }
-
-    // update ViewMatrix
-    uploadView();
+    // view matrix is uploaded with the next frame
 }
 
 //handle resizing
 void ApplicationSolar::resizeCallback(unsigned width, unsigned height) {
     // recalculate projection matrix for new aspect ration
     m_view_projection = utils::calculate_projection_matrix(float(width) / float(height));
-    // upload new projection matrix
-    uploadProjection();
-    initializeFramebuffer(width, height);
+    post_chain_.resize(width, height);
     img_width = width;
     img_height = height;
 }
@@ -955,5 +951,5 @@ void ApplicationSolar::resizeCallback(unsigned width, unsigned height) {
 
 // exe entry point
 int main(int argc, char *argv[]) {
-    Application::run<ApplicationSolar>(argc, argv, 3, 2);
+    Application::run<ApplicationSolar>(argc, argv, 3, 3);
 }
\ No newline at end of file
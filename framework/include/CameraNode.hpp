@@ -19,15 +19,15 @@ public:
     CameraNode(bool isPerspective, bool isEnabled, glm::mat4 const &projectionMatrix);
 
     // getter and setter
-    bool getPerspective();
+    bool getPerspective() const;
 
     void setPerspective(bool perspective);
 
-    bool getEnabled();
+    bool getEnabled() const;
 
     void setEnabled(bool enabled);
 
-    glm::mat4 getProjectionMatrix();
+    glm::mat4 const &getProjectionMatrix() const;
 
     void setProjectionMatrix(glm::mat4 const &mat);
 };
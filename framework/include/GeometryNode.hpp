@@ -11,15 +11,13 @@ public:
 
     explicit GeometryNode(std::string name);
 
-    GeometryNode(const std::shared_ptr<Node> &parent, std::string name);
-
-    GeometryNode(const std::shared_ptr<Node> &parent, std::string name, model geometry);
+    GeometryNode(std::string name, model geometry);
 
     // destructor
     ~GeometryNode();
 
     // Getter und Setter
-    model getGeometry() const;
+    model const &getGeometry() const;
 
     void setGeometry(model const &geometry);
 
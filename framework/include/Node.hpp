@@ -2,25 +2,58 @@
 #define NODE_HPP
 
 #include <string>
-#include <list>
-#include <memory>
 #include <vector>
 #include "glm/glm.hpp"
+#include "TransformStore.hpp"
+#include "NodeHandle.hpp"
 
+class SceneGraph;
+class NodePool;
+
+// nodes are owned by a scenegraph, create them with SceneGraph::create()
+// links to parent and children are handles, so nodes do not keep each other alive
 class Node {
 
+public:
+    // type tag, set by the derived node classes
+    enum Kind {
+        GROUP,
+        GEOMETRY,
+        LIGHT,
+        CAMERA
+    };
+
 private:
     std::string name_;
     std::string path_;
-    int depth_;
-    glm::mat4 localTransform_;
-    glm::mat4 worldTransform_;
-    std::shared_ptr<Node> parent_;
-    std::list<std::shared_ptr<Node>> children_;
-    float speed_; // roatation speed
-    float distance_; // distance from sun
-    float size_;    // global scaling factor
-
+    int depth_ = 0;
+    NodeHandle handle_;
+    NodeHandle parent_;
+    std::vector<NodeHandle> children_;
+    float speed_ = 1.0f; // roatation speed
+    float distance_ = 0.0f; // distance from sun
+    float size_ = 1.0f;    // global scaling factor
+    // graph owning this node
+    SceneGraph *graph_ = nullptr;
+    // index into the transform store of the graph
+    std::size_t slot_ = TransformStore::npos;
+    // identifier assigned by the graph while reachable from its root, 0 otherwise
+    std::size_t id_ = 0;
+    // interned name in the graph name table
+    std::size_t nameId_ = 0;
+
+    // recompute depth & path of this subtree after the parent changed
+    void updatePath();
+
+    // append drawable descendants in depth-first order
+    void appendDrawable(std::vector<NodeHandle> &drawable) const;
+
+    friend class SceneGraph;
+    friend class TransformStore;
+    friend class NodePool;
+
+protected:
+    Kind kind_ = GROUP;
 
 public:
     // constructor
@@ -28,52 +61,76 @@ public:
 
     explicit Node(std::string name);
 
-    Node(std::string name, std::shared_ptr<Node> const &parent);
+    // nodes are referenced by handle and address, so they are never copied
+    Node(Node const &) = delete;
+
+    Node &operator=(Node const &) = delete;
 
     // destructor
-    ~Node();
+    virtual ~Node();
 
-    // return parent node
-    std::shared_ptr<Node> getParent();
+    // return handle of this node
+    NodeHandle getHandle() const;
 
-    // set parent and update depth & path
-    void setParent(std::shared_ptr<Node> const &parent);
+    // return parent node, invalid for roots
+    NodeHandle getParent() const;
 
-    // search if there is a child with the name and return it
-    std::shared_ptr<Node> getChildren(std::string const &name);
+    // search if there is a descendant with the name and return it
+    // uses the name index of the graph if this node is reachable from the root
+    NodeHandle getChildren(std::string const &name) const;
 
-    // remove child with name
-    std::shared_ptr<Node> removeChildren(std::string const &name);
+    // remove descendant with name, it stays in the graph as a separate tree until it is destroyed or added again
+    NodeHandle removeChildren(std::string const &name);
 
     // return list of children
-    std::list<std::shared_ptr<Node>> getChildrenList();
+    std::vector<NodeHandle> const &getChildrenList() const;
 
     //return all drawable children
-    std::vector<std::shared_ptr<Node>> getDrawable();
+    std::vector<NodeHandle> getDrawable() const;
+
+    // return type tag
+    Kind getKind() const;
 
-    // add a child
-    void addChildren(std::shared_ptr<Node> const &node);
+    // bodies are drawn for group and light nodes, geometry and camera nodes are skipped with their subtree
+    bool isDrawable() const;
+
+    // add a node of the same graph as child, it is removed from its previous parent
+    void addChildren(NodeHandle node);
 
     // print all children (used by the print function of the scenegraph)
-    void printChildren(int level = 0);
+    void printChildren(int level = 0) const;
 
     // return name
-    std::string getName();
+    std::string const &getName() const;
+
+    // return cached path
+    std::string const &getPath() const;
 
-    // return path
-    std::string getPath();
+    // return cached depth
+    int getDepth() const;
 
-    // return depth
-    int getDepth();
+    // return identifier assigned by the graph, 0 while not reachable from the root
+    std::size_t getId() const;
 
-    glm::mat4 getLocalTransform();
+    // references into the transform store of the graph, valid until nodes are created, moved or destroyed
+    glm::mat4 const &getLocalTransform() const;
 
+    // marks the subtree for the next world transform update of the graph
     void setLocalTransform(glm::mat4 const &mat);
 
-    glm::mat4 getWorldTransform();
+    glm::mat4 const &getWorldTransform() const;
 
     void setWorldTransform(glm::mat4 const &mat);
 
+    // sphere around the geometry of this node in local space, center in xyz and radius in w
+    // nodes without a sphere are only culled together with their subtree
+    glm::vec4 const &getBoundingSphere() const;
+
+    void setBoundingSphere(glm::vec4 const &sphere);
+
+    // result of the last SceneGraph::cull, true before the first one
+    bool isVisible() const;
+
     // getter
     float getSpeed() const;
     float getDistance() const;
@@ -0,0 +1,32 @@
+#ifndef OPENGL_FRAMEWORK_NODEHANDLE_HPP
+#define OPENGL_FRAMEWORK_NODEHANDLE_HPP
+
+#include <cstdint>
+
+// weak reference to a node of a scenegraph, resolved with SceneGraph::get()
+// the generation changes when a slot is reused, so handles to destroyed nodes resolve to nullptr
+struct NodeHandle {
+    static const std::uint32_t INVALID = 0xffffffffu;
+
+    std::uint32_t index = INVALID;
+    std::uint32_t generation = 0;
+
+    NodeHandle() = default;
+
+    NodeHandle(std::uint32_t index, std::uint32_t generation) :
+            index{index},
+            generation{generation} {}
+
+    // false for default constructed handles, a true handle may still be stale
+    explicit operator bool() const { return index != INVALID; }
+
+    bool operator==(NodeHandle const &other) const {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator!=(NodeHandle const &other) const {
+        return !(*this == other);
+    }
+};
+
+#endif //OPENGL_FRAMEWORK_NODEHANDLE_HPP
@@ -0,0 +1,93 @@
+#ifndef OPENGL_FRAMEWORK_NODEPOOL_HPP
+#define OPENGL_FRAMEWORK_NODEPOOL_HPP
+
+#include "NodeHandle.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class Node;
+
+// owns the nodes of a scenegraph
+// memory is taken from large blocks and recycled per size, all of it is released with the pool
+class NodePool {
+public:
+    NodePool() = default;
+
+    NodePool(NodePool const &) = delete;
+
+    NodePool &operator=(NodePool const &) = delete;
+
+    NodePool(NodePool &&other);
+
+    NodePool &operator=(NodePool &&other);
+
+    // destroys all remaining nodes
+    ~NodePool();
+
+    // construct a node in the pool, its handle is available through Node::getHandle()
+    template<typename T, typename... Args>
+    T *create(Args &&... args) {
+        static_assert(std::is_base_of<Node, T>::value, "pool only holds nodes");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "node type is over-aligned");
+        void *memory = allocate(sizeof(T));
+        T *node = nullptr;
+        try {
+            node = new(memory) T(std::forward<Args>(args)...);
+        } catch (...) {
+            deallocate(memory, sizeof(T));
+            throw;
+        }
+        insert(node, sizeof(T));
+        return node;
+    }
+
+    // node of the handle, nullptr if it was destroyed
+    Node *get(NodeHandle handle) const;
+
+    // destroy node, all of its handles become stale
+    void destroy(NodeHandle handle);
+
+    // destroy all nodes and release the memory
+    void clear();
+
+    // number of live nodes
+    std::size_t size() const;
+
+private:
+    struct Slot {
+        Node *node;
+        std::uint32_t generation;
+        std::uint32_t size;
+    };
+
+    // nodes are allocated in multiples of this
+    static const std::size_t GRANULARITY = alignof(std::max_align_t);
+    static const std::size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<Slot> slots_;
+    std::vector<std::uint32_t> freeSlots_;
+    std::vector<std::unique_ptr<unsigned char[]>> blocks_;
+    // free bytes at the end of the last block
+    unsigned char *blockFree_ = nullptr;
+    std::size_t blockRemaining_ = 0;
+    // released memory per size class
+    std::vector<std::vector<void *>> freeMemory_;
+    std::size_t live_ = 0;
+
+    void *allocate(std::size_t size);
+
+    void deallocate(void *memory, std::size_t size);
+
+    // assign a slot and set the handle of the node
+    void insert(Node *node, std::size_t size);
+
+    void swap(NodePool &other);
+};
+
+#endif //OPENGL_FRAMEWORK_NODEPOOL_HPP
@@ -8,11 +8,11 @@ private:
     float lightIntensity_;
 
 public:
-    PointLightNode(std::string name, std::shared_ptr<Node> parent);
-    PointLightNode(std::string name, std::shared_ptr<Node> parent, Color color, float lightIntensity);
-    Color getColor();
+    explicit PointLightNode(std::string name);
+    PointLightNode(std::string name, Color color, float lightIntensity);
+    Color const &getColor() const;
     void setColor(Color color);
-    float getLightIntensity();
+    float getLightIntensity() const;
     void setLightIntensity(float lightIntensity);
 };
 #endif //OPENGL_FRAMEWORK_POINTLIGHTNODE_HPP
\ No newline at end of file
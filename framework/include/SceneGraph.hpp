@@ -2,28 +2,181 @@
 #define OPENGL_FRAMEWORK_SCENEGRAPH_HPP
 
 #include "Node.hpp"
+#include "NodePool.hpp"
+#include "TransformStore.hpp"
+#include "ThreadPool.hpp"
+
+#include <unordered_map>
+
+// range over cached node pointers, iterating it does not allocate
+class NodeRange {
+public:
+    NodeRange(Node *const *begin, Node *const *end) :
+            begin_{begin},
+            end_{end} {}
+
+    Node *const *begin() const { return begin_; }
+
+    Node *const *end() const { return end_; }
+
+    std::size_t size() const { return std::size_t(end_ - begin_); }
+
+    bool empty() const { return begin_ == end_; }
+
+private:
+    Node *const *begin_;
+    Node *const *end_;
+};
 
 class SceneGraph {
 private:
     std::string name_;
-    std::shared_ptr<Node> root_;
+    // owns all nodes of the graph
+    NodePool nodes_;
+    NodeHandle root_;
+    // transforms of all nodes
+    TransformStore transforms_;
+    // interned node names
+    std::unordered_map<std::string, std::size_t> nameIds_;
+    // indexed nodes per interned name, in order of indexing
+    std::vector<std::vector<Node *>> nodesByName_;
+    // nodes reachable from the root by path and identifier
+    std::unordered_map<std::string, Node *> nodesByPath_;
+    std::unordered_map<std::size_t, Node *> nodesById_;
+    // next identifier to hand out, 0 is reserved for nodes outside the root tree
+    std::size_t nextId_ = 1;
+    // traversal orders cached until the structure changes
+    std::vector<Node *> depthFirst_;
+    std::vector<Node *> breadthFirst_;
+    std::vector<Node *> renderList_;
+    std::vector<std::size_t> levelStarts_;
+    // store version the caches were built for
+    std::size_t traversalVersion_ = TransformStore::npos;
+    // workers for updates of large graphs, none if updating on the calling thread only
+    std::unique_ptr<ThreadPool> pool_;
 
     void setName(std::string const &name);
 
-    void setRoot(std::shared_ptr<Node> const &node);
+    // give a new node its transform entry and link it below parent, if valid
+    void insert(Node &node, NodeHandle parent);
+
+    // make child the last child of parent, child is unlinked from its previous parent first
+    void link(Node &parent, Node &child);
+
+    // unlink node from its parent, its subtree becomes a separate tree
+    void unlink(Node &node);
+
+    // let all nodes point to this graph
+    void rebind();
+
+    // add node to / remove node from the lookup indices
+    void indexNode(Node &node);
+    void unindexNode(Node &node);
+
+    // same for a whole subtree
+    void indexSubtree(Node &node);
+    void unindexSubtree(Node &node);
+
+    // update path index only, used when a subtree is moved
+    void indexPath(Node &node);
+    void unindexPath(Node &node);
+
+    // rebuild cached traversal orders if the structure changed
+    void updateTraversals();
+
+    // return nodes with the given name, empty if there are none
+    std::vector<Node *> const &getNodesByName(std::string const &name) const;
+
+    friend class Node;
 
 public:
+    // graph without nodes
     SceneGraph() = default;
 
-    SceneGraph(std::string name);
+    // graph with a root node of the given name
+    explicit SceneGraph(std::string name, std::string root_name = "root");
+
+    // nodes point to their graph, so it can only be moved
+    SceneGraph(SceneGraph const &) = delete;
+
+    SceneGraph &operator=(SceneGraph const &) = delete;
+
+    SceneGraph(SceneGraph &&other);
+
+    SceneGraph &operator=(SceneGraph &&other);
+
+    // all nodes are destroyed with the graph
+    ~SceneGraph() = default;
+
+    std::string const &getName() const;
+
+    NodeHandle getRoot() const;
+
+    TransformStore const &getTransforms() const;
+
+    // construct a node of type T from args as last child of parent
+    // without a valid parent the node is the root of a separate tree, which is neither indexed nor traversed
+    // the returned pointer stays valid until the node is destroyed
+    template<typename T, typename... Args>
+    T *create(NodeHandle parent, Args &&... args) {
+        T *node = nodes_.create<T>(std::forward<Args>(args)...);
+        insert(*node, parent);
+        return node;
+    }
+
+    // destroy node and its subtree, their handles become stale
+    void destroy(NodeHandle handle);
+
+    // node of the handle, nullptr if the node was destroyed
+    Node *get(NodeHandle handle) const;
+
+    // same with a cast to the type the node was created with
+    template<typename T>
+    T *get(NodeHandle handle) const {
+        return static_cast<T *>(get(handle));
+    }
+
+    // number of nodes, including separate trees
+    std::size_t size() const;
+
+    // constant time lookups of nodes reachable from the root, return an invalid handle if there is no such node
+    // first indexed node with the given name
+    NodeHandle findByName(std::string const &name) const;
+    // node with the given full path, e.g. "/root/earth/moon"
+    NodeHandle findByPath(std::string const &path) const;
+    // node with the given identifier
+    NodeHandle findById(std::size_t id) const;
+
+    // traversals over the nodes reachable from the root, rebuilt only after structural changes
+    // drawable nodes in depth-first order without the root, see Node::isDrawable
+    NodeRange getRenderList();
+    // all nodes in depth-first pre-order
+    NodeRange depthFirst();
+    // all nodes level by level
+    NodeRange breadthFirst();
+
+    // recompute world transforms of all subtrees whose local transforms changed since the last call
+    // returns the number of recomputed nodes
+    std::size_t updateWorldTransforms();
+
+    // change local transforms of all nodes, see TransformStore::Animation
+    // returns the number of changed nodes, their world transforms are updated by updateWorldTransforms()
+    std::size_t animate(TransformStore::Animation const &animation);
+
+    // update the visibility of all nodes against the view frustum, world transforms must be up to date
+    // returns the number of visible nodes, see TransformStore::cull
+    std::size_t cull(glm::mat4 const &view_projection);
 
-    SceneGraph(std::string name, std::shared_ptr<Node> node);
+    // number of threads used by animate() and updateWorldTransforms(), 1 uses the calling thread only
+    void setThreadCount(unsigned count);
 
-    std::string getName();
+    unsigned getThreadCount() const;
 
-    std::shared_ptr<Node> getRoot() const;
+    // maximal number of nodes per parallel task, see TransformStore::getGrainSize
+    void setGrainSize(std::size_t size);
 
-    std::string printGraph();
+    // prints the node names to stdout, indented by depth
+    void printGraph();
 };
 
 
@@ -0,0 +1,70 @@
+#ifndef OPENGL_FRAMEWORK_THREADPOOL_HPP
+#define OPENGL_FRAMEWORK_THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of workers with one task queue each
+// tasks are split into one contiguous block per worker, workers process their own block front to back
+// and steal from the back of the others once it is empty
+class ThreadPool {
+public:
+    typedef std::function<void(std::size_t)> Task;
+
+    // number of workers including the calling thread, at least one
+    explicit ThreadPool(unsigned workers);
+
+    ThreadPool(ThreadPool const &) = delete;
+
+    ThreadPool &operator=(ThreadPool const &) = delete;
+
+    ~ThreadPool();
+
+    // run task(i) for all i in [0, count) and wait until all are finished
+    // the calling thread works on the tasks as well
+    // if tasks throw, the remaining ones still run and the first exception is rethrown here
+    void run(std::size_t count, Task const &task);
+
+    unsigned size() const;
+
+private:
+    struct Item {
+        Task const *task;
+        std::size_t index;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Item> items;
+    };
+
+    std::vector<std::thread> threads_;
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    // incremented by every run() to wake the workers
+    std::size_t generation_ = 0;
+    std::atomic<std::size_t> remaining_{0};
+    // first exception thrown by a task of the current run, guarded by mutex_
+    std::exception_ptr error_;
+    bool stop_ = false;
+
+    // take from own queue, otherwise steal from the others
+    bool pop(unsigned worker, Item &item);
+
+    // execute tasks until all queues are empty
+    void work(unsigned worker);
+
+    void loop(unsigned worker);
+};
+
+#endif //OPENGL_FRAMEWORK_THREADPOOL_HPP
@@ -0,0 +1,152 @@
+#ifndef OPENGL_FRAMEWORK_TRANSFORMSTORE_HPP
+#define OPENGL_FRAMEWORK_TRANSFORMSTORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "glm/glm.hpp"
+#include "frustum_culling.hpp"
+
+class Node;
+class ThreadPool;
+
+// flat structure-of-arrays storage for all transforms of a scenegraph
+// entries are kept in depth-first pre-order, so every parent is stored before its children
+// and every subtree occupies the contiguous range [index, subtreeEnd(index))
+class TransformStore {
+public:
+    // invalid index, used for the parent of a root and for detached nodes
+    static const std::size_t npos;
+
+    // per entry state bits
+    enum Flag : std::uint8_t {
+        FLAG_ALIVE = 1 << 0,
+        // local transform or parent changed since the last update
+        FLAG_DIRTY = 1 << 1,
+        // bounds of the entry intersect the frustum of the last cull
+        FLAG_VISIBLE = 1 << 2
+    };
+
+    // called for every live entry by animate(), may change the local transform of the given node only
+    // returns true if the local transform was changed
+    typedef std::function<bool(Node &node, glm::mat4 &local)> Animation;
+
+    TransformStore() = default;
+
+    // append a new entry, order is restored by the next linearize()
+    std::size_t insert(Node *node, std::size_t parent, glm::mat4 const &local, glm::mat4 const &world);
+
+    // mark entry as dead, storage is reclaimed by the next linearize()
+    void erase(std::size_t index);
+
+    // change parent of an entry
+    void setParent(std::size_t index, std::size_t parent);
+
+    // restore pre-order and compact dead entries, updates the indices stored in the nodes
+    void linearize();
+
+    // recompute world transforms of all dirty subtrees, returns the number of updated entries
+    // with a pool, subtrees are split into independent ranges that are updated in parallel
+    // results are identical to the serial update
+    std::size_t updateWorldTransforms(ThreadPool *pool = nullptr);
+
+    // apply animation to all live entries, in parallel if a pool is given
+    // returns the number of changed entries, which are marked dirty
+    std::size_t animate(Animation const &animation, ThreadPool *pool = nullptr);
+
+    // update the visible flags of all entries against the frustum of view_projection, returns the number of visible entries
+    // world transforms must be up to date, subtrees whose bounds are completely inside or outside are not descended into
+    // entries without bounds in their whole subtree are never culled
+    std::size_t cull(glm::mat4 const &view_projection);
+
+    // remove all entries without touching the nodes
+    void clear();
+
+    // getter
+    std::size_t size() const;
+    bool isLinear() const;
+    // incremented on every structural change
+    std::size_t getVersion() const;
+    std::size_t getParent(std::size_t index) const;
+    std::size_t getSubtreeEnd(std::size_t index) const;
+    std::uint8_t getFlags(std::size_t index) const;
+    bool isVisible(std::size_t index) const;
+    // bounding sphere in local space, center in xyz and radius in w
+    glm::vec4 const &getBounds(std::size_t index) const;
+    // number of subtrees whose result of the previous cull was reused by the last cull
+    std::size_t getCullReused() const;
+    // maximal number of entries per parallel task, smaller updates stay on the calling thread
+    std::size_t getGrainSize() const;
+    Node *getNode(std::size_t index) const;
+    glm::mat4 const &getLocal(std::size_t index) const;
+    glm::mat4 const &getWorld(std::size_t index) const;
+
+    // setter
+    void setLocal(std::size_t index, glm::mat4 const &mat);
+    void setWorld(std::size_t index, glm::mat4 const &mat);
+    // a negative radius removes the bounds
+    void setBounds(std::size_t index, glm::vec4 const &sphere);
+    void setGrainSize(std::size_t size);
+
+    // raw arrays for batched processing
+    std::size_t const *parents() const;
+    glm::mat4 const *locals() const;
+    glm::mat4 *worlds();
+
+private:
+    std::vector<std::size_t> parents_;
+    std::vector<std::size_t> subtreeEnds_;
+    std::vector<glm::mat4> locals_;
+    std::vector<glm::mat4> worlds_;
+    std::vector<std::uint8_t> flags_;
+    std::vector<glm::vec4> bounds_;
+    std::vector<Node *> nodes_;
+    // true if entries are in pre-order without dead entries
+    bool linear_ = true;
+    std::size_t version_ = 0;
+    // entries flagged dirty since the last update
+    std::vector<std::size_t> dirty_;
+
+    // flag entry and remember it for the next update
+    void markDirty(std::size_t index);
+
+    // update world transforms of the range [begin, end) whose parents outside the range are up to date
+    void propagate(std::size_t begin, std::size_t end);
+
+    // split the subtree range [index, end) into independent task ranges of at most grain size
+    // roots of larger subtrees are updated right away, as all ranges below depend on them
+    void split(std::size_t index, std::size_t end);
+
+    std::size_t grainSize_ = 4096;
+    // dirty subtree ranges of the current update and the independent ranges they are split into
+    std::vector<std::pair<std::size_t, std::size_t>> ranges_;
+    std::vector<std::pair<std::size_t, std::size_t>> tasks_;
+    // entries dirtied by each parallel animation task
+    std::vector<std::vector<std::size_t>> animated_;
+
+    // world bounds of every entry and of its subtree, subtree bounds of the previous cull
+    std::vector<glm::vec4> worldBounds_;
+    std::vector<glm::vec4> subtreeBounds_;
+    std::vector<glm::vec4> previousBounds_;
+    // result per subtree of the previous cull, intersecting if it was not tested
+    // reset whenever the structure changed since the previous cull
+    std::vector<frustum_culling::result> cullResults_;
+    // plane which rejected a subtree outside of the frustum, tested first by the next cull
+    std::vector<std::uint8_t> rejectingPlanes_;
+    frustum_culling::frustum frustum_;
+    std::size_t cullVersion_ = npos;
+    std::size_t cullReused_ = 0;
+
+    // set or clear the visible flag of [begin, end) and forget their previous results
+    void setVisible(std::size_t begin, std::size_t end, bool visible);
+
+    // scratch buffers reused by linearize() to avoid reallocation
+    std::vector<std::size_t> order_;
+    std::vector<std::size_t> remap_;
+    std::vector<std::size_t> firstChild_;
+    std::vector<std::size_t> nextSibling_;
+};
+
+#endif //OPENGL_FRAMEWORK_TRANSFORMSTORE_HPP
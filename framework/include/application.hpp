@@ -2,10 +2,13 @@
 #define APPLICATION_HPP
 
 #include "structs.hpp"
+#include "shader_loader.hpp"
 
 #include <glm/gtc/type_precision.hpp>
 
 #include <map>
+#include <string>
+#include <vector>
 
 struct GLFWwindow;
 // gpu representation of model
@@ -31,6 +34,8 @@ class Application {
 // functiosn which are implemented in derived classes
   // update uniform locations and values
   inline virtual void uploadUniforms() {};
+  // recompile programs which are not in m_shaders, like the shader reload
+  inline virtual void reloadPrograms(bool throwing) {};
   // react to key input
   inline virtual void keyCallback(int key, int action, int mods) {};
   //handle delta mouse movement input
@@ -42,11 +47,17 @@ class Application {
 
  protected:
   void updateUniformLocations();
+  // name of the variant of a program with additional defines, compiled and added to m_shaders on first request
+  // variants are named like "planet+CEL_SHADING" and are reloaded with all other programs
+  std::string shaderVariant(std::string const& name, std::vector<std::string> const& defines);
 
   std::string m_resource_path; 
 
   // container for the shader programs
   std::map<std::string, shader_program> m_shaders{};
+  // compiled programs by sources and defines, switching between loaded variants needs no compilation
+  // binaries are kept in the shader_cache directory of the resources to skip compilation on later runs
+  shader_loader::program_cache m_programs;
 
   // resolution when 
   static const glm::uvec2 initial_resolution; 
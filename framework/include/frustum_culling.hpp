@@ -0,0 +1,44 @@
+#ifndef FRUSTUM_CULLING_HPP
+#define FRUSTUM_CULLING_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+// bounding sphere tests against a view frustum
+// spheres are stored as vec4 with the center in xyz and the radius in w, a negative radius marks an empty sphere
+namespace frustum_culling {
+  enum result : std::uint8_t {
+    OUTSIDE = 0,
+    INTERSECTING = 1,
+    INSIDE = 2
+  };
+
+  // planes of a frustum as structure of arrays, normals point inwards
+  // padded to eight planes which accept everything, so two SSE registers hold one component
+  struct frustum {
+    alignas(16) float x[8];
+    alignas(16) float y[8];
+    alignas(16) float z[8];
+    alignas(16) float w[8];
+  };
+
+  // extract the six normalized planes of projection * view
+  frustum extract(glm::mat4 const& view_projection);
+
+  // position of sphere relative to frustum, uses SSE if matrix_kernels allows it
+  // if given, plane receives the index of the first plane the sphere is outside of
+  result classify(frustum const& planes, glm::vec4 const& sphere, std::uint8_t* plane = nullptr);
+
+  // true if sphere is completely behind a single plane, cheap test for the plane which rejected it last time
+  bool outside(frustum const& planes, glm::vec4 const& sphere, std::uint8_t plane);
+
+  // out[i] = spheres[i] transformed by worlds[i], the radius is scaled by the largest axis scale
+  void transform(glm::mat4 const* worlds, glm::vec4 const* spheres, glm::vec4* out, std::size_t count);
+
+  // smallest sphere containing both, empty spheres are ignored
+  glm::vec4 merge(glm::vec4 const& a, glm::vec4 const& b);
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// read only view of a whole file, mapped where the platform supports it and read into memory otherwise
+class mapped_file {
+ public:
+  // empty view
+  mapped_file();
+  // throws std::logic_error if the file can not be opened or mapped
+  explicit mapped_file(std::string const& path);
+  ~mapped_file();
+
+  mapped_file(mapped_file const&) = delete;
+  mapped_file& operator=(mapped_file const&) = delete;
+  mapped_file(mapped_file&& other);
+  mapped_file& operator=(mapped_file&& other);
+
+  // nullptr for empty files
+  char const* data() const;
+  std::size_t size() const;
+
+ private:
+  void release();
+
+  char const* m_data;
+  std::size_t m_size;
+  bool m_mapped;
+  // content if the file is not mapped
+  std::vector<char> m_buffer;
+};
+
+// write size bytes of data to path through a temporary file with a name unique to the process and call,
+// which then replaces path, so concurrent readers and writers never see a partial file, false on failure
+// on Windows the old file is removed before the rename, so path is missing for a moment
+bool replace_file(std::string const& path, char const* data, std::size_t size);
+
+#endif
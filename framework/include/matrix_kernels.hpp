@@ -0,0 +1,42 @@
+#ifndef MATRIX_KERNELS_HPP
+#define MATRIX_KERNELS_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// batched 4x4 matrix operations with SSE/AVX implementations selected at runtime
+// all implementations add in the same order as glm, so results are identical on every path
+namespace matrix_kernels {
+  // instruction set levels, ordered by preference
+  enum isa {
+    SCALAR = 0,
+    SSE = 1,
+    AVX = 2
+  };
+
+  // best instruction set supported by cpu and os
+  isa supported_isa();
+  // instruction set currently used by the kernels
+  isa active_isa();
+  // force an instruction set, clamped to the supported one, returns the selected one
+  isa set_isa(isa requested);
+  // name of instruction set for output
+  char const* isa_name(isa level);
+
+  // out[i] = lhs[i] * rhs[i], out may alias lhs or rhs
+  void multiply(glm::mat4 const* lhs, glm::mat4 const* rhs, glm::mat4* out, std::size_t count);
+  // out[i] = lhs * rhs[i], e.g. view * model, out may alias rhs
+  void multiply(glm::mat4 const& lhs, glm::mat4 const* rhs, glm::mat4* out, std::size_t count);
+
+  // worlds[i] = worlds[parents[i]] * locals[i] for i in [begin, end)
+  // parents must be stored before their children, entries with a parent index not below their own are roots
+  void propagate(std::size_t const* parents, glm::mat4 const* locals, glm::mat4* worlds,
+                 std::size_t begin, std::size_t end);
+
+  // out[i] = inverse transpose of view * models[i]
+  // only the upper 3x3 is computed, the remaining entries are those of the identity
+  void normal_matrices(glm::mat4 const& view, glm::mat4 const* models, glm::mat4* out, std::size_t count);
+}
+
+#endif
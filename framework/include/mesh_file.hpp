@@ -0,0 +1,80 @@
+#ifndef MESH_FILE_HPP
+#define MESH_FILE_HPP
+
+#include "model.hpp"
+#include "mapped_file.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// model in a versioned binary format: header with the layout of model::VERTEX_ATTRIBS or model::PACKED_ATTRIBS,
+// the bounds and the dequantization of packed positions,
+// followed by the interleaved vertices and the indices, both can be passed to glBufferData as they are
+// files are mapped read only, so loading needs no parsing and no copy
+class mesh_file {
+ public:
+  // files of other versions or with another attribute layout are rejected
+  static const std::uint32_t version;
+
+  // empty mesh
+  mesh_file();
+  // mesh in memory, size and modification time in nanoseconds identify the file the model was loaded from
+  mesh_file(model const& mesh, model::attrib_flag_t import_attribs,
+            std::uint64_t source_size = 0, std::int64_t source_time = 0);
+  // map the file, throws std::logic_error if it can not be opened or is no valid mesh file
+  explicit mesh_file(std::string const& path);
+  ~mesh_file();
+
+  mesh_file(mesh_file const&) = delete;
+  mesh_file& operator=(mesh_file const&) = delete;
+  mesh_file(mesh_file&& other);
+  mesh_file& operator=(mesh_file&& other);
+
+  // write to path, false if the file could not be written
+  bool write(std::string const& path) const;
+
+  // whether the mesh was created from the source with these attributes
+  bool matches(model::attrib_flag_t import_attribs, std::uint64_t source_size, std::int64_t source_time) const;
+
+  model::attrib_flag_t attributes() const;
+  // size of one vertex in bytes
+  GLsizei vertex_bytes() const;
+  std::size_t vertex_num() const;
+  std::size_t index_num() const;
+  // interleaved vertices, vertex_num() * vertex_bytes() bytes
+  void const* vertices() const;
+  GLuint const* indices() const;
+  // byte offset of the attribute in a vertex for glVertexAttribPointer
+  GLvoid* offset(model::attrib_flag_t attribute) const;
+  // whether the vertices use model::PACKED_ATTRIBS
+  bool packed() const;
+  // description of the attribute in a vertex for glVertexAttribPointer
+  model::attribute const& layout(model::attrib_flag_t attribute) const;
+  // packed positions are position_offset() + position_scale() * position
+  glm::fvec3 position_scale() const;
+  glm::fvec3 position_offset() const;
+  glm::fvec4 bounding_sphere() const;
+
+  // copy of the data as model
+  model to_model() const;
+
+ private:
+  struct header;
+
+  header const& head() const;
+  // check the header against the size of the data, throws std::logic_error
+  void validate(std::string const& path) const;
+  void release();
+
+  // start of the header, either in m_file or in m_buffer
+  char const* m_data;
+  std::size_t m_size;
+  mapped_file m_file;
+  std::vector<char> m_buffer;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+
+#include "model.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// reorders indexed triangle meshes for the post-transform vertex cache and for vertex fetch locality
+namespace mesh_optimizer {
+  // marks vertices which are removed by a remap
+  static const GLuint removed = ~GLuint(0);
+
+  // simulated post-transform cache behavior of an index buffer
+  struct cache_statistics {
+    // average cache miss ratio, transformed vertices per triangle, between 0.5 and 3
+    float acmr;
+    // average transform to vertex ratio, transformed vertices per referenced vertex, 1 is optimal
+    float atvr;
+  };
+
+  // statistics for a fifo cache with cache_size entries
+  cache_statistics analyze(std::vector<GLuint> const& indices, std::size_t vertex_num, unsigned cache_size = 16);
+
+  // remap of each vertex to the first vertex with identical bytes, returns the number of distinct vertices
+  std::size_t deduplicate(std::vector<GLfloat> const& data, std::size_t vertex_num, std::vector<GLuint>& remap);
+
+  // triangles in the order of Tom Forsyth's linear-speed vertex cache optimisation,
+  // which greedily emits the triangle with the highest score of its vertices in a simulated lru cache
+  // and continues with the highest scoring remaining triangle once no cached vertex has triangles left
+  std::vector<GLuint> optimize_cache(std::vector<GLuint> const& indices, std::size_t vertex_num);
+
+  // remap of the vertices in order of their first use, unreferenced vertices are removed
+  // returns the number of referenced vertices
+  std::size_t optimize_fetch(std::vector<GLuint> const& indices, std::size_t vertex_num, std::vector<GLuint>& remap);
+
+  // statistics of a whole optimization
+  struct report {
+    cache_statistics before;
+    cache_statistics after;
+    std::size_t vertices_before;
+    std::size_t vertices_after;
+  };
+
+  // model with duplicate vertices merged, triangles ordered for the vertex cache and vertices by first use
+  model optimize(model const& mesh, report* result = nullptr);
+}
+
+#endif
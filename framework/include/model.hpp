@@ -2,6 +2,7 @@
 #define MODEL_HPP
 
 #include <glbinding/gl/types.h>
+#include <glm/glm.hpp>
 
 #include <map>
 #include <vector>
@@ -16,11 +17,12 @@ struct model {
   // type holding info about a vertex/model attribute
   struct attribute {
 
-    attribute(attrib_flag_t f, GLsizei s, GLsizei c, GLenum t)
+    attribute(attrib_flag_t f, GLsizei s, GLsizei c, GLenum t, bool n = false)
      :flag{f}
      ,size{s}
      ,components{c}
      ,type{t}
+     ,normalized{n}
     {}
 
     // conversion to flag type for use as enum
@@ -28,31 +30,47 @@ struct model {
       return flag;
     }
 
+    // bytes in a vertex, padded to whole words so the following attributes stay aligned
+    GLsizei bytes() const;
+
     // ugly enum to use as flag, must be unique power of two
     attrib_flag_t flag;
-    // size in bytes
+    // size in bytes of a component, of the whole word for GL_INT_2_10_10_10_REV
     GLsizei size;
     // number of scalar components
     GLint components;
     // Gl type
     GLenum type;
+    // integer types are mapped to [0, 1] or [-1, 1] for glVertexAttribPointer
+    bool normalized;
     // offset from element beginning
     GLvoid* offset;
   };
 
   // holds all possible vertex attributes, for iteration
   static std::vector<attribute> const VERTEX_ATTRIBS;
+  // same attributes in packed encodings: normalized 16 bit positions, 2_10_10_10 normals and tangents
+  // and half float texture coordinates, see vertex_quantization
+  static std::vector<attribute> const PACKED_ATTRIBS;
+  // descriptions of float or packed vertices
+  static std::vector<attribute> const& vertex_attribs(bool packed);
   // symbolic values to access valuesin vector by name
   static attribute const& POSITION;
   static attribute const& NORMAL;
   static attribute const& TEXCOORD;
+  // direction of increasing u in xyz and the sign of the bitangent in w, see tangent_space
   static attribute const& TANGENT;
   static attribute const& BITANGENT;
   // is not a vertex attribute, so not stored in VERTEX_ATTRIBS
   static attribute const  INDEX;
   
   model();
-  model(std::vector<GLfloat> const& databuff, attrib_flag_t attribs, std::vector<GLuint> const& trianglebuff = std::vector<GLuint>{});
+  // packed vertices are stored as raw words in databuff, their bounding sphere is not computed
+  model(std::vector<GLfloat> const& databuff, attrib_flag_t attribs, std::vector<GLuint> const& trianglebuff = std::vector<GLuint>{},
+        bool packed = false);
+
+  // description of a contained attribute for glVertexAttribPointer
+  attribute const& layout(attrib_flag_t attribute) const;
 
   std::vector<GLfloat> data;
   std::vector<GLuint> indices;
@@ -61,6 +79,13 @@ struct model {
   // size of one vertex element in bytes
   GLsizei vertex_bytes;
   std::size_t vertex_num;
+  // sphere around all positions, center in xyz and radius in w, negative radius if there are none
+  glm::fvec4 bounding_sphere;
+  // whether data holds PACKED_ATTRIBS instead of VERTEX_ATTRIBS
+  bool packed;
+  // packed positions are in [0, 1], the original position is position_offset + position_scale * position
+  glm::fvec3 position_scale;
+  glm::fvec3 position_offset;
 };
 
 #endif
\ No newline at end of file
@@ -2,13 +2,32 @@
 #define MODEL_LOADER_HPP
 
 #include "model.hpp"
+#include "mesh_file.hpp"
 
 #include "tiny_obj_loader.h"
 
+class ThreadPool;
+
 namespace model_loader {
 
+// import option, not a vertex attribute: duplicate vertices are merged and triangles and vertices
+// are reordered for the vertex cache and fetch locality, see mesh_optimizer
+static const model::attrib_flag_t OPTIMIZE = 1 << 16;
+// import option, vertices are stored in the encodings of model::PACKED_ATTRIBS, see vertex_quantization
+static const model::attrib_flag_t QUANTIZE = 1 << 17;
+
 model obj(std::string const& path, model::attrib_flag_t import_attribs = model::POSITION);
 
+// same result as obj(), parsed from the mapped file in line aligned chunks which are distributed over the pool
+// materials are ignored, groups, objects and usemtl start new shapes like in tinyobjloader
+model obj_parallel(std::string const& path, model::attrib_flag_t import_attribs = model::POSITION,
+                   ThreadPool* pool = nullptr);
+
+// obj as mapped binary mesh, the mesh file path + ".mesh" is written on the first load
+// and again whenever the obj or the requested attributes change, later loads do not parse the obj
+mesh_file obj_mapped(std::string const& path, model::attrib_flag_t import_attribs = model::POSITION,
+                     ThreadPool* pool = nullptr);
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,120 @@
+#ifndef POST_CHAIN_HPP
+#define POST_CHAIN_HPP
+
+#include "structs.hpp"
+#include "shader_loader.hpp"
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// one full screen pass of a post_chain
+struct post_pass {
+  enum buffer_t {
+    // color texture the scene was rendered into
+    SCENE,
+    // intermediate texture of the same size
+    PING,
+    // default framebuffer
+    SCREEN
+  };
+  // index of the separable effect, or npos for the final pass
+  std::size_t separable;
+  // direction of a separable pass
+  bool horizontal;
+  // composite effects folded into the final pass
+  unsigned composite;
+  buffer_t source;
+  buffer_t target;
+};
+
+// full screen effects between the rendered scene and the default framebuffer
+// every combination of enabled effects runs specialized programs without branches,
+// they are resolved through a program_cache by reload(), which owns them and stores their binaries
+// without enabled effects the scene is rendered into the default framebuffer and no pass runs
+class post_chain {
+ public:
+  // flag of a registered effect
+  typedef unsigned effect;
+  static const std::size_t npos;
+
+  // shaders of the final pass, the vertex shader is used by all passes
+  // programs are requested from cache, which must outlive the chain
+  post_chain(shader_loader::program_cache& cache, std::string const& vertex_shader,
+             std::string const& composite_shader);
+  ~post_chain();
+
+  // targets are owned by the chain
+  post_chain(post_chain const&) = delete;
+  post_chain& operator=(post_chain const&) = delete;
+
+  // effect applied in the final pass, its code in the composite shader is enabled by define
+  effect add_composite(std::string const& define);
+  // effect of a horizontal and a vertical pass of fragment_shader, compiled with HORIZONTAL or VERTICAL defined
+  // runs before the final pass, over the scene texture and one intermediate texture
+  effect add_separable(std::string const& fragment_shader);
+
+  void enable(effect flag, bool enabled);
+  void toggle(effect flag);
+  bool enabled(effect flag) const;
+  bool active() const;
+
+  // passes for the enabled effects, separable effects in order of registration, the last pass ends on the screen
+  std::vector<post_pass> plan() const;
+
+  // create targets of the given size, only needed if effects are enabled
+  void resize(unsigned width, unsigned height);
+  // framebuffer to render the scene into, 0 if no effect is enabled
+  GLuint target() const;
+  // run the passes with a full screen quad, the default framebuffer is bound afterwards
+  // nothing is drawn if a program of the enabled effects was not loaded by reload()
+  void execute(GLuint quad_vertex_array, GLenum mode, GLsizei count);
+
+  // request the programs of the enabled effects and of all variants loaded before from the cache,
+  // so they survive its next sweep, throws like program_cache::get if throwing,
+  // otherwise failed variants keep their previous program
+  // returns whether all programs of the enabled effects are available
+  bool reload(bool throwing);
+
+ private:
+  struct program {
+    GLuint handle;
+    GLint screen_texture;
+    GLint texture_size;
+  };
+
+  struct composite_effect {
+    effect flag;
+    std::string define;
+  };
+
+  struct separable_effect {
+    effect flag;
+    std::string fragment_shader;
+  };
+
+  // separable index, direction and composite flags of a pass
+  typedef std::tuple<std::size_t, bool, unsigned> variant_key;
+
+  effect next_flag() const;
+  // request the program of the variant, false if it failed and there is no previous one
+  bool request(variant_key const& key, bool throwing);
+  void release_targets();
+
+  shader_loader::program_cache& m_cache;
+  std::string m_vertex_shader;
+  std::string m_composite_shader;
+  std::vector<composite_effect> m_composites;
+  std::vector<separable_effect> m_separables;
+  unsigned m_enabled;
+  // programs owned by the cache by variant
+  std::map<variant_key, program> m_programs;
+
+  unsigned m_width;
+  unsigned m_height;
+  framebuffer_object m_scene;
+  framebuffer_object m_ping;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include "structs.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// one draw call together with the state it needs
+struct draw_command {
+  enum kind_t {
+    ARRAYS,
+    ELEMENTS,
+    // glMultiDrawArrays with firsts and counts, count is the number of draws
+    MULTI_ARRAYS
+  };
+  // number of texture units a command can bind, starting at GL_TEXTURE0
+  static const std::size_t max_textures = 3;
+
+  // order of execution, see render_queue::key
+  std::uint64_t key = 0;
+
+  GLuint program = 0;
+  GLuint vertex_array = 0;
+  // texture per unit, units with target GL_NONE are left as they are
+  std::array<texture_object, max_textures> textures{};
+  bool depth_write = true;
+
+  kind_t kind = ELEMENTS;
+  GLenum mode = GL_TRIANGLES;
+  // type of the bound element buffer
+  GLenum index_type = GL_UNSIGNED_INT;
+  // first vertex for ARRAYS, byte offset into the element buffer for ELEMENTS
+  GLint first = 0;
+  GLsizei count = 0;
+  // instanced draw if greater than one
+  GLsizei instances = 1;
+  GLint const* firsts = nullptr;
+  GLsizei const* counts = nullptr;
+
+  // optional, sets uniforms which differ between draws after the program was bound
+  void (*uniforms)(draw_command const& command) = nullptr;
+  // passed through to uniforms
+  void const* data = nullptr;
+  GLint parameter = 0;
+};
+
+// collects draw commands of all passes and executes them sorted by key,
+// state which is already bound is not bound again
+class render_queue {
+ public:
+  // sort key from most to least significant: pass (8 bit), program (12 bit), vertex array (12 bit),
+  // first texture (16 bit) and depth in [0, 1] (16 bit)
+  // handles only influence the order, collisions in the masked bits are harmless
+  static std::uint64_t key(unsigned pass, GLuint program, GLuint vertex_array, GLuint texture = 0, float depth = 0.0f);
+
+  void submit(draw_command const& command);
+
+  // remove all commands, capacity is kept for the next frame
+  void clear();
+
+  // order commands by key, commands with equal keys keep their submission order
+  void sort();
+
+  // sort and issue all commands, then clear the queue
+  // returns the number of state changes which were issued
+  std::size_t execute();
+
+  // in submission order, or in execution order after sort()
+  std::vector<draw_command> const& commands() const;
+
+ private:
+  std::vector<draw_command> m_commands;
+};
+
+#endif
@@ -1,17 +1,79 @@
 #ifndef SHADER_LOADER_HPP
 #define SHADER_LOADER_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <glbinding/gl/enum.h>
 using namespace gl;
 
 namespace shader_loader {
-  // compile shader
-  unsigned shader(std::string const& file_path, GLenum shader_type);
-  // create program from given list of stages
-  unsigned program(std::map<GLenum, std::string> const&);
+  // compile shader, defines are inserted after the #version line, e.g. "BLUR" or "TAPS 9"
+  unsigned shader(std::string const& file_path, GLenum shader_type,
+                  std::vector<std::string> const& defines = std::vector<std::string>{});
+  // create program from given list of stages, all stages get the same defines
+  unsigned program(std::map<GLenum, std::string> const&,
+                   std::vector<std::string> const& defines = std::vector<std::string>{});
+
+  // 64 bit FNV-1a hash of the sources by stage
+  std::uint64_t hash(std::map<GLenum, std::string> const& sources);
+  // 64 bit FNV-1a hash of the data, continuing from a previous hash
+  std::uint64_t hash(std::string const& data, std::uint64_t value = 0xcbf29ce484222325ull);
+
+  // linked programs by the hash of their sources with includes expanded and their defines
+  // a program is only compiled again if one of its files changed, so reloads and variant switches are lookups
+  // with a binary directory, linked programs are also stored there with glGetProgramBinary and loaded
+  // by later runs on the same driver, binaries rejected by the driver are compiled again and replaced
+  class program_cache {
+   public:
+    // directory ending with a separator, empty to only cache in memory
+    explicit program_cache(std::string const& binary_directory = std::string{});
+    // deletes all programs
+    ~program_cache();
+
+    program_cache(program_cache const&) = delete;
+    program_cache& operator=(program_cache const&) = delete;
+
+    // program of the stages with the defines, compiled on first request, throws like program()
+    // reads all source files to compute the key, so handles should be kept by the caller
+    unsigned get(std::map<GLenum, std::string> const& stages,
+                 std::vector<std::string> const& defines = std::vector<std::string>{});
+
+    // mark a program as requested, e.g. when it stays in use because its replacement failed to compile
+    void keep(unsigned handle);
+
+    // delete programs which were not requested since the previous sweep, returns their number
+    std::size_t sweep();
+
+    // delete all programs
+    void clear();
+
+    std::size_t size() const;
+
+   private:
+    struct entry {
+      unsigned handle;
+      bool used;
+    };
+
+    // whether the context supports program binaries, queried on first use
+    bool binaries_supported();
+    // program stored under the key, 0 if there is none or the driver rejects it
+    unsigned load_binary(std::string const& file, std::uint64_t key) const;
+    // failures are ignored, the program is compiled again next run
+    void store_binary(std::string const& file, std::uint64_t key, unsigned program) const;
+
+    std::map<std::pair<std::uint64_t, std::string>, entry> m_programs;
+    std::string m_directory;
+    // vendor, renderer and version, binaries are only valid for the driver which created them
+    std::string m_driver;
+    // number of binary formats, -1 if not queried yet
+    int m_binary_formats;
+  };
 }
 
 #endif
@@ -0,0 +1,36 @@
+#ifndef SPHERE_LOD_HPP
+#define SPHERE_LOD_HPP
+
+#include "model.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// procedural unit spheres in several levels of detail and the choice between them
+namespace sphere_lod {
+  // indices of one level in the element buffer of a chain
+  struct level {
+    // offset in indices, not bytes
+    GLsizei first;
+    GLsizei count;
+  };
+
+  // unit sphere from a subdivided icosahedron with 20 * 4^subdivisions triangles
+  // with positions, normals, equirectangular texture coordinates and tangents,
+  // vertices are duplicated along the seam and at the poles
+  model icosphere(unsigned subdivisions);
+
+  // icospheres with 0 to count - 1 subdivisions in one model, levels receives the index range of each
+  model chain(unsigned count, std::vector<level>& levels);
+
+  // radius in pixels of a sphere with center in view space, huge if the camera is inside
+  float screen_radius(glm::vec3 const& view_center, float radius, glm::mat4 const& projection, float viewport_height);
+
+  // level of a chain with count levels whose triangle edges are about edge_pixels long on screen
+  // the level only changes from previous if radius_pixels is past the boundary by the hysteresis fraction
+  unsigned select(float radius_pixels, unsigned previous, unsigned count,
+                  float edge_pixels = 10.0f, float hysteresis = 0.2f);
+}
+
+#endif
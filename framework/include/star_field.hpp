@@ -0,0 +1,73 @@
+#ifndef STAR_FIELD_HPP
+#define STAR_FIELD_HPP
+
+#include "frustum_culling.hpp"
+
+#include <glbinding/gl/types.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+// use gl definitions from glbinding
+using namespace gl;
+
+class ThreadPool;
+
+// vertex of the star buffer
+struct star {
+  glm::fvec3 position;
+  glm::fvec3 color;
+  // apparent magnitude, smaller is brighter
+  float magnitude;
+};
+static_assert(sizeof(star) == 7 * sizeof(float), "star must be tightly packed");
+
+// stars in one cell of the grid, stored contiguously from the brightest to the faintest
+struct star_chunk {
+  // sphere around all stars of the chunk, center in xyz and radius in w
+  glm::fvec4 bounds;
+  GLint first;
+  GLsizei count;
+};
+
+// random number in [0, 1) which only depends on seed and counter, so it is the same on every thread
+float counter_random(std::uint64_t seed, std::uint64_t counter);
+
+// stars in a ball around the origin, generated in parallel and sorted into a grid of chunks
+// the result only depends on the parameters, not on the number of threads
+class star_field {
+ public:
+  struct parameters {
+    std::size_t count = 1000000;
+    std::uint64_t seed = 1;
+    // radius of the ball
+    float radius = 50.0f;
+    // the grid divides the bounding cube of the ball into chunks_per_axis^3 cells
+    unsigned chunks_per_axis = 8;
+    // range of apparent magnitudes, fainter stars are more frequent
+    float brightest = -1.0f;
+    float faintest = 8.0f;
+  };
+
+  star_field();
+  explicit star_field(parameters const& params, ThreadPool* pool = nullptr);
+
+  // all stars, sorted by chunk
+  std::vector<star> const& stars() const;
+  // chunks with at least one star
+  std::vector<star_chunk> const& chunks() const;
+
+  // ranges of the chunks inside the frustum, returns the number of selected stars
+  // chunks further away from eye than full_detail_distance only contribute their brightest stars,
+  // the fraction falls with the squared distance down to min_fraction
+  std::size_t select(frustum_culling::frustum const& planes, glm::fvec3 const& eye,
+                     float full_detail_distance, float min_fraction,
+                     std::vector<GLint>& firsts, std::vector<GLsizei>& counts) const;
+
+ private:
+  std::vector<star> m_stars;
+  std::vector<star_chunk> m_chunks;
+};
+
+#endif
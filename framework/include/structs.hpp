@@ -2,7 +2,12 @@
 #define STRUCTS_HPP
 
 #include <map>
+#include <string>
+#include <vector>
 #include <glbinding/gl/gl.h>
+#include <glm/gtc/type_precision.hpp>
+
+#include "uniforms.hpp"
 // use gl definitions from glbinding 
 using namespace gl;
 
@@ -30,16 +35,36 @@ struct texture_object {
 
 // shader handle and uniform storage
 struct shader_program {
-  shader_program(std::map<GLenum, std::string> paths)
-   : shader_paths{paths}, handle{0} {}
+  shader_program(std::map<GLenum, std::string> paths, std::vector<std::string> defs = std::vector<std::string>{})
+   : shader_paths{paths}, defines{defs}, handle{0} {}
 
     // paths to shader sources
     std::map<GLenum, std::string> shader_paths;
+    // preprocessor defines injected into all stages
+    std::vector<std::string> defines;
     // object handle
     GLuint handle;
     // uniform locations mapped to name
     std::map<std::string, GLint> u_locs{};
+    // locations of the active uniforms with a compile time id, reflected after linking
+    uniform::table locations = uniform::empty_table();
+};
+
+// per frame values shared by all programs through one uniform buffer
+// mirrors the std140 block FrameData in resources/shaders/frame_data.glsl
+struct frame_data {
+  glm::fmat4 view_matrix;
+  glm::fmat4 projection_matrix;
+  // world space, w = 1
+  glm::fvec4 light_position;
+  // rgb in [0, 1], intensity in a
+  glm::fvec4 light_color;
+  glm::fvec2 viewport_size;
+  float time;
+  // std140 rounds the block size up to 16 bytes
+  float padding;
 };
+static_assert(sizeof(frame_data) == 176, "frame_data must match the std140 layout of FrameData");
 
 // create the framebuffer object
 // texture -> color attachment
@@ -0,0 +1,31 @@
+#ifndef TANGENT_SPACE_HPP
+#define TANGENT_SPACE_HPP
+
+#include <glbinding/gl/types.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+// use gl definitions from glbinding
+using namespace gl;
+
+class ThreadPool;
+
+// vertex normals and tangent frames of indexed triangle meshes, computed at load time
+// faces are processed in ranges distributed over the pool, four at a time with SSE if
+// matrix_kernels::active_isa() allows it, vertices then gather the values of their corners in index order,
+// so results are identical for every pool size and instruction set
+namespace tangent_space {
+  // area weighted normals of the adjacent faces, {0, 0, 1} for vertices without area
+  std::vector<glm::fvec3> normals(std::vector<glm::fvec3> const& positions, std::vector<GLuint> const& indices,
+                                  ThreadPool* pool = nullptr);
+
+  // tangents following MikkTSpace: the uv aligned frame of each face is projected into the tangent plane
+  // of the corner normal and weighted by the corner angle, xyz is the unit tangent in direction of
+  // increasing u and w the sign of the bitangent, which is w * cross(normal, tangent)
+  // vertices are not split where the frames of their faces disagree, unlike in MikkTSpace
+  std::vector<glm::fvec4> tangents(std::vector<glm::fvec3> const& positions, std::vector<glm::fvec3> const& normals,
+                                   std::vector<glm::fvec2> const& texcoords, std::vector<GLuint> const& indices,
+                                   ThreadPool* pool = nullptr);
+}
+
+#endif
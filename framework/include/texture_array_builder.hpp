@@ -0,0 +1,53 @@
+#ifndef TEXTURE_ARRAY_BUILDER_HPP
+#define TEXTURE_ARRAY_BUILDER_HPP
+
+#include "pixel_data.hpp"
+#include "structs.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// position of a logical texture in the arrays of a texture_array_builder
+struct texture_layer {
+  // index into the texture objects returned by build()
+  unsigned array;
+  // layer in that array
+  GLint layer;
+};
+
+// packs textures of equal size and format into GL_TEXTURE_2D_ARRAYs,
+// so many textures can be sampled through one bound texture and a layer index
+class texture_array_builder {
+ public:
+  // with a layer size, all textures are resampled to it and share one array per format
+  texture_array_builder(std::size_t width = 0, std::size_t height = 0);
+
+  // add a texture, returns where it will be stored
+  texture_layer add(pixel_data const& texture);
+
+  // number of arrays
+  std::size_t size() const;
+  // number of layers of an array
+  std::size_t layers(unsigned array) const;
+
+  // upload all arrays with full mip chains, one texture object per array
+  std::vector<texture_object> build() const;
+
+ private:
+  struct array_data {
+    std::size_t width;
+    std::size_t height;
+    GLenum channels;
+    GLenum channel_type;
+    std::vector<pixel_data> layers;
+  };
+
+  std::size_t m_width;
+  std::size_t m_height;
+  std::vector<array_data> m_arrays;
+};
+
+// bilinear resampling of 8 bit textures
+pixel_data resample(pixel_data const& texture, std::size_t width, std::size_t height);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef UNIFORMS_HPP
+#define UNIFORMS_HPP
+
+#include <glbinding/gl/types.h>
+
+#include <array>
+#include <string>
+// use gl definitions from glbinding
+using namespace gl;
+
+// compile time ids of the uniforms used in resources/shaders
+// locations are reflected once per shader reload, setting a uniform is an array index
+namespace uniform {
+  enum id : unsigned {
+    MODEL_MATRICES,
+    INSTANCES,
+    FIRST_INSTANCE,
+    MATERIAL_COLORS,
+    TEXTURE_SAMPLER,
+    NORMAL_SAMPLER,
+    SCREEN_TEXTURE,
+    TEXTURE_SIZE,
+    POSITION_SCALE,
+    POSITION_OFFSET,
+    // number of ids, also returned for unknown names
+    COUNT
+  };
+
+  // location per id, -1 if the program has no such active uniform
+  typedef std::array<GLint, COUNT> table;
+
+  // table with all locations set to -1
+  table empty_table();
+
+  // glsl name of the uniform
+  char const* name(id uniform);
+
+  // id of the uniform with this glsl name, COUNT if unknown
+  id find(std::string const& name);
+}
+
+#endif
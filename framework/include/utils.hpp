@@ -7,6 +7,8 @@ using namespace gl;
 
 #include <glm/gtc/type_precision.hpp>
 
+#include "uniforms.hpp"
+
 #include <map>
 #include <vector>
 
@@ -22,6 +24,12 @@ namespace utils {
   // get uniform location, throwing exception if name describes no active uniform variable
   GLint glGetUniformLocation(GLuint, const GLchar*);
 
+  // locations of all active uniforms of program which have a compile time id
+  uniform::table reflect_uniforms(GLuint program);
+
+  // connect uniform block of program to binding point, false if the program does not use the block
+  bool bind_uniform_block(GLuint program, const GLchar* name, GLuint binding);
+
   // test program for drawing validity
   void validate_program(GLuint program);
 
@@ -0,0 +1,25 @@
+#ifndef VERTEX_QUANTIZATION_HPP
+#define VERTEX_QUANTIZATION_HPP
+
+#include "model.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+// conversion between float vertices and the encodings of model::PACKED_ATTRIBS
+namespace vertex_quantization {
+  // half float with round to nearest, out of range values become infinity
+  GLushort pack_half(float value);
+  float unpack_half(GLushort value);
+
+  // signed normalized GL_INT_2_10_10_10_REV, components are clamped to [-1, 1]
+  GLuint pack_snorm(glm::fvec4 const& value);
+  glm::fvec4 unpack_snorm(GLuint value);
+
+  // model with the same vertices in packed encodings, positions are normalized to their bounding box
+  // whose origin and size become position_offset and position_scale, the bounding sphere is kept
+  model pack(model const& mesh);
+  // float model with the decoded vertices
+  model unpack(model const& mesh);
+}
+
+#endif
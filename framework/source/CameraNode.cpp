@@ -3,22 +3,28 @@
 CameraNode::CameraNode(bool isPerspective, bool isEnabled) :
         Node(),
         isPerspective_{isPerspective},
-        isEnabled_{isPerspective} {};
+        isEnabled_{isPerspective} {
+    kind_ = CAMERA;
+};
 
 CameraNode::CameraNode() :
-        Node() {};
+        Node() {
+    kind_ = CAMERA;
+};
 
 CameraNode::CameraNode(bool isPerspective, bool isEnabled, const glm::mat4 &projectionMatrix) :
         Node(),
         isPerspective_(isPerspective),
         isEnabled_(isEnabled),
-        projectionMatrix_(projectionMatrix) {};
+        projectionMatrix_(projectionMatrix) {
+    kind_ = CAMERA;
+};
 
 void CameraNode::setProjectionMatrix(const glm::mat4 &mat) {
     projectionMatrix_ = mat;
 }
 
-glm::mat4 CameraNode::getProjectionMatrix() {
+glm::mat4 const &CameraNode::getProjectionMatrix() const {
     return projectionMatrix_;
 }
 
@@ -26,11 +32,11 @@ void CameraNode::setEnabled(bool enabled) {
     isEnabled_ = enabled;
 }
 
-bool CameraNode::getEnabled() {
+bool CameraNode::getEnabled() const {
     return isEnabled_;
 }
 
-bool CameraNode::getPerspective() {
+bool CameraNode::getPerspective() const {
     return isPerspective_;
 }
 
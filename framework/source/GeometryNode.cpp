@@ -4,22 +4,19 @@
 GeometryNode::GeometryNode(std::string name):
     Node(std::move(name)),
     geometry_{model()}
-{}
-
-GeometryNode::GeometryNode(const std::shared_ptr<Node> &parent, std::string name) :
-        Node(std::move(name)) {
-    this->setParent(parent);
+{
+    kind_ = GEOMETRY;
 }
 
-GeometryNode::GeometryNode(const std::shared_ptr<Node> &parent, std::string name, model geometry) :
-        Node(std::move(name)) {
-    this->setParent(parent);
-    this->geometry_ = geometry;
+GeometryNode::GeometryNode(std::string name, model geometry) :
+        Node(std::move(name)),
+        geometry_{std::move(geometry)} {
+    kind_ = GEOMETRY;
 }
 
 GeometryNode::~GeometryNode() = default;
 
-model GeometryNode::getGeometry() const{
+model const &GeometryNode::getGeometry() const{
     return geometry_;
 }
 
@@ -1,77 +1,54 @@
 #include "Node.hpp"
+#include "SceneGraph.hpp"
 
+#include <stdexcept>
 #include <utility>
 #include <iostream>
 #include <vector>
 #include <glm/gtc/matrix_transform.hpp>
 
-Node::Node() {}
+Node::Node() :
+        path_("/") {}
 
 Node::Node(std::string name) :
         name_(std::move(name)), // move semantic
-        path_("/" + name_),
-        parent_(nullptr) {
-    depth_ = 0;
-    localTransform_ = glm::mat4(1.0f);
-    worldTransform_ = glm::mat4(1.0f);
-    speed_ = 1.0f;
-    size_ = 1.0f;
-    distance_ = 0.0f;
-}
-
-Node::Node(std::string name, const std::shared_ptr<Node> &parent) :
-        name_(std::move(name)), // move semantic
-        parent_(parent) {
-    path_ = getPath();
-    depth_ = parent->getDepth() + 1;
-    localTransform_ = glm::mat4(1.0f);
-    worldTransform_ = glm::mat4(1.0f);
-    speed_ = 1.0f;
-    size_ = 1.0f;
-    distance_ = 0.0f;
-}
+        path_("/" + name_) {}
 
 Node::~Node() = default;
 
 //setter
 
-// set parent and refresh depth and path
-void Node::setParent(const std::shared_ptr<Node> &parent) {
-    parent_ = parent;
-    depth_ = parent_->getDepth() + 1;
-    path_ = parent->getPath() + "/" + name_;
-}
-
 void Node::setLocalTransform(const glm::mat4 &mat) {
-    localTransform_ = mat;
+    graph_->transforms_.setLocal(slot_, mat);
 }
 
 void Node::setWorldTransform(const glm::mat4 &mat) {
-    worldTransform_ = mat;
+    graph_->transforms_.setWorld(slot_, mat);
+}
+
+void Node::setBoundingSphere(const glm::vec4 &sphere) {
+    graph_->transforms_.setBounds(slot_, sphere);
 }
 
-void Node::addChildren(const std::shared_ptr<Node> &node) {
-    children_.push_back(node);
+void Node::addChildren(NodeHandle node) {
+    Node *child = graph_->get(node);
+    if (child == nullptr)
+        throw std::logic_error("addChildren: node " + name_ + " got an invalid handle");
+    graph_->link(*this, *child);
 }
 
-std::shared_ptr<Node> Node::removeChildren(const std::string &name) {
+NodeHandle Node::removeChildren(const std::string &name) {
     // search for child recursively
-    auto found_child = this->getChildren(name);
-    // if child was found
-    if (found_child != nullptr) {
-        // get parent to access childrenList
-        auto parent_found_child = found_child->getParent();
-        // if parent was found
-        if (parent_found_child != nullptr)
-            // remove child from the parents childrenList
-            parent_found_child->children_.remove(found_child);
-    }
+    NodeHandle found_child = getChildren(name);
+    // if child was found, take it out of the tree but keep it in the graph
+    if (found_child)
+        graph_->unlink(*graph_->get(found_child));
     return found_child;
 }
 
 void Node::setDistance(float distance) {
     distance_ = distance;
-    localTransform_ = glm::translate(localTransform_, glm::fvec3{0.0f, 0.0f, distance});
+    setLocalTransform(glm::translate(getLocalTransform(), glm::fvec3{0.0f, 0.0f, distance}));
 }
 
 void Node::setSpeed(float speed) {
@@ -80,21 +57,30 @@ void Node::setSpeed(float speed) {
 
 void Node::setSize(float size) {
     size_ = size;
+    setLocalTransform(glm::scale(getLocalTransform(), glm::fvec3{size}));
 }
 
 
 // getter
 
-std::list<std::shared_ptr<Node>> Node::getChildrenList() {
+std::vector<NodeHandle> const &Node::getChildrenList() const {
     return children_;
 }
 
-glm::mat4 Node::getLocalTransform() {
-    return localTransform_;
+glm::mat4 const &Node::getLocalTransform() const {
+    return graph_->transforms_.getLocal(slot_);
 }
 
-glm::mat4 Node::getWorldTransform() {
-    return worldTransform_;
+glm::mat4 const &Node::getWorldTransform() const {
+    return graph_->transforms_.getWorld(slot_);
+}
+
+glm::vec4 const &Node::getBoundingSphere() const {
+    return graph_->transforms_.getBounds(slot_);
+}
+
+bool Node::isVisible() const {
+    return graph_->transforms_.isVisible(slot_);
 }
 
 float Node::getSpeed() const {
@@ -109,76 +95,111 @@ float Node::getSize() const {
     return size_;
 }
 
-// search recursively trough all child for a child with given name and return it
-std::shared_ptr<Node> Node::getChildren(std::string const &name) {
-    // iterate over childrenList
-    for (auto child : children_) {
+// search for a descendant with given name and return it
+NodeHandle Node::getChildren(std::string const &name) const {
+    if (id_ != 0) {
+        // candidates with that name from the index, usually only one
+        for (Node *candidate : graph_->getNodesByName(name)) {
+            // climb up to the depth of this node to check if it is a descendant
+            Node const *ancestor = candidate;
+            for (int depth = candidate->depth_; depth > depth_ && ancestor != nullptr; --depth)
+                ancestor = graph_->get(ancestor->parent_);
+            if (ancestor == this && candidate != this)
+                return candidate->handle_;
+        }
+        return NodeHandle{};
+    }
+    // trees outside the root are not indexed and searched recursively
+    for (NodeHandle handle : children_) {
+        Node const *child = graph_->get(handle);
         // if direct child
         if (child->name_ == name)
-            return child;
-        else {
-            // search recursively
-            std::shared_ptr<Node> next_child = child->getChildren(name);
-            if (next_child != nullptr)
-                return child->getChildren(name);
-        }
+            return handle;
+        // search recursively
+        NodeHandle next_child = child->getChildren(name);
+        if (next_child)
+            return next_child;
     }
     // nothing found :(
-    return nullptr;
-}
-
-std::vector<std::shared_ptr<Node>> Node::getDrawable() {
-    std::vector<std::shared_ptr<Node>> drawable;
-    for(auto child : children_){
-        if(child->name_.find("camera") == std::string::npos && child->name_.find("geo") == std::string::npos){
-            drawable.push_back(child);
-            if(not child->getChildrenList().empty()){
-                auto child_drawable = child->getDrawable();
-                drawable.insert(drawable.end(), child_drawable.begin(), child_drawable.end());
-            }
+    return NodeHandle{};
+}
+
+std::vector<NodeHandle> Node::getDrawable() const {
+    std::vector<NodeHandle> drawable;
+    appendDrawable(drawable);
+    return drawable;
+}
+
+void Node::appendDrawable(std::vector<NodeHandle> &drawable) const {
+    for (NodeHandle handle : children_) {
+        Node const *child = graph_->get(handle);
+        if (child->isDrawable()) {
+            drawable.push_back(handle);
+            child->appendDrawable(drawable);
         }
     }
-    return drawable;
 }
 
-std::string Node::getName() {
+Node::Kind Node::getKind() const {
+    return kind_;
+}
+
+bool Node::isDrawable() const {
+    return kind_ == GROUP || kind_ == LIGHT;
+}
+
+std::string const &Node::getName() const {
     return name_;
 }
 
-int Node::getDepth() {
-    // depth = 0 if no parent
-    if (parent_ == nullptr)
-        return 0;
-    else {
-        // get path recursively from parents
-        depth_ = parent_->getDepth() + 1;
-        return depth_;
-    }
+int Node::getDepth() const {
+    return depth_;
 }
 
-std::string Node::getPath() {
-    // if there is no parent
-    if (parent_ == nullptr)
-        return "/" + name_;
-    else {
-        // get path recursively from all parents
-        path_ = parent_->getPath() + "/" + name_;
-        return path_;
+std::string const &Node::getPath() const {
+    return path_;
+}
+
+std::size_t Node::getId() const {
+    return id_;
+}
+
+NodeHandle Node::getHandle() const {
+    return handle_;
+}
+
+void Node::updatePath() {
+    // path is a key of the graph index
+    if (id_ != 0)
+        graph_->unindexPath(*this);
+    Node const *parent = graph_->get(parent_);
+    if (parent == nullptr) {
+        depth_ = 0;
+        path_ = "/" + name_;
+    } else {
+        depth_ = parent->depth_ + 1;
+        path_ = parent->path_ + "/" + name_;
+    }
+    if (id_ != 0)
+        graph_->indexPath(*this);
+    // paths of all descendants contain this path
+    for (NodeHandle child : children_) {
+        graph_->get(child)->updatePath();
     }
 }
 
-std::shared_ptr<Node> Node::getParent() {
+NodeHandle Node::getParent() const {
     return parent_;
 }
 
 // functions
 
-void Node::printChildren(int level) {
+void Node::printChildren(int level) const {
     if (level == 0)
-        std::cout << "." << "- " << this->getName() << std::endl;
+        std::cout << "." << "- " << name_ << std::endl;
     else
-        std::cout << std::string(level, '|') << "- " << this->getName() << std::endl;
-    for (const auto& child: children_) {
-        child->printChildren(level + 1);
+        std::cout << std::string(level, '|') << "- " << name_ << std::endl;
+    for (NodeHandle child : children_) {
+        graph_->get(child)->printChildren(level + 1);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,117 @@
+#include "NodePool.hpp"
+#include "Node.hpp"
+
+#include <algorithm>
+
+const std::size_t NodePool::GRANULARITY;
+const std::size_t NodePool::BLOCK_SIZE;
+
+NodePool::NodePool(NodePool &&other) {
+    swap(other);
+}
+
+NodePool &NodePool::operator=(NodePool &&other) {
+    if (this != &other) {
+        clear();
+        swap(other);
+    }
+    return *this;
+}
+
+NodePool::~NodePool() {
+    clear();
+}
+
+Node *NodePool::get(NodeHandle handle) const {
+    if (handle.index >= slots_.size())
+        return nullptr;
+    Slot const &slot = slots_[handle.index];
+    return slot.generation == handle.generation ? slot.node : nullptr;
+}
+
+void NodePool::destroy(NodeHandle handle) {
+    Node *node = get(handle);
+    if (node == nullptr)
+        return;
+    Slot &slot = slots_[handle.index];
+    std::size_t size = slot.size;
+    node->~Node();
+    deallocate(node, size);
+    slot.node = nullptr;
+    // outstanding handles no longer match
+    ++slot.generation;
+    freeSlots_.push_back(handle.index);
+    --live_;
+}
+
+void NodePool::clear() {
+    for (Slot &slot : slots_) {
+        if (slot.node != nullptr)
+            slot.node->~Node();
+    }
+    slots_.clear();
+    freeSlots_.clear();
+    blocks_.clear();
+    blockFree_ = nullptr;
+    blockRemaining_ = 0;
+    freeMemory_.clear();
+    live_ = 0;
+}
+
+std::size_t NodePool::size() const {
+    return live_;
+}
+
+void *NodePool::allocate(std::size_t size) {
+    std::size_t size_class = (size + GRANULARITY - 1) / GRANULARITY;
+    // reuse memory of a destroyed node of the same size class
+    if (size_class < freeMemory_.size() && !freeMemory_[size_class].empty()) {
+        void *memory = freeMemory_[size_class].back();
+        freeMemory_[size_class].pop_back();
+        return memory;
+    }
+    std::size_t bytes = size_class * GRANULARITY;
+    if (bytes > blockRemaining_) {
+        std::size_t block_size = std::max(BLOCK_SIZE, bytes);
+        blocks_.emplace_back(new unsigned char[block_size]);
+        blockFree_ = blocks_.back().get();
+        blockRemaining_ = block_size;
+    }
+    void *memory = blockFree_;
+    blockFree_ += bytes;
+    blockRemaining_ -= bytes;
+    return memory;
+}
+
+void NodePool::deallocate(void *memory, std::size_t size) {
+    std::size_t size_class = (size + GRANULARITY - 1) / GRANULARITY;
+    if (size_class >= freeMemory_.size())
+        freeMemory_.resize(size_class + 1);
+    freeMemory_[size_class].push_back(memory);
+}
+
+void NodePool::insert(Node *node, std::size_t size) {
+    std::uint32_t index;
+    if (freeSlots_.empty()) {
+        index = std::uint32_t(slots_.size());
+        slots_.push_back(Slot{nullptr, 1, 0});
+    } else {
+        index = freeSlots_.back();
+        freeSlots_.pop_back();
+    }
+    Slot &slot = slots_[index];
+    slot.node = node;
+    slot.size = std::uint32_t(size);
+    node->handle_ = NodeHandle{index, slot.generation};
+    ++live_;
+}
+
+void NodePool::swap(NodePool &other) {
+    std::swap(slots_, other.slots_);
+    std::swap(freeSlots_, other.freeSlots_);
+    std::swap(blocks_, other.blocks_);
+    std::swap(blockFree_, other.blockFree_);
+    std::swap(blockRemaining_, other.blockRemaining_);
+    std::swap(freeMemory_, other.freeMemory_);
+    std::swap(live_, other.live_);
+}
@@ -1,18 +1,22 @@
 #include "PointLightNode.hpp"
 
-PointLightNode::PointLightNode(std::string name, std::shared_ptr<Node> parent):
-    Node(std::move(name), parent){}
+PointLightNode::PointLightNode(std::string name):
+    Node(std::move(name)){
+    kind_ = LIGHT;
+}
 
-PointLightNode::PointLightNode(std::string name, std::shared_ptr<Node> parent, Color color, float lightIntensity):
-    Node(std::move(name), parent),
+PointLightNode::PointLightNode(std::string name, Color color, float lightIntensity):
+    Node(std::move(name)),
     color_{color},
-    lightIntensity_{lightIntensity}{}
+    lightIntensity_{lightIntensity}{
+    kind_ = LIGHT;
+}
 
-Color PointLightNode::getColor() {
+Color const &PointLightNode::getColor() const {
     return color_;
 }
 
-float PointLightNode::getLightIntensity() {
+float PointLightNode::getLightIntensity() const {
     return lightIntensity_;
 }
 
@@ -1,32 +1,316 @@
 #include "SceneGraph.hpp"
+#include <algorithm>
+#include <stdexcept>
 #include <utility>
 #include <iostream>
 
-SceneGraph::SceneGraph(std::string name) :
+SceneGraph::SceneGraph(std::string name, std::string root_name) :
         name_(std::move(name)) {
+    root_ = create<Node>(NodeHandle{}, std::move(root_name))->getHandle();
+    indexSubtree(*get(root_));
 }
 
-SceneGraph::SceneGraph(std::string name, std::shared_ptr<Node> node) :
-        name_(std::move(name)),
-        root_(std::move(node)) {
+SceneGraph::SceneGraph(SceneGraph &&other) :
+        name_(std::move(other.name_)),
+        nodes_(std::move(other.nodes_)),
+        root_(other.root_),
+        transforms_(std::move(other.transforms_)),
+        nameIds_(std::move(other.nameIds_)),
+        nodesByName_(std::move(other.nodesByName_)),
+        nodesByPath_(std::move(other.nodesByPath_)),
+        nodesById_(std::move(other.nodesById_)),
+        nextId_(other.nextId_),
+        pool_(std::move(other.pool_)) {
+    other.root_ = NodeHandle{};
+    other.transforms_.clear();
+    other.traversalVersion_ = TransformStore::npos;
+    rebind();
 }
 
-std::string SceneGraph::getName() {
+SceneGraph &SceneGraph::operator=(SceneGraph &&other) {
+    if (this != &other) {
+        name_ = std::move(other.name_);
+        // destroys the nodes of this graph
+        nodes_ = std::move(other.nodes_);
+        root_ = other.root_;
+        transforms_ = std::move(other.transforms_);
+        nameIds_ = std::move(other.nameIds_);
+        nodesByName_ = std::move(other.nodesByName_);
+        nodesByPath_ = std::move(other.nodesByPath_);
+        nodesById_ = std::move(other.nodesById_);
+        nextId_ = other.nextId_;
+        pool_ = std::move(other.pool_);
+        traversalVersion_ = TransformStore::npos;
+        other.root_ = NodeHandle{};
+        other.transforms_.clear();
+        other.traversalVersion_ = TransformStore::npos;
+        rebind();
+    }
+    return *this;
+}
+
+std::string const &SceneGraph::getName() const {
     return name_;
 }
 
-std::shared_ptr<Node> SceneGraph::getRoot() const {
+NodeHandle SceneGraph::getRoot() const {
     return root_;
 }
 
+TransformStore const &SceneGraph::getTransforms() const {
+    return transforms_;
+}
+
+Node *SceneGraph::get(NodeHandle handle) const {
+    return nodes_.get(handle);
+}
+
+std::size_t SceneGraph::size() const {
+    return nodes_.size();
+}
+
+NodeHandle SceneGraph::findByName(const std::string &name) const {
+    auto const &nodes = getNodesByName(name);
+    return nodes.empty() ? NodeHandle{} : nodes.front()->handle_;
+}
+
+NodeHandle SceneGraph::findByPath(const std::string &path) const {
+    auto found = nodesByPath_.find(path);
+    return found == nodesByPath_.end() ? NodeHandle{} : found->second->handle_;
+}
+
+NodeHandle SceneGraph::findById(std::size_t id) const {
+    auto found = nodesById_.find(id);
+    return found == nodesById_.end() ? NodeHandle{} : found->second->handle_;
+}
+
+std::vector<Node *> const &SceneGraph::getNodesByName(const std::string &name) const {
+    static const std::vector<Node *> none{};
+    auto found = nameIds_.find(name);
+    return found == nameIds_.end() ? none : nodesByName_[found->second];
+}
+
 void SceneGraph::setName(const std::string &name) {
     name_ = name;
 }
 
-void SceneGraph::setRoot(const std::shared_ptr<Node> &node) {
-    root_ = node;
+void SceneGraph::insert(Node &node, NodeHandle parent) {
+    Node *parent_node = get(parent);
+    if (parent && parent_node == nullptr) {
+        nodes_.destroy(node.handle_);
+        throw std::logic_error("SceneGraph: parent of new node " + node.name_ + " was destroyed");
+    }
+    node.graph_ = this;
+    // appending below the parent keeps the store in pre-order if the parent subtree ends at the back
+    node.slot_ = transforms_.insert(&node, parent_node != nullptr ? parent_node->slot_ : TransformStore::npos,
+                                    glm::mat4{}, glm::mat4{});
+    if (parent_node == nullptr)
+        return;
+    node.parent_ = parent;
+    parent_node->children_.push_back(node.handle_);
+    node.updatePath();
+    if (parent_node->id_ != 0)
+        indexNode(node);
+}
+
+void SceneGraph::destroy(NodeHandle handle) {
+    Node *node = get(handle);
+    if (node == nullptr)
+        return;
+    unlink(*node);
+    if (node->id_ != 0)
+        unindexSubtree(*node);
+    if (handle == root_)
+        root_ = NodeHandle{};
+    // children are destroyed before their parent
+    std::vector<NodeHandle> subtree{handle};
+    for (std::size_t i = 0; i < subtree.size(); ++i) {
+        auto const &children = get(subtree[i])->children_;
+        subtree.insert(subtree.end(), children.begin(), children.end());
+    }
+    for (std::size_t i = subtree.size(); i-- > 0;) {
+        transforms_.erase(get(subtree[i])->slot_);
+        nodes_.destroy(subtree[i]);
+    }
+}
+
+void SceneGraph::link(Node &parent, Node &child) {
+    // climb up from the new parent to make sure no cycle is created
+    for (Node *ancestor = &parent; ancestor != nullptr; ancestor = get(ancestor->parent_)) {
+        if (ancestor == &child)
+            throw std::logic_error("SceneGraph: " + child.name_ + " cannot be added below its own subtree");
+    }
+    unlink(child);
+    if (child.id_ != 0)
+        unindexSubtree(child);
+    child.parent_ = parent.handle_;
+    parent.children_.push_back(child.handle_);
+    transforms_.setParent(child.slot_, parent.slot_);
+    child.updatePath();
+    if (parent.id_ != 0)
+        indexSubtree(child);
+}
+
+void SceneGraph::unlink(Node &node) {
+    Node *parent = get(node.parent_);
+    if (parent == nullptr)
+        return;
+    if (node.id_ != 0)
+        unindexSubtree(node);
+    auto &siblings = parent->children_;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), node.handle_));
+    node.parent_ = NodeHandle{};
+    transforms_.setParent(node.slot_, TransformStore::npos);
+    node.updatePath();
+}
+
+void SceneGraph::rebind() {
+    for (std::size_t i = 0; i < transforms_.size(); ++i) {
+        Node *node = transforms_.getNode(i);
+        if (node != nullptr)
+            node->graph_ = this;
+    }
+}
+
+void SceneGraph::indexNode(Node &node) {
+    // intern name on first use
+    auto interned = nameIds_.emplace(node.name_, nodesByName_.size());
+    if (interned.second)
+        nodesByName_.emplace_back();
+    node.nameId_ = interned.first->second;
+    nodesByName_[node.nameId_].push_back(&node);
+
+    node.id_ = nextId_++;
+    nodesById_.emplace(node.id_, &node);
+    indexPath(node);
+}
+
+void SceneGraph::unindexNode(Node &node) {
+    auto &named = nodesByName_[node.nameId_];
+    named.erase(std::find(named.begin(), named.end(), &node));
+    nodesById_.erase(node.id_);
+    unindexPath(node);
+    node.id_ = 0;
+}
+
+void SceneGraph::indexSubtree(Node &node) {
+    indexNode(node);
+    for (NodeHandle child : node.children_) {
+        indexSubtree(*get(child));
+    }
 }
 
-std::string SceneGraph::printGraph() {
-    root_->printChildren();
-}
\ No newline at end of file
+void SceneGraph::unindexSubtree(Node &node) {
+    unindexNode(node);
+    for (NodeHandle child : node.children_) {
+        unindexSubtree(*get(child));
+    }
+}
+
+void SceneGraph::indexPath(Node &node) {
+    // first node keeps the path if siblings share a name
+    nodesByPath_.emplace(node.path_, &node);
+}
+
+void SceneGraph::unindexPath(Node &node) {
+    auto found = nodesByPath_.find(node.path_);
+    if (found != nodesByPath_.end() && found->second == &node)
+        nodesByPath_.erase(found);
+}
+
+NodeRange SceneGraph::getRenderList() {
+    updateTraversals();
+    return NodeRange{renderList_.data(), renderList_.data() + renderList_.size()};
+}
+
+NodeRange SceneGraph::depthFirst() {
+    updateTraversals();
+    return NodeRange{depthFirst_.data(), depthFirst_.data() + depthFirst_.size()};
+}
+
+NodeRange SceneGraph::breadthFirst() {
+    updateTraversals();
+    return NodeRange{breadthFirst_.data(), breadthFirst_.data() + breadthFirst_.size()};
+}
+
+void SceneGraph::updateTraversals() {
+    if (traversalVersion_ == transforms_.getVersion())
+        return;
+    // store order is the depth-first order
+    if (!transforms_.isLinear())
+        transforms_.linearize();
+
+    depthFirst_.clear();
+    renderList_.clear();
+    Node const *root = get(root_);
+    // separate trees are not traversed
+    std::size_t const first = root != nullptr ? root->slot_ : 0;
+    std::size_t const last = root != nullptr ? transforms_.getSubtreeEnd(first) : 0;
+    std::size_t const count = last - first;
+    std::size_t max_depth = 0;
+    for (std::size_t i = first; i < last; ++i) {
+        Node *node = transforms_.getNode(i);
+        depthFirst_.push_back(node);
+        max_depth = std::max(max_depth, std::size_t(node->depth_));
+    }
+
+    // counting sort by depth keeps the depth-first order within a level, which is the breadth-first order
+    levelStarts_.assign(max_depth + 2, 0);
+    for (Node *node : depthFirst_) {
+        ++levelStarts_[std::size_t(node->depth_) + 1];
+    }
+    for (std::size_t level = 1; level < levelStarts_.size(); ++level) {
+        levelStarts_[level] += levelStarts_[level - 1];
+    }
+    breadthFirst_.resize(count);
+    for (Node *node : depthFirst_) {
+        breadthFirst_[levelStarts_[std::size_t(node->depth_)]++] = node;
+    }
+
+    // skip whole subtrees below geometry and camera nodes
+    for (std::size_t i = 0; i < count;) {
+        Node *node = depthFirst_[i];
+        if (node == root) {
+            ++i;
+        } else if (node->isDrawable()) {
+            renderList_.push_back(node);
+            ++i;
+        } else {
+            i = transforms_.getSubtreeEnd(first + i) - first;
+        }
+    }
+    traversalVersion_ = transforms_.getVersion();
+}
+
+std::size_t SceneGraph::updateWorldTransforms() {
+    return transforms_.updateWorldTransforms(pool_.get());
+}
+
+std::size_t SceneGraph::animate(TransformStore::Animation const &animation) {
+    return transforms_.animate(animation, pool_.get());
+}
+
+std::size_t SceneGraph::cull(glm::mat4 const &view_projection) {
+    return transforms_.cull(view_projection);
+}
+
+void SceneGraph::setThreadCount(unsigned count) {
+    if (count == getThreadCount())
+        return;
+    if (count > 1)
+        pool_.reset(new ThreadPool(count));
+    else
+        pool_.reset();
+}
+
+unsigned SceneGraph::getThreadCount() const {
+    return pool_ ? pool_->size() : 1;
+}
+
+void SceneGraph::setGrainSize(std::size_t size) {
+    transforms_.setGrainSize(size);
+}
+
+void SceneGraph::printGraph() {
+    get(root_)->printChildren();
+}
@@ -0,0 +1,116 @@
+#include "ThreadPool.hpp"
+
+#include <utility>
+
+ThreadPool::ThreadPool(unsigned workers) {
+    if (workers == 0)
+        workers = 1;
+    for (unsigned i = 0; i < workers; ++i)
+        queues_.emplace_back(new Queue);
+    // worker 0 is the thread calling run()
+    for (unsigned i = 1; i < workers; ++i)
+        threads_.emplace_back(&ThreadPool::loop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread &thread : threads_)
+        thread.join();
+}
+
+void ThreadPool::run(std::size_t count, Task const &task) {
+    if (count == 0)
+        return;
+    if (threads_.empty()) {
+        for (std::size_t i = 0; i < count; ++i)
+            task(i);
+        return;
+    }
+
+    remaining_ = count;
+    std::size_t const workers = queues_.size();
+    for (std::size_t w = 0; w < workers; ++w) {
+        std::lock_guard<std::mutex> lock(queues_[w]->mutex);
+        for (std::size_t i = count * w / workers; i < count * (w + 1) / workers; ++i)
+            queues_[w]->items.push_back(Item{&task, i});
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    work(0);
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return remaining_ == 0; });
+        std::swap(error, error_);
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+unsigned ThreadPool::size() const {
+    return unsigned(queues_.size());
+}
+
+bool ThreadPool::pop(unsigned worker, Item &item) {
+    {
+        Queue &own = *queues_[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.items.empty()) {
+            item = own.items.front();
+            own.items.pop_front();
+            return true;
+        }
+    }
+    for (std::size_t i = 1; i < queues_.size(); ++i) {
+        Queue &victim = *queues_[(worker + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.items.empty()) {
+            item = victim.items.back();
+            victim.items.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::work(unsigned worker) {
+    Item item;
+    while (pop(worker, item)) {
+        // items carry their task, a worker late for one run may already pick up items of the next
+        try {
+            (*item.task)(item.index);
+        }
+        catch (...) {
+            // run() must not return while other workers still reference the task
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_)
+                error_ = std::current_exception();
+        }
+        if (--remaining_ == 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_.notify_all();
+        }
+    }
+}
+
+void ThreadPool::loop(unsigned worker) {
+    std::size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_)
+                return;
+            seen = generation_;
+        }
+        work(worker);
+    }
+}
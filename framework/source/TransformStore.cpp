@@ -0,0 +1,420 @@
+#include "TransformStore.hpp"
+#include "Node.hpp"
+#include "matrix_kernels.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+const std::size_t TransformStore::npos = std::numeric_limits<std::size_t>::max();
+
+std::size_t TransformStore::insert(Node *node, std::size_t parent, glm::mat4 const &local, glm::mat4 const &world) {
+    std::size_t index = parents_.size();
+    parents_.push_back(parent);
+    subtreeEnds_.push_back(index + 1);
+    locals_.push_back(local);
+    worlds_.push_back(world);
+    flags_.push_back(FLAG_ALIVE | FLAG_VISIBLE);
+    bounds_.emplace_back(0.0f, 0.0f, 0.0f, -1.0f);
+    nodes_.push_back(node);
+    markDirty(index);
+    ++version_;
+
+    if (parent != npos) {
+        // appending keeps pre-order only if the parent subtree ends at the back
+        if (linear_ && subtreeEnds_[parent] == index) {
+            // extend the ranges of all ancestors
+            for (std::size_t p = parent; p != npos; p = parents_[p]) {
+                subtreeEnds_[p] = index + 1;
+            }
+        } else {
+            linear_ = false;
+        }
+    }
+    return index;
+}
+
+void TransformStore::erase(std::size_t index) {
+    flags_[index] = 0;
+    nodes_[index] = nullptr;
+    linear_ = false;
+    ++version_;
+}
+
+void TransformStore::setParent(std::size_t index, std::size_t parent) {
+    if (parents_[index] != parent) {
+        parents_[index] = parent;
+        linear_ = false;
+        markDirty(index);
+        ++version_;
+    }
+}
+
+void TransformStore::linearize() {
+    std::size_t const count = parents_.size();
+    firstChild_.assign(count, npos);
+    nextSibling_.assign(count, npos);
+    remap_.assign(count, npos);
+    order_.clear();
+
+    // build child lists, iterating backwards keeps siblings in index order
+    std::size_t first_root = npos;
+    for (std::size_t i = count; i-- > 0;) {
+        if (!(flags_[i] & FLAG_ALIVE))
+            continue;
+        std::size_t parent = parents_[i];
+        if (parent == npos || !(flags_[parent] & FLAG_ALIVE)) {
+            nextSibling_[i] = first_root;
+            first_root = i;
+        } else {
+            nextSibling_[i] = firstChild_[parent];
+            firstChild_[parent] = i;
+        }
+    }
+
+    // iterative pre-order traversal of every tree
+    for (std::size_t root = first_root; root != npos; root = nextSibling_[root]) {
+        std::size_t current = root;
+        while (true) {
+            remap_[current] = order_.size();
+            order_.push_back(current);
+            if (firstChild_[current] != npos) {
+                current = firstChild_[current];
+                continue;
+            }
+            // climb up until an unvisited sibling is found
+            while (current != root && nextSibling_[current] == npos)
+                current = parents_[current];
+            if (current == root)
+                break;
+            current = nextSibling_[current];
+        }
+    }
+
+    // permute all arrays into the new order
+    std::size_t const live = order_.size();
+    std::vector<std::size_t> parents(live);
+    std::vector<std::size_t> subtree_ends(live);
+    std::vector<glm::mat4> locals(live);
+    std::vector<glm::mat4> worlds(live);
+    std::vector<std::uint8_t> flags(live);
+    std::vector<glm::vec4> bounds(live);
+    std::vector<Node *> nodes(live);
+    for (std::size_t i = 0; i < live; ++i) {
+        std::size_t old = order_[i];
+        std::size_t parent = parents_[old];
+        parents[i] = parent == npos ? npos : remap_[parent];
+        subtree_ends[i] = i + 1;
+        locals[i] = locals_[old];
+        worlds[i] = worlds_[old];
+        flags[i] = flags_[old];
+        bounds[i] = bounds_[old];
+        nodes[i] = nodes_[old];
+        nodes[i]->slot_ = i;
+    }
+    // children follow their parent, so ranges can be accumulated backwards
+    for (std::size_t i = live; i-- > 0;) {
+        if (parents[i] != npos)
+            subtree_ends[parents[i]] = std::max(subtree_ends[parents[i]], subtree_ends[i]);
+    }
+
+    parents_.swap(parents);
+    subtreeEnds_.swap(subtree_ends);
+    locals_.swap(locals);
+    worlds_.swap(worlds);
+    flags_.swap(flags);
+    bounds_.swap(bounds);
+    nodes_.swap(nodes);
+    linear_ = true;
+
+    // move dirty entries to their new position and drop erased ones
+    std::size_t dirty_count = 0;
+    for (std::size_t index : dirty_) {
+        if (remap_[index] != npos)
+            dirty_[dirty_count++] = remap_[index];
+    }
+    dirty_.resize(dirty_count);
+}
+
+std::size_t TransformStore::updateWorldTransforms(ThreadPool *pool) {
+    if (!linear_)
+        linearize();
+    if (dirty_.empty())
+        return 0;
+
+    // ascending order visits ancestors before their dirty descendants
+    std::sort(dirty_.begin(), dirty_.end());
+    std::size_t updated = 0;
+    std::size_t covered = 0;
+    ranges_.clear();
+    for (std::size_t index : dirty_) {
+        // already recomputed as part of a dirty ancestor
+        if (index < covered)
+            continue;
+        covered = subtreeEnds_[index];
+        ranges_.emplace_back(index, covered);
+        updated += covered - index;
+    }
+    dirty_.clear();
+
+    if (pool == nullptr || pool->size() < 2 || updated <= grainSize_) {
+        // subtree is contiguous and parents come first, so one linear pass suffices
+        for (auto const &range : ranges_)
+            propagate(range.first, range.second);
+        return updated;
+    }
+
+    tasks_.clear();
+    for (auto const &range : ranges_)
+        split(range.first, range.second);
+    pool->run(tasks_.size(), [this](std::size_t task) {
+        propagate(tasks_[task].first, tasks_[task].second);
+    });
+    return updated;
+}
+
+void TransformStore::propagate(std::size_t begin, std::size_t end) {
+    // roots store npos as parent, which the kernel treats as root as well
+    matrix_kernels::propagate(parents_.data(), locals_.data(), worlds_.data(), begin, end);
+    for (std::size_t i = begin; i < end; ++i)
+        flags_[i] &= std::uint8_t(~FLAG_DIRTY);
+}
+
+void TransformStore::split(std::size_t index, std::size_t end) {
+    std::size_t i = index;
+    while (i < end) {
+        std::size_t subtree_end = subtreeEnds_[i];
+        if (subtree_end - i > grainSize_) {
+            // continue with the children of a large subtree
+            propagate(i, i + 1);
+            ++i;
+            continue;
+        }
+        // adjacent small subtrees are merged into one range
+        if (!tasks_.empty() && tasks_.back().second == i && subtree_end - tasks_.back().first <= grainSize_)
+            tasks_.back().second = subtree_end;
+        else
+            tasks_.emplace_back(i, subtree_end);
+        i = subtree_end;
+    }
+}
+
+std::size_t TransformStore::animate(Animation const &animation, ThreadPool *pool) {
+    std::size_t const count = parents_.size();
+    std::size_t const tasks = pool == nullptr || pool->size() < 2 ? 1 : (count + grainSize_ - 1) / grainSize_;
+    if (animated_.size() < tasks)
+        animated_.resize(tasks);
+    // each task only touches its own entries, newly dirtied ones are collected per task
+    auto task = [&](std::size_t t) {
+        std::vector<std::size_t> &animated = animated_[t];
+        animated.clear();
+        std::size_t const begin = count * t / tasks;
+        std::size_t const end = count * (t + 1) / tasks;
+        for (std::size_t i = begin; i < end; ++i) {
+            if (!(flags_[i] & FLAG_ALIVE) || !animation(*nodes_[i], locals_[i]))
+                continue;
+            animated.push_back(i);
+        }
+    };
+    if (tasks == 1)
+        task(0);
+    else
+        pool->run(tasks, task);
+
+    std::size_t changed = 0;
+    for (std::size_t t = 0; t < tasks; ++t) {
+        for (std::size_t index : animated_[t])
+            markDirty(index);
+        changed += animated_[t].size();
+    }
+    return changed;
+}
+
+std::size_t TransformStore::cull(glm::mat4 const &view_projection) {
+    if (!linear_)
+        linearize();
+    std::size_t const count = parents_.size();
+    frustum_culling::frustum planes = frustum_culling::extract(view_projection);
+    // results of the previous cull are indexed by slot, which changes with the structure
+    if (cullVersion_ != version_)
+        cullResults_.assign(count, frustum_culling::INTERSECTING);
+    bool const same_frustum = cullVersion_ == version_ && std::memcmp(&planes, &frustum_, sizeof(planes)) == 0;
+    rejectingPlanes_.resize(count);
+
+    worldBounds_.resize(count);
+    frustum_culling::transform(worlds_.data(), bounds_.data(), worldBounds_.data(), count);
+    // children follow their parent, so subtree bounds can be accumulated backwards
+    subtreeBounds_.swap(previousBounds_);
+    subtreeBounds_.assign(worldBounds_.begin(), worldBounds_.end());
+    for (std::size_t i = count; i-- > 0;) {
+        if (parents_[i] != npos)
+            subtreeBounds_[parents_[i]] = frustum_culling::merge(subtreeBounds_[parents_[i]], subtreeBounds_[i]);
+    }
+
+    std::size_t visible = 0;
+    cullReused_ = 0;
+    std::size_t i = 0;
+    while (i < count) {
+        std::size_t const end = subtreeEnds_[i];
+        glm::vec4 const &sphere = subtreeBounds_[i];
+        if (sphere.w < 0.0f) {
+            setVisible(i, end, true);
+            visible += end - i;
+            i = end;
+            continue;
+        }
+
+        frustum_culling::result result;
+        frustum_culling::result const previous = cullResults_[i];
+        if (previous == frustum_culling::OUTSIDE && frustum_culling::outside(planes, sphere, rejectingPlanes_[i])) {
+            // still behind the plane which rejected it last time
+            result = frustum_culling::OUTSIDE;
+            ++cullReused_;
+        } else if (previous == frustum_culling::INSIDE && same_frustum && sphere == previousBounds_[i]) {
+            result = frustum_culling::INSIDE;
+            ++cullReused_;
+        } else {
+            result = frustum_culling::classify(planes, sphere, &rejectingPlanes_[i]);
+        }
+
+        if (result == frustum_culling::INTERSECTING) {
+            // descend into the children, the entry itself is tested on its own bounds
+            glm::vec4 const &own = worldBounds_[i];
+            bool const own_visible = own.w < 0.0f || end == i + 1 ||
+                                     frustum_culling::classify(planes, own) != frustum_culling::OUTSIDE;
+            setVisible(i, i + 1, own_visible);
+            visible += own_visible ? 1 : 0;
+            cullResults_[i] = result;
+            ++i;
+            continue;
+        }
+        bool const inside = result == frustum_culling::INSIDE;
+        setVisible(i, end, inside);
+        visible += inside ? end - i : 0;
+        cullResults_[i] = result;
+        i = end;
+    }
+
+    frustum_ = planes;
+    cullVersion_ = version_;
+    return visible;
+}
+
+void TransformStore::setVisible(std::size_t begin, std::size_t end, bool visible) {
+    for (std::size_t i = begin; i < end; ++i) {
+        if (visible)
+            flags_[i] |= FLAG_VISIBLE;
+        else
+            flags_[i] &= std::uint8_t(~FLAG_VISIBLE);
+        // entries below a skipped subtree root were not tested
+        cullResults_[i] = frustum_culling::INTERSECTING;
+    }
+}
+
+void TransformStore::markDirty(std::size_t index) {
+    if (!(flags_[index] & FLAG_DIRTY)) {
+        flags_[index] |= FLAG_DIRTY;
+        dirty_.push_back(index);
+    }
+}
+
+void TransformStore::clear() {
+    parents_.clear();
+    subtreeEnds_.clear();
+    locals_.clear();
+    worlds_.clear();
+    flags_.clear();
+    bounds_.clear();
+    nodes_.clear();
+    dirty_.clear();
+    linear_ = true;
+    ++version_;
+}
+
+// getter
+
+std::size_t TransformStore::size() const {
+    return parents_.size();
+}
+
+bool TransformStore::isLinear() const {
+    return linear_;
+}
+
+std::size_t TransformStore::getVersion() const {
+    return version_;
+}
+
+std::size_t TransformStore::getParent(std::size_t index) const {
+    return parents_[index];
+}
+
+std::size_t TransformStore::getSubtreeEnd(std::size_t index) const {
+    return subtreeEnds_[index];
+}
+
+std::uint8_t TransformStore::getFlags(std::size_t index) const {
+    return flags_[index];
+}
+
+std::size_t TransformStore::getGrainSize() const {
+    return grainSize_;
+}
+
+bool TransformStore::isVisible(std::size_t index) const {
+    return (flags_[index] & FLAG_VISIBLE) != 0;
+}
+
+glm::vec4 const &TransformStore::getBounds(std::size_t index) const {
+    return bounds_[index];
+}
+
+std::size_t TransformStore::getCullReused() const {
+    return cullReused_;
+}
+
+Node *TransformStore::getNode(std::size_t index) const {
+    return nodes_[index];
+}
+
+glm::mat4 const &TransformStore::getLocal(std::size_t index) const {
+    return locals_[index];
+}
+
+glm::mat4 const &TransformStore::getWorld(std::size_t index) const {
+    return worlds_[index];
+}
+
+// setter
+
+void TransformStore::setLocal(std::size_t index, glm::mat4 const &mat) {
+    locals_[index] = mat;
+    markDirty(index);
+}
+
+void TransformStore::setWorld(std::size_t index, glm::mat4 const &mat) {
+    worlds_[index] = mat;
+}
+
+void TransformStore::setBounds(std::size_t index, glm::vec4 const &sphere) {
+    bounds_[index] = sphere;
+}
+
+void TransformStore::setGrainSize(std::size_t size) {
+    grainSize_ = size > 0 ? size : 1;
+}
+
+// raw arrays
+
+std::size_t const *TransformStore::parents() const {
+    return parents_.data();
+}
+
+glm::mat4 const *TransformStore::locals() const {
+    return locals_.data();
+}
+
+glm::mat4 *TransformStore::worlds() {
+    return worlds_.data();
+}
@@ -12,7 +12,7 @@ using namespace gl;
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
-static void update_shader_programs(std::map<std::string, shader_program>& shaders, bool throwing);
+static void update_shader_programs(std::map<std::string, shader_program>& shaders, shader_loader::program_cache& cache, bool throwing);
 
 const glm::uvec2 Application::initial_resolution = {640u, 480u};
 const float Application::initial_aspect_ratio = float(initial_resolution.x) / float(initial_resolution.y);
@@ -20,18 +20,18 @@ const float Application::initial_aspect_ratio = float(initial_resolution.x) / fl
 Application::Application(std::string const& resource_path)
  :m_resource_path{resource_path}
  ,m_shaders{}
+ ,m_programs{resource_path + "shader_cache/"}
 {}
 
-Application::~Application() {
-  // free all shader program objects
-  for (auto const& pair : m_shaders) {
-    glDeleteProgram(pair.second.handle);
-  }
-}
+// shader program objects are freed by the cache
+Application::~Application() {}
 
 void Application::reloadShaders(bool throwing) {
-  // recompile shaders from source files
-  update_shader_programs(m_shaders, throwing);
+  // recompile shaders whose source files changed
+  update_shader_programs(m_shaders, m_programs, throwing);
+  reloadPrograms(throwing);
+  // free variants of the previous sources
+  m_programs.sweep();
   // after shader programs are recompiled, uniform locations may change
   updateUniformLocations();
   // upload values to new locations
@@ -45,7 +45,40 @@ void Application::updateUniformLocations() {
       // store uniform location in map
       uniform.second = utils::glGetUniformLocation(pair.second.handle, uniform.first.c_str());
     }
+    pair.second.locations = utils::reflect_uniforms(pair.second.handle);
+  }
+}
+
+std::string Application::shaderVariant(std::string const& name, std::vector<std::string> const& defines) {
+  if (defines.empty()) {
+    return name;
+  }
+  std::string variant{name};
+  for (auto const& define : defines) {
+    variant += "+" + define;
+  }
+  if (m_shaders.find(variant) == m_shaders.end()) {
+    shader_program const& base = m_shaders.at(name);
+    std::vector<std::string> variant_defines{base.defines};
+    variant_defines.insert(variant_defines.end(), defines.begin(), defines.end());
+    shader_program& program = m_shaders.emplace(variant, shader_program{base.shader_paths, variant_defines}).first->second;
+    // throws like the initial load, the entry is only kept if it compiles
+    try {
+      program.handle = m_programs.get(program.shader_paths, program.defines);
+    }
+    catch (std::exception&) {
+      m_shaders.erase(variant);
+      throw;
+    }
+    program.u_locs = base.u_locs;
+    for (auto& uniform : program.u_locs) {
+      uniform.second = utils::glGetUniformLocation(program.handle, uniform.first.c_str());
+    }
+    program.locations = utils::reflect_uniforms(program.handle);
+    // new program needs the values of all others
+    uploadUniforms();
   }
+  return variant;
 }
 
 ///////////////////////////// callback functions for window events ////////////
@@ -81,15 +114,12 @@ void Application::resize_callback(unsigned width, unsigned height) {
 }
 ///////////////////////////// local helper functions //////////////////////////
 // update uniform locations
-static void update_shader_programs(std::map<std::string, shader_program>& shaders, bool throwing) {
+static void update_shader_programs(std::map<std::string, shader_program>& shaders, shader_loader::program_cache& cache, bool throwing) {
   // actual functionality in lambda to allow update with and without throwing
-  auto update_lambda = [](shader_program& program){
+  auto update_lambda = [&cache](shader_program& program){
     // throws exception when compiling was unsuccessfull
-    GLuint new_program = shader_loader::program(program.shader_paths);
-    // free old shader program
-    glDeleteProgram(program.handle);
-    // save new shader program
-    program.handle = new_program;
+    // unchanged sources are found in the cache, the old program stays there until the next sweep
+    program.handle = cache.get(program.shader_paths, program.defines);
   };
 
   // reload all shader programs
@@ -102,7 +132,8 @@ static void update_shader_programs(std::map<std::string, shader_program>& shader
        update_lambda(pair.second);
       }
       catch(std::exception&) {
-        // dont crash, allow another try
+        // dont crash, allow another try with the previous program
+        cache.keep(pair.second.handle);
       }
     }
   }
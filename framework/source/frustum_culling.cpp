@@ -0,0 +1,152 @@
+#include "frustum_culling.hpp"
+#include "matrix_kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define FRUSTUM_CULLING_X86
+#include <immintrin.h>
+#endif
+
+namespace frustum_culling {
+
+frustum extract(glm::mat4 const& m) {
+  // rows of the matrix, glm stores columns
+  glm::vec4 row[4];
+  for (int i = 0; i < 4; ++i) {
+    row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+  }
+  // left, right, bottom, top, near, far
+  glm::vec4 const planes[6] = {
+    row[3] + row[0], row[3] - row[0],
+    row[3] + row[1], row[3] - row[1],
+    row[3] + row[2], row[3] - row[2]
+  };
+
+  frustum result;
+  for (int i = 0; i < 8; ++i) {
+    if (i < 6) {
+      float length = glm::length(glm::vec3(planes[i]));
+      result.x[i] = planes[i].x / length;
+      result.y[i] = planes[i].y / length;
+      result.z[i] = planes[i].z / length;
+      result.w[i] = planes[i].w / length;
+    }
+    else {
+      // every point is far inside of the padding planes
+      result.x[i] = 0.0f;
+      result.y[i] = 0.0f;
+      result.z[i] = 0.0f;
+      result.w[i] = std::numeric_limits<float>::max();
+    }
+  }
+  return result;
+}
+
+static float distance(frustum const& planes, glm::vec4 const& sphere, int i) {
+  return planes.x[i] * sphere.x + planes.y[i] * sphere.y + planes.z[i] * sphere.z + planes.w[i];
+}
+
+static result classify_scalar(frustum const& planes, glm::vec4 const& sphere, std::uint8_t* plane) {
+  result position = INSIDE;
+  for (int i = 0; i < 6; ++i) {
+    float d = distance(planes, sphere, i);
+    if (d < -sphere.w) {
+      if (plane != nullptr) {
+        *plane = std::uint8_t(i);
+      }
+      return OUTSIDE;
+    }
+    if (d < sphere.w) {
+      position = INTERSECTING;
+    }
+  }
+  return position;
+}
+
+#ifdef FRUSTUM_CULLING_X86
+// four planes per register, the sphere is broadcast
+static result classify_sse(frustum const& planes, glm::vec4 const& sphere, std::uint8_t* plane) {
+  __m128 const cx = _mm_set1_ps(sphere.x);
+  __m128 const cy = _mm_set1_ps(sphere.y);
+  __m128 const cz = _mm_set1_ps(sphere.z);
+  __m128 const radius = _mm_set1_ps(sphere.w);
+  __m128 const negative_radius = _mm_set1_ps(-sphere.w);
+  int behind = 0;
+  int intersecting = 0;
+  for (int i = 0; i < 8; i += 4) {
+    __m128 dot = _mm_mul_ps(_mm_load_ps(planes.x + i), cx);
+    dot = _mm_add_ps(dot, _mm_mul_ps(_mm_load_ps(planes.y + i), cy));
+    dot = _mm_add_ps(dot, _mm_mul_ps(_mm_load_ps(planes.z + i), cz));
+    dot = _mm_add_ps(dot, _mm_load_ps(planes.w + i));
+    behind |= _mm_movemask_ps(_mm_cmplt_ps(dot, negative_radius)) << i;
+    intersecting |= _mm_movemask_ps(_mm_cmplt_ps(dot, radius)) << i;
+  }
+  if (behind != 0) {
+    if (plane != nullptr) {
+      std::uint8_t first = 0;
+      while (!(behind & (1 << first))) {
+        ++first;
+      }
+      *plane = first;
+    }
+    return OUTSIDE;
+  }
+  return intersecting != 0 ? INTERSECTING : INSIDE;
+}
+#endif
+
+result classify(frustum const& planes, glm::vec4 const& sphere, std::uint8_t* plane) {
+#ifdef FRUSTUM_CULLING_X86
+  if (matrix_kernels::active_isa() != matrix_kernels::SCALAR) {
+    return classify_sse(planes, sphere, plane);
+  }
+#endif
+  return classify_scalar(planes, sphere, plane);
+}
+
+bool outside(frustum const& planes, glm::vec4 const& sphere, std::uint8_t plane) {
+  return plane < 8 && distance(planes, sphere, plane) < -sphere.w;
+}
+
+void transform(glm::mat4 const* worlds, glm::vec4 const* spheres, glm::vec4* out, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    glm::mat4 const& world = worlds[i];
+    glm::vec4 const& sphere = spheres[i];
+    if (sphere.w < 0.0f) {
+      out[i] = sphere;
+      continue;
+    }
+    glm::vec4 center = world * glm::vec4(sphere.x, sphere.y, sphere.z, 1.0f);
+    // squared lengths of the transformed axes
+    float scale = std::max(glm::dot(glm::vec3(world[0]), glm::vec3(world[0])),
+                           std::max(glm::dot(glm::vec3(world[1]), glm::vec3(world[1])),
+                                    glm::dot(glm::vec3(world[2]), glm::vec3(world[2]))));
+    out[i] = glm::vec4(center.x, center.y, center.z, sphere.w * std::sqrt(scale));
+  }
+}
+
+glm::vec4 merge(glm::vec4 const& a, glm::vec4 const& b) {
+  if (b.w < 0.0f) {
+    return a;
+  }
+  if (a.w < 0.0f) {
+    return b;
+  }
+  glm::vec3 offset = glm::vec3(b) - glm::vec3(a);
+  float separation = glm::length(offset);
+  // one contains the other
+  if (separation + b.w <= a.w) {
+    return a;
+  }
+  if (separation + a.w <= b.w) {
+    return b;
+  }
+  float radius = (separation + a.w + b.w) * 0.5f;
+  glm::vec3 center = glm::vec3(a) + offset * ((radius - a.w) / separation);
+  return glm::vec4(center, radius);
+}
+
+}
@@ -0,0 +1,139 @@
+#include "mapped_file.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+
+mapped_file::mapped_file()
+ :m_data{nullptr}
+ ,m_size{0}
+ ,m_mapped{false}
+ ,m_buffer{}
+{}
+
+mapped_file::mapped_file(std::string const& path)
+ :mapped_file{}
+{
+#ifndef _WIN32
+  int file = open(path.c_str(), O_RDONLY);
+  if (file < 0) {
+    throw std::logic_error("mapped_file: could not open " + path);
+  }
+  struct stat status;
+  if (fstat(file, &status) != 0) {
+    close(file);
+    throw std::logic_error("mapped_file: could not read " + path);
+  }
+  // empty files can not be mapped
+  if (status.st_size > 0) {
+    void* mapping = mmap(nullptr, std::size_t(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    if (mapping == MAP_FAILED) {
+      close(file);
+      throw std::logic_error("mapped_file: could not map " + path);
+    }
+    m_data = static_cast<char const*>(mapping);
+    m_size = std::size_t(status.st_size);
+    m_mapped = true;
+  }
+  // the mapping stays valid without the descriptor
+  close(file);
+#else
+  // no mapping on this platform, the file is read as a whole
+  std::ifstream file{path, std::ios::binary};
+  if (!file) {
+    throw std::logic_error("mapped_file: could not open " + path);
+  }
+  m_buffer.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+  m_data = m_buffer.empty() ? nullptr : m_buffer.data();
+  m_size = m_buffer.size();
+#endif
+}
+
+mapped_file::~mapped_file() {
+  release();
+}
+
+mapped_file::mapped_file(mapped_file&& other)
+ :m_data{other.m_data}
+ ,m_size{other.m_size}
+ ,m_mapped{other.m_mapped}
+ ,m_buffer{std::move(other.m_buffer)}
+{
+  other.m_data = nullptr;
+  other.m_size = 0;
+  other.m_mapped = false;
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) {
+  if (this != &other) {
+    release();
+    m_data = other.m_data;
+    m_size = other.m_size;
+    m_mapped = other.m_mapped;
+    // moving the vector keeps its storage, so m_data stays valid
+    m_buffer = std::move(other.m_buffer);
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_mapped = false;
+  }
+  return *this;
+}
+
+char const* mapped_file::data() const {
+  return m_data;
+}
+
+std::size_t mapped_file::size() const {
+  return m_size;
+}
+
+void mapped_file::release() {
+#ifndef _WIN32
+  if (m_mapped) {
+    munmap(const_cast<char*>(m_data), m_size);
+  }
+#endif
+  m_data = nullptr;
+  m_size = 0;
+  m_mapped = false;
+  m_buffer.clear();
+}
+
+bool replace_file(std::string const& path, char const* data, std::size_t size) {
+  // processes and threads writing the same file each use their own temporary one
+  static std::atomic<unsigned> written{0};
+#ifndef _WIN32
+  long process = long(getpid());
+#else
+  long process = long(_getpid());
+#endif
+  std::string temporary = path + "." + std::to_string(process) + "." + std::to_string(written++) + ".tmp";
+  std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+  out.write(data, std::streamsize(size));
+  out.close();
+  if (!out) {
+    std::remove(temporary.c_str());
+    return false;
+  }
+#ifdef _WIN32
+  // rename does not replace existing files here
+  std::remove(path.c_str());
+#endif
+  if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
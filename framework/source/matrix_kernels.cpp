@@ -0,0 +1,339 @@
+#include "matrix_kernels.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+// vector kernels are only provided for x86-64, where SSE is always available
+#if defined(__x86_64__) || defined(_M_X64)
+#define MATRIX_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// compile AVX kernels without requiring AVX for the whole library
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX __attribute__((target("avx")))
+#else
+#define TARGET_AVX
+#endif
+
+namespace matrix_kernels {
+
+///////////////////////////// scalar kernels /////////////////////////////////
+static inline void multiply_scalar(float const* a, float const* b, float* out) {
+  glm::mat4 result = glm::make_mat4(a) * glm::make_mat4(b);
+  float const* r = glm::value_ptr(result);
+  for (unsigned i = 0; i < 16; ++i) {
+    out[i] = r[i];
+  }
+}
+
+// write upper 3x3 and identity remainder
+static inline void store_normal(float const n[9], float* out) {
+  out[0] = n[0]; out[1] = n[1]; out[2] = n[2]; out[3] = 0.0f;
+  out[4] = n[3]; out[5] = n[4]; out[6] = n[5]; out[7] = 0.0f;
+  out[8] = n[6]; out[9] = n[7]; out[10] = n[8]; out[11] = 0.0f;
+  out[12] = 0.0f; out[13] = 0.0f; out[14] = 0.0f; out[15] = 1.0f;
+}
+
+// columns of the inverse transpose are the cross products of the other two columns divided by the determinant
+// vector kernels evaluate the same expressions lane-wise
+static inline void normal_scalar(float const* m, float* out) {
+  float ax = m[0], ay = m[1], az = m[2];
+  float bx = m[4], by = m[5], bz = m[6];
+  float cx = m[8], cy = m[9], cz = m[10];
+  float n[9] = {
+    by * cz - bz * cy, bz * cx - bx * cz, bx * cy - by * cx,
+    cy * az - cz * ay, cz * ax - cx * az, cx * ay - cy * ax,
+    ay * bz - az * by, az * bx - ax * bz, ax * by - ay * bx
+  };
+  float det = ax * n[0] + ay * n[1] + az * n[2];
+  for (unsigned i = 0; i < 9; ++i) {
+    n[i] = n[i] / det;
+  }
+  store_normal(n, out);
+}
+
+#ifdef MATRIX_KERNELS_X86
+///////////////////////////// SSE kernels ////////////////////////////////////
+// one column per register, sums in glm order ((a0*b0 + a1*b1) + a2*b2) + a3*b3
+static inline void multiply_sse(float const* a, float const* b, float* out) {
+  __m128 a0 = _mm_loadu_ps(a);
+  __m128 a1 = _mm_loadu_ps(a + 4);
+  __m128 a2 = _mm_loadu_ps(a + 8);
+  __m128 a3 = _mm_loadu_ps(a + 12);
+  for (unsigned j = 0; j < 16; j += 4) {
+    __m128 r = _mm_mul_ps(a0, _mm_set1_ps(b[j]));
+    r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b[j + 1])));
+    r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b[j + 2])));
+    r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b[j + 3])));
+    _mm_storeu_ps(out + j, r);
+  }
+}
+
+// four matrices at once, one matrix per lane
+static void normal_sse(glm::mat4 const* m, glm::mat4* out) {
+  float const* p[4] = {glm::value_ptr(m[0]), glm::value_ptr(m[1]), glm::value_ptr(m[2]), glm::value_ptr(m[3])};
+  __m128 e[9];
+  static const unsigned element[9] = {0, 1, 2, 4, 5, 6, 8, 9, 10};
+  for (unsigned k = 0; k < 9; ++k) {
+    e[k] = _mm_setr_ps(p[0][element[k]], p[1][element[k]], p[2][element[k]], p[3][element[k]]);
+  }
+  __m128 ax = e[0], ay = e[1], az = e[2];
+  __m128 bx = e[3], by = e[4], bz = e[5];
+  __m128 cx = e[6], cy = e[7], cz = e[8];
+  __m128 n[9] = {
+    _mm_sub_ps(_mm_mul_ps(by, cz), _mm_mul_ps(bz, cy)),
+    _mm_sub_ps(_mm_mul_ps(bz, cx), _mm_mul_ps(bx, cz)),
+    _mm_sub_ps(_mm_mul_ps(bx, cy), _mm_mul_ps(by, cx)),
+    _mm_sub_ps(_mm_mul_ps(cy, az), _mm_mul_ps(cz, ay)),
+    _mm_sub_ps(_mm_mul_ps(cz, ax), _mm_mul_ps(cx, az)),
+    _mm_sub_ps(_mm_mul_ps(cx, ay), _mm_mul_ps(cy, ax)),
+    _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by)),
+    _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz)),
+    _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx))
+  };
+  __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, n[0]), _mm_mul_ps(ay, n[1])), _mm_mul_ps(az, n[2]));
+  float lanes[9][4];
+  for (unsigned k = 0; k < 9; ++k) {
+    _mm_storeu_ps(lanes[k], _mm_div_ps(n[k], det));
+  }
+  for (unsigned i = 0; i < 4; ++i) {
+    float result[9];
+    for (unsigned k = 0; k < 9; ++k) {
+      result[k] = lanes[k][i];
+    }
+    store_normal(result, glm::value_ptr(out[i]));
+  }
+}
+
+///////////////////////////// AVX kernels ////////////////////////////////////
+// broadcast scalar x to the lower and y to the upper half
+TARGET_AVX static inline __m256 set_halves(float x, float y) {
+  return _mm256_set_ps(y, y, y, y, x, x, x, x);
+}
+
+// two columns per register, same summation order as the SSE kernel
+TARGET_AVX static inline void multiply_avx(float const* a, float const* b, float* out) {
+  __m128 c0 = _mm_loadu_ps(a);
+  __m128 c1 = _mm_loadu_ps(a + 4);
+  __m128 c2 = _mm_loadu_ps(a + 8);
+  __m128 c3 = _mm_loadu_ps(a + 12);
+  __m256 a0 = _mm256_insertf128_ps(_mm256_castps128_ps256(c0), c0, 1);
+  __m256 a1 = _mm256_insertf128_ps(_mm256_castps128_ps256(c1), c1, 1);
+  __m256 a2 = _mm256_insertf128_ps(_mm256_castps128_ps256(c2), c2, 1);
+  __m256 a3 = _mm256_insertf128_ps(_mm256_castps128_ps256(c3), c3, 1);
+  for (unsigned j = 0; j < 16; j += 8) {
+    __m256 r = _mm256_mul_ps(a0, set_halves(b[j], b[j + 4]));
+    r = _mm256_add_ps(r, _mm256_mul_ps(a1, set_halves(b[j + 1], b[j + 5])));
+    r = _mm256_add_ps(r, _mm256_mul_ps(a2, set_halves(b[j + 2], b[j + 6])));
+    r = _mm256_add_ps(r, _mm256_mul_ps(a3, set_halves(b[j + 3], b[j + 7])));
+    _mm256_storeu_ps(out + j, r);
+  }
+}
+
+// eight matrices at once, one matrix per lane
+TARGET_AVX static void normal_avx(glm::mat4 const* m, glm::mat4* out) {
+  static const unsigned element[9] = {0, 1, 2, 4, 5, 6, 8, 9, 10};
+  __m256 e[9];
+  for (unsigned k = 0; k < 9; ++k) {
+    unsigned x = element[k];
+    e[k] = _mm256_setr_ps(m[0][x / 4][x % 4], m[1][x / 4][x % 4], m[2][x / 4][x % 4], m[3][x / 4][x % 4],
+                          m[4][x / 4][x % 4], m[5][x / 4][x % 4], m[6][x / 4][x % 4], m[7][x / 4][x % 4]);
+  }
+  __m256 ax = e[0], ay = e[1], az = e[2];
+  __m256 bx = e[3], by = e[4], bz = e[5];
+  __m256 cx = e[6], cy = e[7], cz = e[8];
+  __m256 n[9] = {
+    _mm256_sub_ps(_mm256_mul_ps(by, cz), _mm256_mul_ps(bz, cy)),
+    _mm256_sub_ps(_mm256_mul_ps(bz, cx), _mm256_mul_ps(bx, cz)),
+    _mm256_sub_ps(_mm256_mul_ps(bx, cy), _mm256_mul_ps(by, cx)),
+    _mm256_sub_ps(_mm256_mul_ps(cy, az), _mm256_mul_ps(cz, ay)),
+    _mm256_sub_ps(_mm256_mul_ps(cz, ax), _mm256_mul_ps(cx, az)),
+    _mm256_sub_ps(_mm256_mul_ps(cx, ay), _mm256_mul_ps(cy, ax)),
+    _mm256_sub_ps(_mm256_mul_ps(ay, bz), _mm256_mul_ps(az, by)),
+    _mm256_sub_ps(_mm256_mul_ps(az, bx), _mm256_mul_ps(ax, bz)),
+    _mm256_sub_ps(_mm256_mul_ps(ax, by), _mm256_mul_ps(ay, bx))
+  };
+  __m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, n[0]), _mm256_mul_ps(ay, n[1])),
+                             _mm256_mul_ps(az, n[2]));
+  float lanes[9][8];
+  for (unsigned k = 0; k < 9; ++k) {
+    _mm256_storeu_ps(lanes[k], _mm256_div_ps(n[k], det));
+  }
+  for (unsigned i = 0; i < 8; ++i) {
+    float result[9];
+    for (unsigned k = 0; k < 9; ++k) {
+      result[k] = lanes[k][i];
+    }
+    store_normal(result, glm::value_ptr(out[i]));
+  }
+}
+
+///////////////////////////// batch loops per instruction set ////////////////
+static void multiply_batch_sse(float const* lhs, std::size_t lhs_step, float const* rhs, float* out, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    multiply_sse(lhs + i * lhs_step, rhs + i * 16, out + i * 16);
+  }
+}
+
+TARGET_AVX static void multiply_batch_avx(float const* lhs, std::size_t lhs_step, float const* rhs, float* out, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    multiply_avx(lhs + i * lhs_step, rhs + i * 16, out + i * 16);
+  }
+}
+
+static void propagate_sse(std::size_t const* parents, float const* locals, float* worlds, std::size_t begin, std::size_t end) {
+  for (std::size_t i = begin; i < end; ++i) {
+    std::size_t parent = parents[i];
+    if (parent >= i) {
+      _mm_storeu_ps(worlds + i * 16, _mm_loadu_ps(locals + i * 16));
+      _mm_storeu_ps(worlds + i * 16 + 4, _mm_loadu_ps(locals + i * 16 + 4));
+      _mm_storeu_ps(worlds + i * 16 + 8, _mm_loadu_ps(locals + i * 16 + 8));
+      _mm_storeu_ps(worlds + i * 16 + 12, _mm_loadu_ps(locals + i * 16 + 12));
+    } else {
+      multiply_sse(worlds + parent * 16, locals + i * 16, worlds + i * 16);
+    }
+  }
+}
+
+TARGET_AVX static void propagate_avx(std::size_t const* parents, float const* locals, float* worlds, std::size_t begin, std::size_t end) {
+  for (std::size_t i = begin; i < end; ++i) {
+    std::size_t parent = parents[i];
+    if (parent >= i) {
+      _mm256_storeu_ps(worlds + i * 16, _mm256_loadu_ps(locals + i * 16));
+      _mm256_storeu_ps(worlds + i * 16 + 8, _mm256_loadu_ps(locals + i * 16 + 8));
+    } else {
+      multiply_avx(worlds + parent * 16, locals + i * 16, worlds + i * 16);
+    }
+  }
+}
+#endif
+
+///////////////////////////// dispatch ///////////////////////////////////////
+static isa detect_isa() {
+#ifdef MATRIX_KERNELS_X86
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  bool os_saves_avx = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+  bool cpu_has_avx = (info[2] & (1 << 28)) != 0;
+  return os_saves_avx && cpu_has_avx ? AVX : SSE;
+#else
+  // also checks if the os saves the avx registers
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx") ? AVX : SSE;
+#endif
+#else
+  return SCALAR;
+#endif
+}
+
+static isa& active_level() {
+  static isa level = supported_isa();
+  return level;
+}
+
+isa supported_isa() {
+  static const isa level = detect_isa();
+  return level;
+}
+
+isa active_isa() {
+  return active_level();
+}
+
+isa set_isa(isa requested) {
+  active_level() = requested < supported_isa() ? requested : supported_isa();
+  return active_level();
+}
+
+char const* isa_name(isa level) {
+  switch (level) {
+    case AVX: return "AVX";
+    case SSE: return "SSE";
+    default: return "scalar";
+  }
+}
+
+// lhs_step is 0 to reuse the same left matrix for every product
+static void multiply_batch(float const* lhs, std::size_t lhs_step, float const* rhs, float* out, std::size_t count) {
+#ifdef MATRIX_KERNELS_X86
+  if (active_level() == AVX) {
+    multiply_batch_avx(lhs, lhs_step, rhs, out, count);
+    return;
+  }
+  if (active_level() == SSE) {
+    multiply_batch_sse(lhs, lhs_step, rhs, out, count);
+    return;
+  }
+#endif
+  for (std::size_t i = 0; i < count; ++i) {
+    multiply_scalar(lhs + i * lhs_step, rhs + i * 16, out + i * 16);
+  }
+}
+
+void multiply(glm::mat4 const* lhs, glm::mat4 const* rhs, glm::mat4* out, std::size_t count) {
+  if (count == 0) return;
+  multiply_batch(glm::value_ptr(lhs[0]), 16, glm::value_ptr(rhs[0]), glm::value_ptr(out[0]), count);
+}
+
+void multiply(glm::mat4 const& lhs, glm::mat4 const* rhs, glm::mat4* out, std::size_t count) {
+  if (count == 0) return;
+  // copy in case lhs is part of the output
+  glm::mat4 const left = lhs;
+  multiply_batch(glm::value_ptr(left), 0, glm::value_ptr(rhs[0]), glm::value_ptr(out[0]), count);
+}
+
+void propagate(std::size_t const* parents, glm::mat4 const* locals, glm::mat4* worlds,
+               std::size_t begin, std::size_t end) {
+  if (begin >= end) return;
+  float const* local_ptr = glm::value_ptr(locals[0]);
+  float* world_ptr = glm::value_ptr(worlds[0]);
+#ifdef MATRIX_KERNELS_X86
+  if (active_level() == AVX) {
+    propagate_avx(parents, local_ptr, world_ptr, begin, end);
+    return;
+  }
+  if (active_level() == SSE) {
+    propagate_sse(parents, local_ptr, world_ptr, begin, end);
+    return;
+  }
+#endif
+  for (std::size_t i = begin; i < end; ++i) {
+    if (parents[i] >= i)
+      worlds[i] = locals[i];
+    else
+      multiply_scalar(world_ptr + parents[i] * 16, local_ptr + i * 16, world_ptr + i * 16);
+  }
+}
+
+void normal_matrices(glm::mat4 const& view, glm::mat4 const* models, glm::mat4* out, std::size_t count) {
+  // model view matrices are built in small blocks that stay in cache
+  const std::size_t block = 64;
+  glm::mat4 model_view[block];
+  for (std::size_t first = 0; first < count; first += block) {
+    std::size_t size = count - first < block ? count - first : block;
+    multiply(view, models + first, model_view, size);
+    std::size_t i = 0;
+#ifdef MATRIX_KERNELS_X86
+    if (active_level() == AVX) {
+      for (; i + 8 <= size; i += 8) {
+        normal_avx(model_view + i, out + first + i);
+      }
+    }
+    if (active_level() >= SSE) {
+      for (; i + 4 <= size; i += 4) {
+        normal_sse(model_view + i, out + first + i);
+      }
+    }
+#endif
+    // remainder
+    for (; i < size; ++i) {
+      normal_scalar(glm::value_ptr(model_view[i]), glm::value_ptr(out[first + i]));
+    }
+  }
+}
+
+}
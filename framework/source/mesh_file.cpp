@@ -0,0 +1,313 @@
+#include "mesh_file.hpp"
+
+#include <glbinding/gl/enum.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+const std::uint32_t mesh_file::version = 3;
+
+// number of attribute slots in the header, VERTEX_ATTRIBS may grow up to this size
+static const std::size_t max_attribs = 8;
+// blobs start at multiples of this, so mapped floats and indices are aligned
+static const std::size_t blob_alignment = 16;
+
+struct mesh_file::header {
+  char magic[4];
+  std::uint32_t version;
+  // flags of the contained attributes and of the attributes requested on import
+  std::uint32_t attributes;
+  std::uint32_t import_attributes;
+  // flag, components, gl type, byte offset and normalization per entry of model::VERTEX_ATTRIBS or model::PACKED_ATTRIBS
+  std::uint32_t layout[max_attribs][5];
+  std::uint32_t vertex_bytes;
+  std::uint32_t attrib_num;
+  std::uint64_t vertex_num;
+  std::uint64_t index_num;
+  // byte offsets of the blobs from the start of the file
+  std::uint64_t vertex_offset;
+  std::uint64_t index_offset;
+  // identify the source the mesh was created from
+  std::uint64_t source_size;
+  std::int64_t source_time;
+  float bounds[4];
+  // whether the vertices are packed, their positions are offset + scale * position
+  std::uint32_t packed;
+  float position_scale[3];
+  float position_offset[3];
+  std::uint32_t reserved;
+};
+
+static std::size_t align(std::size_t offset) {
+  return (offset + blob_alignment - 1) / blob_alignment * blob_alignment;
+}
+
+mesh_file::mesh_file()
+ :m_data{nullptr}
+ ,m_size{0}
+ ,m_file{}
+ ,m_buffer{}
+{}
+
+mesh_file::mesh_file(model const& mesh, model::attrib_flag_t import_attribs,
+                     std::uint64_t source_size, std::int64_t source_time)
+ :mesh_file{}
+{
+  if (model::VERTEX_ATTRIBS.size() > max_attribs) {
+    throw std::logic_error("mesh_file: too many vertex attributes");
+  }
+  std::size_t vertex_size = mesh.vertex_num * std::size_t(mesh.vertex_bytes);
+  std::size_t vertex_offset = align(sizeof(header));
+  std::size_t index_offset = align(vertex_offset + vertex_size);
+  m_buffer.assign(index_offset + mesh.indices.size() * sizeof(GLuint), 0);
+
+  header info{};
+  std::memcpy(info.magic, "MESH", 4);
+  info.version = version;
+  info.import_attributes = std::uint32_t(import_attribs);
+  std::vector<model::attribute> const& layout = model::vertex_attribs(mesh.packed);
+  info.attrib_num = std::uint32_t(layout.size());
+  for (std::size_t i = 0; i < layout.size(); ++i) {
+    model::attribute const& attribute = layout[i];
+    info.layout[i][0] = std::uint32_t(attribute.flag);
+    info.layout[i][1] = std::uint32_t(attribute.components);
+    info.layout[i][2] = std::uint32_t(attribute.type);
+    info.layout[i][4] = attribute.normalized ? 1 : 0;
+    auto found = mesh.offsets.find(attribute.flag);
+    if (found != mesh.offsets.end()) {
+      info.attributes |= std::uint32_t(attribute.flag);
+      info.layout[i][3] = std::uint32_t(reinterpret_cast<std::uintptr_t>(found->second));
+    }
+  }
+  info.vertex_bytes = std::uint32_t(mesh.vertex_bytes);
+  info.vertex_num = mesh.vertex_num;
+  info.index_num = mesh.indices.size();
+  info.vertex_offset = vertex_offset;
+  info.index_offset = index_offset;
+  info.source_size = source_size;
+  info.source_time = source_time;
+  for (int i = 0; i < 4; ++i) {
+    info.bounds[i] = mesh.bounding_sphere[i];
+  }
+  info.packed = mesh.packed ? 1 : 0;
+  for (int i = 0; i < 3; ++i) {
+    info.position_scale[i] = mesh.position_scale[i];
+    info.position_offset[i] = mesh.position_offset[i];
+  }
+
+  std::memcpy(m_buffer.data(), &info, sizeof(info));
+  if (vertex_size > 0) {
+    std::memcpy(m_buffer.data() + vertex_offset, mesh.data.data(), vertex_size);
+  }
+  if (!mesh.indices.empty()) {
+    std::memcpy(m_buffer.data() + index_offset, mesh.indices.data(), mesh.indices.size() * sizeof(GLuint));
+  }
+  m_data = m_buffer.data();
+  m_size = m_buffer.size();
+}
+
+mesh_file::mesh_file(std::string const& path)
+ :mesh_file{}
+{
+  m_file = mapped_file{path};
+  m_data = m_file.data();
+  m_size = m_file.size();
+  try {
+    validate(path);
+  }
+  catch (std::logic_error&) {
+    release();
+    throw;
+  }
+}
+
+mesh_file::~mesh_file() {
+  release();
+}
+
+mesh_file::mesh_file(mesh_file&& other)
+ :m_data{other.m_data}
+ ,m_size{other.m_size}
+ ,m_file{std::move(other.m_file)}
+ ,m_buffer{std::move(other.m_buffer)}
+{
+  other.m_data = nullptr;
+  other.m_size = 0;
+}
+
+mesh_file& mesh_file::operator=(mesh_file&& other) {
+  if (this != &other) {
+    release();
+    m_data = other.m_data;
+    m_size = other.m_size;
+    // moving keeps the mapping and the storage of the vector, so m_data stays valid
+    m_file = std::move(other.m_file);
+    m_buffer = std::move(other.m_buffer);
+    other.m_data = nullptr;
+    other.m_size = 0;
+  }
+  return *this;
+}
+
+bool mesh_file::write(std::string const& path) const {
+  if (m_data == nullptr) {
+    return false;
+  }
+  return replace_file(path, m_data, m_size);
+}
+
+bool mesh_file::matches(model::attrib_flag_t import_attribs, std::uint64_t source_size, std::int64_t source_time) const {
+  return m_data != nullptr && head().import_attributes == std::uint32_t(import_attribs)
+      && head().source_size == source_size && head().source_time == source_time;
+}
+
+model::attrib_flag_t mesh_file::attributes() const {
+  return m_data == nullptr ? 0 : model::attrib_flag_t(head().attributes);
+}
+
+GLsizei mesh_file::vertex_bytes() const {
+  return m_data == nullptr ? 0 : GLsizei(head().vertex_bytes);
+}
+
+std::size_t mesh_file::vertex_num() const {
+  return m_data == nullptr ? 0 : std::size_t(head().vertex_num);
+}
+
+std::size_t mesh_file::index_num() const {
+  return m_data == nullptr ? 0 : std::size_t(head().index_num);
+}
+
+void const* mesh_file::vertices() const {
+  return m_data == nullptr ? nullptr : m_data + head().vertex_offset;
+}
+
+GLuint const* mesh_file::indices() const {
+  return m_data == nullptr ? nullptr : reinterpret_cast<GLuint const*>(m_data + head().index_offset);
+}
+
+GLvoid* mesh_file::offset(model::attrib_flag_t attribute) const {
+  if (m_data != nullptr) {
+    for (std::uint32_t i = 0; i < head().attrib_num; ++i) {
+      if (head().layout[i][0] == std::uint32_t(attribute)) {
+        return (GLvoid*)std::uintptr_t(head().layout[i][3]);
+      }
+    }
+  }
+  return nullptr;
+}
+
+bool mesh_file::packed() const {
+  return m_data != nullptr && head().packed != 0;
+}
+
+model::attribute const& mesh_file::layout(model::attrib_flag_t attribute) const {
+  for (auto const& supported_attribute : model::vertex_attribs(packed())) {
+    if (supported_attribute.flag == attribute) {
+      return supported_attribute;
+    }
+  }
+  throw std::logic_error("mesh_file: no vertex attribute with flag " + std::to_string(attribute));
+}
+
+glm::fvec3 mesh_file::position_scale() const {
+  if (m_data == nullptr) {
+    return glm::fvec3{1.0f};
+  }
+  return glm::fvec3{head().position_scale[0], head().position_scale[1], head().position_scale[2]};
+}
+
+glm::fvec3 mesh_file::position_offset() const {
+  if (m_data == nullptr) {
+    return glm::fvec3{0.0f};
+  }
+  return glm::fvec3{head().position_offset[0], head().position_offset[1], head().position_offset[2]};
+}
+
+glm::fvec4 mesh_file::bounding_sphere() const {
+  if (m_data == nullptr) {
+    return glm::fvec4{0.0f, 0.0f, 0.0f, -1.0f};
+  }
+  return glm::fvec4{head().bounds[0], head().bounds[1], head().bounds[2], head().bounds[3]};
+}
+
+model mesh_file::to_model() const {
+  if (m_data == nullptr) {
+    return model{};
+  }
+  float const* first = static_cast<float const*>(vertices());
+  std::vector<GLfloat> data(first, first + vertex_num() * std::size_t(vertex_bytes()) / sizeof(float));
+  std::vector<GLuint> triangles(indices(), indices() + index_num());
+  model mesh{data, attributes(), triangles, packed()};
+  // packed models do not compute their bounds
+  mesh.bounding_sphere = bounding_sphere();
+  mesh.position_scale = position_scale();
+  mesh.position_offset = position_offset();
+  return mesh;
+}
+
+mesh_file::header const& mesh_file::head() const {
+  static_assert(sizeof(header) == 280, "mesh file header must not depend on padding");
+  return *reinterpret_cast<header const*>(m_data);
+}
+
+void mesh_file::validate(std::string const& path) const {
+  if (m_size < sizeof(header) || std::memcmp(head().magic, "MESH", 4) != 0) {
+    throw std::logic_error("mesh_file: " + path + " is no mesh file");
+  }
+  header const& info = head();
+  if (info.version != version) {
+    throw std::logic_error("mesh_file: " + path + " has version " + std::to_string(info.version));
+  }
+  // layout must match the attributes of this build
+  std::vector<model::attribute> const& layout = model::vertex_attribs(info.packed != 0);
+  bool layout_matches = info.attrib_num == layout.size();
+  std::uint32_t known_attributes = 0;
+  for (std::size_t i = 0; layout_matches && i < layout.size(); ++i) {
+    model::attribute const& attribute = layout[i];
+    known_attributes |= std::uint32_t(attribute.flag);
+    layout_matches = info.layout[i][0] == std::uint32_t(attribute.flag)
+                  && info.layout[i][1] == std::uint32_t(attribute.components)
+                  && info.layout[i][2] == std::uint32_t(attribute.type)
+                  && info.layout[i][4] == (attribute.normalized ? 1u : 0u);
+  }
+  if (!layout_matches || (info.attributes & ~known_attributes) != 0) {
+    throw std::logic_error("mesh_file: " + path + " has another attribute layout");
+  }
+  // contained attributes must be packed in layout order like in model, absent ones have no offset
+  model expected{std::vector<GLfloat>{}, model::attrib_flag_t(info.attributes), std::vector<GLuint>{}, info.packed != 0};
+  bool offsets_match = info.vertex_bytes == std::uint32_t(expected.vertex_bytes);
+  for (std::size_t i = 0; offsets_match && i < layout.size(); ++i) {
+    model::attribute const& attribute = layout[i];
+    std::uint32_t offset = info.layout[i][3];
+    if (info.attributes & std::uint32_t(attribute.flag)) {
+      offsets_match = offset == std::uint32_t(reinterpret_cast<std::uintptr_t>(expected.offsets.at(attribute.flag)))
+                   && std::uint64_t(offset) + std::uint64_t(attribute.bytes()) <= info.vertex_bytes;
+    }
+    else {
+      offsets_match = offset == 0;
+    }
+  }
+  if (!offsets_match) {
+    throw std::logic_error("mesh_file: " + path + " has invalid attribute offsets");
+  }
+  // blobs must be aligned and lie inside the file, their sizes are compared with the bytes left after
+  // their offsets, so corrupt values can not overflow
+  std::uint64_t const size = m_size;
+  if (info.vertex_offset % blob_alignment != 0 || info.index_offset % blob_alignment != 0
+   || info.vertex_offset < sizeof(header) || info.vertex_offset > size || info.index_offset > size
+   || info.index_offset < info.vertex_offset) {
+    throw std::logic_error("mesh_file: " + path + " is truncated");
+  }
+  if ((info.vertex_bytes != 0 && info.vertex_num > (info.index_offset - info.vertex_offset) / info.vertex_bytes)
+   || info.index_num > (size - info.index_offset) / sizeof(GLuint)) {
+    throw std::logic_error("mesh_file: " + path + " is truncated");
+  }
+}
+
+void mesh_file::release() {
+  m_data = nullptr;
+  m_size = 0;
+  m_file = mapped_file{};
+  m_buffer.clear();
+}
@@ -0,0 +1,305 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <utility>
+
+namespace mesh_optimizer {
+
+// parameters of the scoring from the original description
+static const unsigned max_cache = 32;
+static const float cache_decay_power = 1.5f;
+static const float last_triangle_score = 0.75f;
+static const float valence_boost_scale = 2.0f;
+static const float valence_boost_power = 0.5f;
+
+// vertices used by the last triangle score the same, so its winding order does not matter
+// vertices with few remaining triangles are preferred, so no lonely triangles are left behind
+static float vertex_score(int cache_position, unsigned remaining) {
+  if (remaining == 0) {
+    return -1.0f;
+  }
+  float score = 0.0f;
+  if (cache_position >= 0) {
+    if (cache_position < 3) {
+      score = last_triangle_score;
+    }
+    else {
+      float scaled = 1.0f - float(cache_position - 3) / float(max_cache - 3);
+      score = std::pow(scaled, cache_decay_power);
+    }
+  }
+  return score + valence_boost_scale * std::pow(float(remaining), -valence_boost_power);
+}
+
+cache_statistics analyze(std::vector<GLuint> const& indices, std::size_t vertex_num, unsigned cache_size) {
+  // a vertex is cached while fewer than cache_size other vertices were inserted after it
+  std::vector<std::size_t> inserted(vertex_num, 0);
+  std::size_t misses = 0;
+  for (GLuint index : indices) {
+    if (inserted[index] == 0 || misses - inserted[index] >= cache_size) {
+      ++misses;
+      inserted[index] = misses;
+    }
+  }
+  std::size_t referenced = std::size_t(std::count_if(inserted.begin(), inserted.end(), [](std::size_t time) {
+    return time != 0;
+  }));
+  cache_statistics statistics{0.0f, 0.0f};
+  if (!indices.empty()) {
+    statistics.acmr = float(misses) / float(indices.size() / 3);
+    statistics.atvr = float(misses) / float(referenced);
+  }
+  return statistics;
+}
+
+std::size_t deduplicate(std::vector<GLfloat> const& data, std::size_t vertex_num, std::vector<GLuint>& remap) {
+  remap.assign(vertex_num, removed);
+  if (vertex_num == 0) {
+    return 0;
+  }
+  std::size_t const stride = data.size() / vertex_num;
+  // chained hash table over the bytes of the distinct vertices
+  std::size_t buckets = 1;
+  while (buckets < vertex_num * 2) {
+    buckets <<= 1;
+  }
+  std::vector<GLuint> heads(buckets, removed);
+  std::vector<GLuint> next(vertex_num, removed);
+  std::size_t distinct = 0;
+  for (std::size_t v = 0; v < vertex_num; ++v) {
+    GLfloat const* vertex = data.data() + v * stride;
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (std::size_t i = 0; i < stride; ++i) {
+      std::uint32_t bits = 0;
+      std::memcpy(&bits, vertex + i, sizeof(bits));
+      hash = (hash ^ bits) * 0x100000001b3ull;
+    }
+    std::size_t bucket = std::size_t(hash ^ (hash >> 32)) & (buckets - 1);
+    for (GLuint candidate = heads[bucket]; candidate != removed; candidate = next[candidate]) {
+      if (std::memcmp(vertex, data.data() + candidate * stride, stride * sizeof(GLfloat)) == 0) {
+        remap[v] = remap[candidate];
+        break;
+      }
+    }
+    if (remap[v] == removed) {
+      remap[v] = GLuint(distinct++);
+      next[v] = heads[bucket];
+      heads[bucket] = GLuint(v);
+    }
+  }
+  return distinct;
+}
+
+std::vector<GLuint> optimize_cache(std::vector<GLuint> const& indices, std::size_t vertex_num) {
+  std::size_t const triangle_num = indices.size() / 3;
+  std::size_t const none = triangle_num;
+
+  // triangles of each vertex, the first remaining[v] of them are not emitted yet
+  std::vector<unsigned> remaining(vertex_num, 0);
+  for (GLuint index : indices) {
+    ++remaining[index];
+  }
+  std::vector<std::size_t> offsets(vertex_num + 1, 0);
+  for (std::size_t v = 0; v < vertex_num; ++v) {
+    offsets[v + 1] = offsets[v] + remaining[v];
+  }
+  std::vector<std::size_t> adjacent(indices.size());
+  std::vector<std::size_t> filled(offsets.begin(), offsets.end() - 1);
+  for (std::size_t i = 0; i < triangle_num * 3; ++i) {
+    adjacent[filled[indices[i]]++] = i / 3;
+  }
+
+  std::vector<int> cache_positions(vertex_num, -1);
+  std::vector<float> vertex_scores(vertex_num);
+  for (std::size_t v = 0; v < vertex_num; ++v) {
+    vertex_scores[v] = vertex_score(-1, remaining[v]);
+  }
+  // scores of the vertices as if they were not cached, only change with their remaining triangles
+  std::vector<float> uncached_scores(vertex_scores);
+  auto triangle_score = [&](std::size_t t) {
+    return vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+  };
+  std::vector<float> triangle_scores(triangle_num);
+  std::vector<bool> emitted(triangle_num, false);
+  std::size_t best = none;
+  for (std::size_t t = 0; t < triangle_num; ++t) {
+    triangle_scores[t] = triangle_score(t);
+    if (best == none || triangle_scores[t] > triangle_scores[best]) {
+      best = t;
+    }
+  }
+
+  // when no cached vertex has triangles left, all remaining triangles are uncached and the best of them is
+  // taken from a lazily updated heap, the scores only grow, so entries with an outdated score are skipped
+  // triangles whose score changed are pushed again at the next dead end, unless they were emitted until then
+  auto uncached_score = [&](std::size_t t) {
+    return uncached_scores[indices[t * 3]] + uncached_scores[indices[t * 3 + 1]] + uncached_scores[indices[t * 3 + 2]];
+  };
+  typedef std::pair<float, std::size_t> scored_triangle;
+  // higher scores first, earlier triangles on ties
+  auto lower = [](scored_triangle const& a, scored_triangle const& b) {
+    return a.first < b.first || (a.first == b.first && a.second > b.second);
+  };
+  std::vector<scored_triangle> initial_scores(triangle_num);
+  for (std::size_t t = 0; t < triangle_num; ++t) {
+    initial_scores[t] = scored_triangle{triangle_scores[t], t};
+  }
+  std::priority_queue<scored_triangle, std::vector<scored_triangle>, decltype(lower)> restarts{lower,
+                                                                                               std::move(initial_scores)};
+  std::vector<bool> changed(triangle_num, false);
+  std::vector<std::size_t> changed_triangles{};
+
+  std::vector<GLuint> ordered{};
+  ordered.reserve(triangle_num * 3);
+  std::vector<GLuint> cache{};
+  std::vector<GLuint> next_cache{};
+  for (std::size_t emitted_num = 0; emitted_num < triangle_num; ++emitted_num) {
+    // no cached vertex has triangles left, restart from the best uncached triangle
+    if (best == none) {
+      for (std::size_t t : changed_triangles) {
+        changed[t] = false;
+        if (!emitted[t]) {
+          restarts.push(scored_triangle{uncached_score(t), t});
+        }
+      }
+      changed_triangles.clear();
+    }
+    while (best == none) {
+      scored_triangle candidate = restarts.top();
+      restarts.pop();
+      if (!emitted[candidate.second] && candidate.first == uncached_score(candidate.second)) {
+        best = candidate.second;
+      }
+    }
+    std::size_t const triangle = best;
+    emitted[triangle] = true;
+    GLuint const* corners = indices.data() + triangle * 3;
+    ordered.insert(ordered.end(), corners, corners + 3);
+
+    // remove the triangle from the remaining ones of its vertices
+    for (int c = 0; c < 3; ++c) {
+      GLuint v = corners[c];
+      std::size_t* first = adjacent.data() + offsets[v];
+      std::size_t* last = first + remaining[v];
+      std::size_t* found = std::find(first, last, triangle);
+      std::swap(*found, *(last - 1));
+      --remaining[v];
+      uncached_scores[v] = vertex_score(-1, remaining[v]);
+      for (std::size_t i = offsets[v]; i < offsets[v] + remaining[v]; ++i) {
+        if (!changed[adjacent[i]]) {
+          changed[adjacent[i]] = true;
+          changed_triangles.push_back(adjacent[i]);
+        }
+      }
+    }
+
+    // vertices of the triangle move to the front of the lru cache
+    next_cache.clear();
+    for (int c = 0; c < 3; ++c) {
+      if (std::find(next_cache.begin(), next_cache.end(), corners[c]) == next_cache.end()) {
+        next_cache.push_back(corners[c]);
+      }
+    }
+    for (GLuint v : cache) {
+      if (v != corners[0] && v != corners[1] && v != corners[2]) {
+        next_cache.push_back(v);
+      }
+    }
+    // evicted vertices are scored as well, their triangles become less attractive
+    for (std::size_t i = 0; i < next_cache.size(); ++i) {
+      GLuint v = next_cache[i];
+      cache_positions[v] = i < max_cache ? int(i) : -1;
+      vertex_scores[v] = vertex_score(cache_positions[v], remaining[v]);
+    }
+
+    // only triangles of changed vertices change their score, the best of them is emitted next
+    best = none;
+    float best_score = -1.0f;
+    for (GLuint v : next_cache) {
+      for (std::size_t i = offsets[v]; i < offsets[v] + remaining[v]; ++i) {
+        std::size_t t = adjacent[i];
+        triangle_scores[t] = triangle_score(t);
+        if (triangle_scores[t] > best_score) {
+          best_score = triangle_scores[t];
+          best = t;
+        }
+      }
+    }
+    if (next_cache.size() > max_cache) {
+      next_cache.resize(max_cache);
+    }
+    std::swap(cache, next_cache);
+  }
+  return ordered;
+}
+
+std::size_t optimize_fetch(std::vector<GLuint> const& indices, std::size_t vertex_num, std::vector<GLuint>& remap) {
+  remap.assign(vertex_num, removed);
+  GLuint used = 0;
+  for (GLuint index : indices) {
+    if (remap[index] == removed) {
+      remap[index] = used++;
+    }
+  }
+  return used;
+}
+
+model optimize(model const& mesh, report* result) {
+  report statistics{};
+  statistics.before = analyze(mesh.indices, mesh.vertex_num);
+  statistics.vertices_before = mesh.vertex_num;
+  if (mesh.indices.empty() || mesh.vertex_num == 0) {
+    statistics.after = statistics.before;
+    statistics.vertices_after = statistics.vertices_before;
+    if (result != nullptr) {
+      *result = statistics;
+    }
+    return mesh;
+  }
+
+  std::vector<GLuint> distinct_remap{};
+  std::size_t distinct = deduplicate(mesh.data, mesh.vertex_num, distinct_remap);
+  std::vector<GLuint> indices(mesh.indices.size());
+  for (std::size_t i = 0; i < indices.size(); ++i) {
+    indices[i] = distinct_remap[mesh.indices[i]];
+  }
+  indices = optimize_cache(indices, distinct);
+
+  std::vector<GLuint> fetch_remap{};
+  std::size_t used = optimize_fetch(indices, distinct, fetch_remap);
+  std::size_t const stride = mesh.data.size() / mesh.vertex_num;
+  std::vector<GLfloat> data(used * stride);
+  for (std::size_t v = 0; v < mesh.vertex_num; ++v) {
+    GLuint target = fetch_remap[distinct_remap[v]];
+    if (target != removed) {
+      std::copy(mesh.data.begin() + std::ptrdiff_t(v * stride), mesh.data.begin() + std::ptrdiff_t((v + 1) * stride),
+                data.begin() + std::ptrdiff_t(target * stride));
+    }
+  }
+  for (GLuint& index : indices) {
+    index = fetch_remap[index];
+  }
+
+  model::attrib_flag_t attributes = 0;
+  for (auto const& offset : mesh.offsets) {
+    attributes |= offset.first;
+  }
+  model optimized{data, attributes, indices, mesh.packed};
+  if (mesh.packed) {
+    optimized.bounding_sphere = mesh.bounding_sphere;
+    optimized.position_scale = mesh.position_scale;
+    optimized.position_offset = mesh.position_offset;
+  }
+  statistics.after = analyze(optimized.indices, optimized.vertex_num);
+  statistics.vertices_after = optimized.vertex_num;
+  if (result != nullptr) {
+    *result = statistics;
+  }
+  return optimized;
+}
+
+}
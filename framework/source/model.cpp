@@ -2,17 +2,30 @@
 
 #include <glbinding/gl/enum.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <stdexcept>
+#include <string>
 
 std::vector<model::attribute> const model::VERTEX_ATTRIBS
  = {  
     /*POSITION*/{ 1 << 0, sizeof(float), 3, GL_FLOAT},
     /*NORMAL*/{   1 << 1, sizeof(float), 3, GL_FLOAT},
     /*TEXCOORD*/{ 1 << 2, sizeof(float), 2, GL_FLOAT},
-    /*TANGENT*/{  1 << 3, sizeof(float), 3, GL_FLOAT},
+    /*TANGENT*/{  1 << 3, sizeof(float), 4, GL_FLOAT},
     /*BITANGENT*/{1 << 4, sizeof(float), 3, GL_FLOAT}
  };
 
+// positions get a fourth padding short, so all packed attributes take whole words
+std::vector<model::attribute> const model::PACKED_ATTRIBS
+ = {
+    /*POSITION*/{ 1 << 0, sizeof(GLushort), 3, GL_UNSIGNED_SHORT, true},
+    /*NORMAL*/{   1 << 1, sizeof(GLuint), 4, GL_INT_2_10_10_10_REV, true},
+    /*TEXCOORD*/{ 1 << 2, sizeof(GLhalf), 2, GL_HALF_FLOAT},
+    /*TANGENT*/{  1 << 3, sizeof(GLuint), 4, GL_INT_2_10_10_10_REV, true},
+    /*BITANGENT*/{1 << 4, sizeof(GLuint), 4, GL_INT_2_10_10_10_REV, true}
+ };
+
 model::attribute const& model::POSITION = model::VERTEX_ATTRIBS[0];
 model::attribute const& model::NORMAL = model::VERTEX_ATTRIBS[1];
 model::attribute const& model::TEXCOORD = model::VERTEX_ATTRIBS[2];
@@ -20,35 +33,80 @@ model::attribute const& model::TANGENT = model::VERTEX_ATTRIBS[3];
 model::attribute const& model::BITANGENT = model::VERTEX_ATTRIBS[4];
 model::attribute const  model::INDEX{1 << 5, sizeof(unsigned),  1, GL_UNSIGNED_INT};
 
+GLsizei model::attribute::bytes() const {
+  if (type == GL_INT_2_10_10_10_REV) {
+    return size;
+  }
+  return (size * components + GLsizei(sizeof(GLuint)) - 1) / GLsizei(sizeof(GLuint)) * GLsizei(sizeof(GLuint));
+}
+
+std::vector<model::attribute> const& model::vertex_attribs(bool packed) {
+  return packed ? PACKED_ATTRIBS : VERTEX_ATTRIBS;
+}
+
 model::model()
  :data{}
  ,indices{}
  ,offsets{}
  ,vertex_bytes{0}
  ,vertex_num{0}
+ ,bounding_sphere{0.0f, 0.0f, 0.0f, -1.0f}
+ ,packed{false}
+ ,position_scale{1.0f}
+ ,position_offset{0.0f}
 {}
 
-model::model(std::vector<GLfloat> const& databuff, attrib_flag_t contained_attributes, std::vector<GLuint> const& trianglebuff)
+model::model(std::vector<GLfloat> const& databuff, attrib_flag_t contained_attributes, std::vector<GLuint> const& trianglebuff,
+             bool packed_vertices)
  :data(databuff)
  ,indices(trianglebuff)
  ,offsets{}
  ,vertex_bytes{0}
  ,vertex_num{0}
+ ,bounding_sphere{0.0f, 0.0f, 0.0f, -1.0f}
+ ,packed{packed_vertices}
+ ,position_scale{1.0f}
+ ,position_offset{0.0f}
 {
-  // number of components per vertex
-  std::size_t component_num = 0;
-
-  for (auto const& supported_attribute : model::VERTEX_ATTRIBS) {
+  for (auto const& supported_attribute : model::vertex_attribs(packed)) {
     // check if buffer contains attribute
     if (supported_attribute.flag & contained_attributes) {
       // write offset, explicit cast to prevent narrowing warning
       offsets.insert(std::pair<attrib_flag_t, GLvoid*>{supported_attribute, (GLvoid*)uintptr_t(vertex_bytes)});
       // move offset pointer forward
-      vertex_bytes += supported_attribute.size * supported_attribute.components;
-      // increase number of components
-      component_num += supported_attribute.components;
+      vertex_bytes += supported_attribute.bytes();
     }
   }
+  // number of floats or words per vertex
+  std::size_t component_num = std::size_t(vertex_bytes) / sizeof(GLfloat);
   // set number of vertice sin buffer
-  vertex_num = data.size() / component_num;
-}
\ No newline at end of file
+  vertex_num = component_num == 0 ? 0 : data.size() / component_num;
+
+  // positions are always the first attribute
+  if ((contained_attributes & POSITION) && vertex_num > 0 && !packed) {
+    glm::fvec3 min{data[0], data[1], data[2]};
+    glm::fvec3 max{min};
+    for (std::size_t i = 0; i < vertex_num; ++i) {
+      glm::fvec3 position{data[i * component_num], data[i * component_num + 1], data[i * component_num + 2]};
+      min = glm::min(min, position);
+      max = glm::max(max, position);
+    }
+    // center of the box, radius from the farthest position
+    glm::fvec3 center = (min + max) * 0.5f;
+    float radius = 0.0f;
+    for (std::size_t i = 0; i < vertex_num; ++i) {
+      glm::fvec3 position{data[i * component_num], data[i * component_num + 1], data[i * component_num + 2]};
+      radius = std::max(radius, glm::length(position - center));
+    }
+    bounding_sphere = glm::fvec4{center, radius};
+  }
+}
+
+model::attribute const& model::layout(attrib_flag_t attribute) const {
+  for (auto const& supported_attribute : model::vertex_attribs(packed)) {
+    if (supported_attribute.flag == attribute) {
+      return supported_attribute;
+    }
+  }
+  throw std::logic_error("model: no vertex attribute with flag " + std::to_string(attribute));
+}
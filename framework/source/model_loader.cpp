@@ -4,13 +4,29 @@
 #include <glm/gtc/type_precision.hpp>
 #include <glm/geometric.hpp>
 
+#include "mapped_file.hpp"
+#include "mesh_optimizer.hpp"
+#include "tangent_space.hpp"
+#include "vertex_quantization.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <sys/stat.h>
 
 namespace model_loader {
 
-void generate_normals(tinyobj::mesh_t& model);
+void generate_normals(tinyobj::mesh_t& model, ThreadPool* pool);
 
-std::vector<glm::fvec3> generate_tangents(tinyobj::mesh_t const& model);
+std::vector<glm::fvec4> generate_tangents(tinyobj::mesh_t const& model, ThreadPool* pool);
+
+static model interleave(std::vector<tinyobj::shape_t>& shapes, model::attrib_flag_t import_attribs, ThreadPool* pool);
 
 model obj(std::string const& name, model::attrib_flag_t import_attribs){
   std::vector<tinyobj::shape_t> shapes;
@@ -27,145 +43,613 @@ model obj(std::string const& name, model::attrib_flag_t import_attribs){
     }
   }
 
-  model::attrib_flag_t attributes{model::POSITION | import_attribs};
+  return interleave(shapes, import_attribs, nullptr);
+}
 
-  std::vector<float> vertex_data;
-  std::vector<unsigned> triangles;
+// run task(i) for all i in [0, count), on the pool if there is one
+static void run(ThreadPool* pool, std::size_t count, ThreadPool::Task const& task) {
+  if (pool != nullptr && count > 1) {
+    pool->run(count, task);
+  }
+  else {
+    for (std::size_t i = 0; i < count; ++i) {
+      task(i);
+    }
+  }
+}
 
+// combine the shapes into one model with the requested attributes
+static model interleave(std::vector<tinyobj::shape_t>& shapes, model::attrib_flag_t import_attribs, ThreadPool* pool) {
+  model::attrib_flag_t attributes{(model::POSITION | import_attribs) & ~(OPTIMIZE | QUANTIZE)};
+
+  // attributes and position in the output per shape
+  struct shape_layout {
+    bool has_normals;
+    bool has_uvs;
+    bool has_tangents;
+    std::vector<glm::fvec4> tangents;
+    std::size_t data_offset;
+    unsigned vertex_offset;
+    std::size_t index_offset;
+  };
+  std::vector<shape_layout> layouts(shapes.size());
+  std::size_t data_size = 0;
   unsigned vertex_offset = 0;
+  std::size_t index_count = 0;
 
-  for (auto& shape : shapes) {
-    tinyobj::mesh_t& curr_mesh = shape.mesh;
+  for (std::size_t s = 0; s < shapes.size(); ++s) {
+    tinyobj::mesh_t& curr_mesh = shapes[s].mesh;
+    shape_layout& layout = layouts[s];
     // prevent MSVC warning due to Win BOOL implementation
-    bool has_normals = (import_attribs & model::NORMAL) != 0;
-    if(has_normals) {
-      // generate normals if necessary
-      if (curr_mesh.normals.empty()) {
-        generate_normals(curr_mesh);
-      }
+    layout.has_normals = (import_attribs & model::NORMAL) != 0;
+    // generate normals if necessary, tangents are built from them
+    if ((layout.has_normals || (import_attribs & model::TANGENT)) && curr_mesh.normals.empty()) {
+      generate_normals(curr_mesh, pool);
     }
 
-    bool has_uvs = (import_attribs & model::TEXCOORD) != 0;
-    if(has_uvs) {
+    layout.has_uvs = (import_attribs & model::TEXCOORD) != 0;
+    if(layout.has_uvs) {
       if (curr_mesh.texcoords.empty()) {
-        has_uvs = false;
+        layout.has_uvs = false;
         attributes ^= model::TEXCOORD;
         std::cerr << "Shape has no texcoords" << std::endl;
       }
     }
 
-    bool has_tangents = import_attribs & model::TANGENT;
-    std::vector<glm::fvec3> tangents;
-    if (has_tangents) {
-      if (!has_uvs) {
-        has_tangents = false;
+    layout.has_tangents = (import_attribs & model::TANGENT) != 0;
+    if (layout.has_tangents) {
+      if (!layout.has_uvs) {
+        layout.has_tangents = false;
         attributes ^= model::TANGENT;
         std::cerr << "Shape has no texcoords" << std::endl;
       }
       else {
-        tangents = generate_tangents(curr_mesh);
+        layout.tangents = generate_tangents(curr_mesh, pool);
       }
     }
 
-    // push back vertex attributes
-    for (unsigned i = 0; i < curr_mesh.positions.size() / 3; ++i) {
-      vertex_data.push_back(curr_mesh.positions[i * 3]);
-      vertex_data.push_back(curr_mesh.positions[i * 3 + 1]);
-      vertex_data.push_back(curr_mesh.positions[i * 3 + 2]);
+    std::size_t components = 3 + (layout.has_normals ? 3 : 0) + (layout.has_uvs ? 2 : 0) + (layout.has_tangents ? 4 : 0);
+    layout.data_offset = data_size;
+    layout.vertex_offset = vertex_offset;
+    layout.index_offset = index_count;
+    data_size += curr_mesh.positions.size() / 3 * components;
+    vertex_offset += unsigned(curr_mesh.positions.size() / 3);
+    index_count += curr_mesh.indices.size();
+  }
+
+  std::vector<float> vertex_data(data_size);
+  std::vector<unsigned> triangles(index_count);
+
+  // blocks of vertices and indices are written independently
+  std::size_t const block_size = 1 << 16;
+  struct block {
+    std::size_t shape;
+    std::size_t begin;
+  };
+  std::vector<block> blocks{};
+  for (std::size_t s = 0; s < shapes.size(); ++s) {
+    std::size_t size = std::max(shapes[s].mesh.positions.size() / 3, shapes[s].mesh.indices.size());
+    for (std::size_t begin = 0; begin < size; begin += block_size) {
+      blocks.push_back(block{s, begin});
+    }
+  }
 
-      if (has_normals) {
-        vertex_data.push_back(curr_mesh.normals[i * 3]);
-        vertex_data.push_back(curr_mesh.normals[i * 3 + 1]);
-        vertex_data.push_back(curr_mesh.normals[i * 3 + 2]);
+  run(pool, blocks.size(), [&](std::size_t b) {
+    tinyobj::mesh_t const& curr_mesh = shapes[blocks[b].shape].mesh;
+    shape_layout const& layout = layouts[blocks[b].shape];
+    std::size_t begin = blocks[b].begin;
+
+    // write vertex attributes
+    std::size_t vertex_end = std::min(begin + block_size, curr_mesh.positions.size() / 3);
+    float* out = vertex_data.data() + layout.data_offset
+               + begin * (3 + (layout.has_normals ? 3 : 0) + (layout.has_uvs ? 2 : 0) + (layout.has_tangents ? 4 : 0));
+    for (std::size_t i = begin; i < vertex_end; ++i) {
+      *out++ = curr_mesh.positions[i * 3];
+      *out++ = curr_mesh.positions[i * 3 + 1];
+      *out++ = curr_mesh.positions[i * 3 + 2];
+
+      if (layout.has_normals) {
+        *out++ = curr_mesh.normals[i * 3];
+        *out++ = curr_mesh.normals[i * 3 + 1];
+        *out++ = curr_mesh.normals[i * 3 + 2];
       }
 
-      if (has_uvs) {
-        vertex_data.push_back(curr_mesh.texcoords[i * 2]);
-        vertex_data.push_back(curr_mesh.texcoords[i * 2 + 1]);
+      if (layout.has_uvs) {
+        *out++ = curr_mesh.texcoords[i * 2];
+        *out++ = curr_mesh.texcoords[i * 2 + 1];
       }
 
-      if (has_tangents) {
-        vertex_data.push_back(tangents[i].x);
-        vertex_data.push_back(tangents[i].y);
-        vertex_data.push_back(tangents[i].z);
+      if (layout.has_tangents) {
+        *out++ = layout.tangents[i].x;
+        *out++ = layout.tangents[i].y;
+        *out++ = layout.tangents[i].z;
+        *out++ = layout.tangents[i].w;
       }
     }
 
     // add triangles
-    for (unsigned i = 0; i < curr_mesh.indices.size(); ++i) {
-      triangles.push_back(vertex_offset + curr_mesh.indices[i]);
+    std::size_t index_end = std::min(begin + block_size, curr_mesh.indices.size());
+    for (std::size_t i = begin; i < index_end; ++i) {
+      triangles[layout.index_offset + i] = layout.vertex_offset + curr_mesh.indices[i];
     }
+  });
+
+  model combined{vertex_data, attributes, triangles};
+  if (import_attribs & OPTIMIZE) {
+    mesh_optimizer::report statistics{};
+    combined = mesh_optimizer::optimize(combined, &statistics);
+    std::cout << "optimized " << statistics.vertices_before << " -> " << statistics.vertices_after << " vertices, ACMR "
+              << statistics.before.acmr << " -> " << statistics.after.acmr << ", ATVR "
+              << statistics.before.atvr << " -> " << statistics.after.atvr << std::endl;
+  }
+  // packed after optimizing, so only vertices which are identical as floats are merged
+  if (import_attribs & QUANTIZE) {
+    combined = vertex_quantization::pack(combined);
+  }
+  return combined;
+}
 
-    vertex_offset += unsigned(curr_mesh.positions.size() / 3);
+// native parser, one pass over each chunk of the mapped file without iostreams or locale
+
+// corner of a face, indices are zero based and -1 if missing
+// negative obj indices are resolved against the vertices before the face in its chunk and shifted when merging
+struct obj_corner {
+  int v;
+  int vt;
+  int vn;
+  // bits 0, 1 and 2 mark v, vt and vn as relative to the chunk
+  int relative;
+};
+
+// everything parsed from one line aligned part of the file
+struct obj_chunk {
+  std::vector<float> positions;
+  std::vector<float> normals;
+  std::vector<float> texcoords;
+  std::vector<obj_corner> corners;
+  // number of corners per face
+  std::vector<unsigned> face_sizes;
+  // number of faces before each g, o or usemtl line, these start a new shape
+  std::vector<std::size_t> breaks;
+  // set if a corner references a vertex which does not exist
+  bool invalid_index = false;
+};
+
+static bool is_space(char c) {
+  return c == ' ' || c == '\t';
+}
+
+static char const* skip_space(char const* p, char const* end) {
+  while (p < end && is_space(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+static bool is_digit(char c) {
+  return unsigned(c - '0') < 10u;
+}
+
+// exactly representable powers of ten
+static double const powers_of_ten[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// locale independent, reads up to 19 significant digits and scales them with one multiplication or division
+// tokens which are no number give 0 like in tinyobjloader
+static float parse_float(char const*& p, char const* end) {
+  p = skip_space(p, end);
+  char const* token_end = p;
+  while (token_end < end && !is_space(*token_end)) {
+    ++token_end;
+  }
+
+  bool negative = false;
+  if (p < token_end && (*p == '+' || *p == '-')) {
+    negative = *p == '-';
+    ++p;
+  }
+  std::uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool any = false;
+  for (; p < token_end && is_digit(*p); ++p) {
+    any = true;
+    if (digits < 19) {
+      mantissa = mantissa * 10 + std::uint64_t(*p - '0');
+      // leading zeros are not significant
+      digits += mantissa != 0 ? 1 : 0;
+    }
+    else {
+      ++exponent;
+    }
+  }
+  if (p < token_end && *p == '.') {
+    for (++p; p < token_end && is_digit(*p); ++p) {
+      any = true;
+      if (digits < 19) {
+        mantissa = mantissa * 10 + std::uint64_t(*p - '0');
+        digits += mantissa != 0 ? 1 : 0;
+        --exponent;
+      }
+    }
+  }
+  if (any && p < token_end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool negative_exponent = false;
+    if (p < token_end && (*p == '+' || *p == '-')) {
+      negative_exponent = *p == '-';
+      ++p;
+    }
+    int value = 0;
+    for (; p < token_end && is_digit(*p); ++p) {
+      // large enough to flush to zero or infinity
+      value = value < 10000 ? value * 10 + (*p - '0') : value;
+    }
+    exponent += negative_exponent ? -value : value;
+  }
+  p = token_end;
+
+  if (!any || mantissa == 0) {
+    return negative ? -0.0f : 0.0f;
+  }
+  double result = double(mantissa);
+  if (exponent >= 0 && exponent <= 22) {
+    result *= powers_of_ten[exponent];
+  }
+  else if (exponent < 0 && exponent >= -22) {
+    result /= powers_of_ten[-exponent];
+  }
+  else {
+    result *= std::pow(10.0, double(exponent));
+  }
+  return float(negative ? -result : result);
+}
+
+// integer until the next separator like atoi, the rest of the component is skipped
+static int parse_index(char const*& p, char const* end) {
+  bool negative = false;
+  if (p < end && (*p == '+' || *p == '-')) {
+    negative = *p == '-';
+    ++p;
+  }
+  int value = 0;
+  for (; p < end && is_digit(*p); ++p) {
+    value = value < INT_MAX / 10 ? value * 10 + (*p - '0') : INT_MAX;
+  }
+  while (p < end && *p != '/' && !is_space(*p)) {
+    ++p;
+  }
+  return negative ? -value : value;
+}
+
+// zero based index like tinyobjloader, negative indices count back from the end
+static void resolve_index(int raw, int count, int bit, int& index, int& relative) {
+  if (raw > 0) {
+    index = raw - 1;
+  }
+  else if (raw == 0) {
+    index = 0;
+  }
+  else {
+    index = count + raw;
+    relative |= bit;
   }
+}
+
+// v, v/vt, v//vn or v/vt/vn
+static obj_corner parse_corner(char const*& p, char const* end, obj_chunk const& chunk) {
+  obj_corner corner{-1, -1, -1, 0};
+  int positions = int(chunk.positions.size() / 3);
+  int normals = int(chunk.normals.size() / 3);
+  int texcoords = int(chunk.texcoords.size() / 2);
 
-  return model{vertex_data, attributes, triangles};
+  resolve_index(parse_index(p, end), positions, 1, corner.v, corner.relative);
+  if (p == end || *p != '/') {
+    return corner;
+  }
+  ++p;
+  if (p < end && *p == '/') {
+    ++p;
+    resolve_index(parse_index(p, end), normals, 4, corner.vn, corner.relative);
+    return corner;
+  }
+  resolve_index(parse_index(p, end), texcoords, 2, corner.vt, corner.relative);
+  if (p == end || *p != '/') {
+    return corner;
+  }
+  ++p;
+  resolve_index(parse_index(p, end), normals, 4, corner.vn, corner.relative);
+  return corner;
 }
 
-void generate_normals(tinyobj::mesh_t& model) {
-  std::vector<glm::fvec3> positions(model.positions.size() / 3);
+static bool starts_with(char const* p, char const* end, char const* keyword, std::size_t length) {
+  return std::size_t(end - p) > length && std::equal(keyword, keyword + length, p) && is_space(p[length]);
+}
 
-  for (unsigned i = 0; i < model.positions.size(); i+=3) {
-    positions[i / 3] = glm::fvec3{model.positions[i], model.positions[i + 1], model.positions[i + 2]};
+static void parse_line(char const* p, char const* end, obj_chunk& chunk) {
+  p = skip_space(p, end);
+  if (p == end || *p == '#') {
+    return;
+  }
+  if (starts_with(p, end, "v", 1)) {
+    p += 2;
+    for (int i = 0; i < 3; ++i) {
+      chunk.positions.push_back(parse_float(p, end));
+    }
+  }
+  else if (starts_with(p, end, "vn", 2)) {
+    p += 3;
+    for (int i = 0; i < 3; ++i) {
+      chunk.normals.push_back(parse_float(p, end));
+    }
+  }
+  else if (starts_with(p, end, "vt", 2)) {
+    p += 3;
+    for (int i = 0; i < 2; ++i) {
+      chunk.texcoords.push_back(parse_float(p, end));
+    }
+  }
+  else if (starts_with(p, end, "f", 1)) {
+    p = skip_space(p + 2, end);
+    unsigned corners = 0;
+    while (p < end) {
+      chunk.corners.push_back(parse_corner(p, end, chunk));
+      ++corners;
+      p = skip_space(p, end);
+    }
+    chunk.face_sizes.push_back(corners);
+  }
+  else if (starts_with(p, end, "g", 1) || starts_with(p, end, "o", 1) || starts_with(p, end, "usemtl", 6)) {
+    chunk.breaks.push_back(chunk.face_sizes.size());
+  }
+  // materials and all other statements are ignored
+}
+
+static void parse_chunk(char const* begin, char const* end, obj_chunk& chunk) {
+  while (begin < end) {
+    char const* line_end = static_cast<char const*>(std::memchr(begin, '\n', std::size_t(end - begin)));
+    if (line_end == nullptr) {
+      line_end = end;
+    }
+    char const* content_end = line_end;
+    if (content_end > begin && content_end[-1] == '\r') {
+      --content_end;
+    }
+    parse_line(begin, content_end, chunk);
+    begin = line_end + 1;
+  }
+}
+
+// vertices and triangles of the faces [first, last) in the order of tinyobjloader
+// every distinct combination of position, texcoord and normal index is one vertex
+static void build_shape(std::vector<obj_corner> const& corners, std::vector<std::size_t> const& face_starts,
+                        std::size_t first, std::size_t last, std::vector<float> const& positions,
+                        std::vector<float> const& normals, std::vector<float> const& texcoords,
+                        tinyobj::mesh_t& mesh) {
+  // vertices with the same position are chained, positions are looked up densely if the shape uses many of them
+  struct slot {
+    int vt;
+    int vn;
+    unsigned vertex;
+    unsigned next;
+  };
+  std::size_t position_count = positions.size() / 3;
+  std::size_t corner_count = face_starts[last] - face_starts[first];
+  bool dense = corner_count * 8 >= position_count;
+  std::vector<unsigned> dense_heads(dense ? position_count : 0, UINT_MAX);
+  std::unordered_map<int, unsigned> sparse_heads{};
+  std::vector<slot> slots{};
+  slots.reserve(corner_count / 2);
+
+  auto vertex = [&](obj_corner const& corner) {
+    unsigned* head = dense ? &dense_heads[std::size_t(corner.v)] : &sparse_heads.emplace(corner.v, UINT_MAX).first->second;
+    for (unsigned i = *head; i != UINT_MAX; i = slots[i].next) {
+      if (slots[i].vt == corner.vt && slots[i].vn == corner.vn) {
+        return slots[i].vertex;
+      }
+    }
+    unsigned index = unsigned(mesh.positions.size() / 3);
+    mesh.positions.insert(mesh.positions.end(), &positions[std::size_t(corner.v) * 3], &positions[std::size_t(corner.v) * 3] + 3);
+    if (corner.vn >= 0) {
+      mesh.normals.insert(mesh.normals.end(), &normals[std::size_t(corner.vn) * 3], &normals[std::size_t(corner.vn) * 3] + 3);
+    }
+    if (corner.vt >= 0) {
+      mesh.texcoords.insert(mesh.texcoords.end(), &texcoords[std::size_t(corner.vt) * 2], &texcoords[std::size_t(corner.vt) * 2] + 2);
+    }
+    slots.push_back(slot{corner.vt, corner.vn, index, *head});
+    *head = unsigned(slots.size() - 1);
+    return index;
+  };
+
+  for (std::size_t face = first; face < last; ++face) {
+    obj_corner const* face_corners = corners.data() + face_starts[face];
+    std::size_t size = face_starts[face + 1] - face_starts[face];
+    // polygons are split into a fan around the first corner
+    for (std::size_t k = 2; k < size; ++k) {
+      unsigned v0 = vertex(face_corners[0]);
+      unsigned v1 = vertex(face_corners[k - 1]);
+      unsigned v2 = vertex(face_corners[k]);
+      mesh.indices.push_back(v0);
+      mesh.indices.push_back(v1);
+      mesh.indices.push_back(v2);
+    }
   }
+}
 
-  std::vector<glm::fvec3> normals(model.positions.size() / 3, glm::fvec3{0.0f});
-  for (unsigned i = 0; i < model.indices.size(); i+=3) {
-    glm::fvec3 normal = glm::cross(positions[model.indices[i+1]] - positions[model.indices[i]], positions[model.indices[i+2]] - positions[model.indices[i]]);
+model obj_parallel(std::string const& path, model::attrib_flag_t import_attribs, ThreadPool* pool) {
+  mapped_file file{path};
+  char const* data = file.data();
+  std::size_t size = file.size();
+
+  // several chunks per worker balance uneven lines, small files are parsed at once
+  std::size_t const min_chunk_bytes = std::size_t(1) << 18;
+  std::size_t workers = pool != nullptr ? pool->size() : 1;
+  std::size_t chunk_count = std::max<std::size_t>(1, std::min(size / min_chunk_bytes, workers * 4));
+  // chunks start after the line break following their even share of the file
+  std::vector<std::size_t> bounds(chunk_count + 1, size);
+  bounds[0] = 0;
+  for (std::size_t i = 1; i < chunk_count; ++i) {
+    std::size_t start = std::max(bounds[i - 1], size / chunk_count * i);
+    void const* line_break = start < size ? std::memchr(data + start, '\n', size - start) : nullptr;
+    bounds[i] = line_break != nullptr ? std::size_t(static_cast<char const*>(line_break) - data) + 1 : size;
+  }
 
-    normals[model.indices[i]] += normal;
-    normals[model.indices[i+1]] += normal;
-    normals[model.indices[i+2]] += normal;
+  std::vector<obj_chunk> chunks(chunk_count);
+  run(pool, chunk_count, [&](std::size_t i) {
+    parse_chunk(data + bounds[i], data + bounds[i + 1], chunks[i]);
+  });
+
+  // offsets of each chunk in the merged arrays, in file order so the result does not depend on the threads
+  struct offsets {
+    std::size_t positions, normals, texcoords, corners, faces;
+  };
+  std::vector<offsets> bases(chunk_count + 1, offsets{0, 0, 0, 0, 0});
+  for (std::size_t i = 0; i < chunk_count; ++i) {
+    bases[i + 1].positions = bases[i].positions + chunks[i].positions.size();
+    bases[i + 1].normals = bases[i].normals + chunks[i].normals.size();
+    bases[i + 1].texcoords = bases[i].texcoords + chunks[i].texcoords.size();
+    bases[i + 1].corners = bases[i].corners + chunks[i].corners.size();
+    bases[i + 1].faces = bases[i].faces + chunks[i].face_sizes.size();
+  }
+  offsets const& total = bases[chunk_count];
+  if (total.positions / 3 > std::size_t(INT_MAX)) {
+    throw std::logic_error("obj_parallel: too many vertices in " + path);
   }
 
-  model.normals.reserve(model.positions.size());
-  for (unsigned i = 0; i < normals.size(); ++i) {
-    glm::fvec3 normal = glm::normalize(normals[i]);
-    model.normals[i * 3] = normal[0];
-    model.normals[i * 3 + 1] = normal[1];
-    model.normals[i * 3 + 2] = normal[2];
+  std::vector<float> positions(total.positions);
+  std::vector<float> normals(total.normals);
+  std::vector<float> texcoords(total.texcoords);
+  std::vector<obj_corner> corners(total.corners);
+  std::vector<std::size_t> face_starts(total.faces + 1, total.corners);
+  run(pool, chunk_count, [&](std::size_t i) {
+    obj_chunk& chunk = chunks[i];
+    offsets const& base = bases[i];
+    std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + std::ptrdiff_t(base.positions));
+    std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + std::ptrdiff_t(base.normals));
+    std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + std::ptrdiff_t(base.texcoords));
+    // shift relative indices by the vertices of the previous chunks and check all of them
+    int position_base = int(base.positions / 3);
+    int normal_base = int(base.normals / 3);
+    int texcoord_base = int(base.texcoords / 2);
+    for (std::size_t c = 0; c < chunk.corners.size(); ++c) {
+      obj_corner corner = chunk.corners[c];
+      corner.v += (corner.relative & 1) ? position_base : 0;
+      corner.vt += (corner.relative & 2) ? texcoord_base : 0;
+      corner.vn += (corner.relative & 4) ? normal_base : 0;
+      chunk.invalid_index = chunk.invalid_index
+                         || corner.v < 0 || std::size_t(corner.v) >= total.positions / 3
+                         || corner.vt < -1 || (corner.vt >= 0 && std::size_t(corner.vt) >= total.texcoords / 2)
+                         || corner.vn < -1 || (corner.vn >= 0 && std::size_t(corner.vn) >= total.normals / 3);
+      corners[base.corners + c] = corner;
+    }
+    std::size_t corner = base.corners;
+    for (std::size_t f = 0; f < chunk.face_sizes.size(); ++f) {
+      face_starts[base.faces + f] = corner;
+      corner += chunk.face_sizes[f];
+    }
+    // release the chunk early, large files hold everything twice otherwise
+    chunk.positions = std::vector<float>{};
+    chunk.normals = std::vector<float>{};
+    chunk.texcoords = std::vector<float>{};
+    chunk.corners = std::vector<obj_corner>{};
+  });
+
+  // faces between two shape starts form a shape, runs without faces produce none
+  std::vector<std::size_t> shape_starts{0};
+  for (std::size_t i = 0; i < chunk_count; ++i) {
+    if (chunks[i].invalid_index) {
+      throw std::logic_error("obj_parallel: face references a missing vertex in " + path);
+    }
+    for (std::size_t face : chunks[i].breaks) {
+      if (bases[i].faces + face > shape_starts.back()) {
+        shape_starts.push_back(bases[i].faces + face);
+      }
+    }
+  }
+  if (total.faces > shape_starts.back()) {
+    shape_starts.push_back(total.faces);
   }
+
+  std::vector<tinyobj::shape_t> shapes(shape_starts.size() - 1);
+  run(pool, shapes.size(), [&](std::size_t i) {
+    build_shape(corners, face_starts, shape_starts[i], shape_starts[i + 1], positions, normals, texcoords, shapes[i].mesh);
+  });
+
+  return interleave(shapes, import_attribs, pool);
 }
 
-std::vector<glm::fvec3> generate_tangents(tinyobj::mesh_t const& model) {
-  // containers for vertex attributes
-  std::vector<glm::fvec3> positions(model.positions.size() / 3);
-  std::vector<glm::fvec3> normals(model.positions.size() / 3);
-  std::vector<glm::fvec2> texcoords(model.positions.size() / 3);
-  std::vector<glm::fvec3> tangents(model.positions.size() / 3, glm::fvec3{0.0f});
+// modification time in nanoseconds, so edits within one second that keep the size are noticed
+static std::int64_t modification_time(struct stat const& status) {
+#if defined(__APPLE__)
+  return std::int64_t(status.st_mtimespec.tv_sec) * 1000000000 + std::int64_t(status.st_mtimespec.tv_nsec);
+#elif defined(_WIN32)
+  // only whole seconds are recorded
+  return std::int64_t(status.st_mtime) * 1000000000;
+#else
+  return std::int64_t(status.st_mtim.tv_sec) * 1000000000 + std::int64_t(status.st_mtim.tv_nsec);
+#endif
+}
 
-  // get vertex positions and texture coordinates from mesh_t
-  for (unsigned i = 0; i < model.positions.size(); i+=3) {
-    positions[i / 3] = glm::fvec3{model.positions[i],
-                                 model.positions[i + 1],
-                                 model.positions[i + 2]};
-    normals[i / 3] = glm::fvec3{model.normals[i],
-                                 model.normals[i + 1],
-                                 model.normals[i + 2]};
+mesh_file obj_mapped(std::string const& path, model::attrib_flag_t import_attribs, ThreadPool* pool) {
+  // size and modification time of the obj tell whether the mesh file is outdated
+  struct stat status;
+  if (stat(path.c_str(), &status) != 0) {
+    throw std::logic_error("model_loader: could not find " + path);
+  }
+  std::uint64_t source_size = std::uint64_t(status.st_size);
+  std::int64_t source_time = modification_time(status);
+
+  std::string mesh_path = path + ".mesh";
+  try {
+    mesh_file mapped{mesh_path};
+    if (mapped.matches(import_attribs, source_size, source_time)) {
+      return mapped;
+    }
+  }
+  catch (std::logic_error&) {
+    // missing or from another version, created again below
   }
-  for (unsigned i = 0; i < model.texcoords.size(); i+=2) {
-    texcoords[i / 2] = glm::fvec2{model.texcoords[i], model.texcoords[i + 1]};
+
+  mesh_file parsed{obj_parallel(path, import_attribs, pool), import_attribs, source_size, source_time};
+  // without write access the mesh is parsed on every load
+  if (!parsed.write(mesh_path)) {
+    std::cerr << "model_loader: could not write " << mesh_path << std::endl;
   }
+  return parsed;
+}
 
-  // calculate tangent for triangles
-  for (unsigned i = 0; i < model.indices.size() / 3; i++) {
-    // indices of vertices of this triangle
-    // unsigned indices[3] = {model.indices[i * 3],
-    //                        model.indices[i * 3 + 1],
-    //                        model.indices[i * 3 + 2]};
-    // access an attribute of xth vert with vector access "attribute[indices[x]]"
-    
-    // calculate tangent for the triangle and add it to the accumulation tangents of the adjacent vertices
-    // see generate_normals() for similar workflow 
+// flat tinyobj attribute arrays as vectors
+static std::vector<glm::fvec3> to_vec3(std::vector<float> const& values) {
+  std::vector<glm::fvec3> vectors(values.size() / 3);
+  for (std::size_t i = 0; i < vectors.size(); ++i) {
+    vectors[i] = glm::fvec3{values[i * 3], values[i * 3 + 1], values[i * 3 + 2]};
   }
-  // normalize and orthogonalize accumulated vertex tangents
-  for (unsigned i = 0; i < tangents.size(); ++i) {
-    // implement orthogonalization and normalization here
+  return vectors;
+}
+
+static std::vector<glm::fvec2> to_vec2(std::vector<float> const& values) {
+  std::vector<glm::fvec2> vectors(values.size() / 2);
+  for (std::size_t i = 0; i < vectors.size(); ++i) {
+    vectors[i] = glm::fvec2{values[i * 2], values[i * 2 + 1]};
   }
+  return vectors;
+}
 
-  throw std::logic_error("Tangent creation not implemented yet");
+void generate_normals(tinyobj::mesh_t& model, ThreadPool* pool) {
+  std::vector<glm::fvec3> normals = tangent_space::normals(to_vec3(model.positions), model.indices, pool);
+  model.normals.resize(normals.size() * 3);
+  for (std::size_t i = 0; i < normals.size(); ++i) {
+    model.normals[i * 3] = normals[i].x;
+    model.normals[i * 3 + 1] = normals[i].y;
+    model.normals[i * 3 + 2] = normals[i].z;
+  }
+}
 
-  return tangents;
+std::vector<glm::fvec4> generate_tangents(tinyobj::mesh_t const& model, ThreadPool* pool) {
+  return tangent_space::tangents(to_vec3(model.positions), to_vec3(model.normals), to_vec2(model.texcoords),
+                                 model.indices, pool);
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "post_chain.hpp"
+#include "utils.hpp"
+
+#include <glbinding/gl/functions.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <limits>
+#include <stdexcept>
+
+const std::size_t post_chain::npos = std::numeric_limits<std::size_t>::max();
+
+post_chain::post_chain(shader_loader::program_cache& cache, std::string const& vertex_shader,
+                       std::string const& composite_shader)
+ :m_cache(cache)
+ ,m_vertex_shader{vertex_shader}
+ ,m_composite_shader{composite_shader}
+ ,m_composites{}
+ ,m_separables{}
+ ,m_enabled{0}
+ ,m_programs{}
+ ,m_width{0}
+ ,m_height{0}
+ ,m_scene{}
+ ,m_ping{}
+{}
+
+post_chain::~post_chain() {
+  release_targets();
+}
+
+post_chain::effect post_chain::next_flag() const {
+  std::size_t count = m_composites.size() + m_separables.size();
+  if (count >= 32) {
+    throw std::logic_error("post_chain: too many effects");
+  }
+  return effect(1u << count);
+}
+
+post_chain::effect post_chain::add_composite(std::string const& define) {
+  m_composites.push_back(composite_effect{next_flag(), define});
+  return m_composites.back().flag;
+}
+
+post_chain::effect post_chain::add_separable(std::string const& fragment_shader) {
+  m_separables.push_back(separable_effect{next_flag(), fragment_shader});
+  return m_separables.back().flag;
+}
+
+void post_chain::enable(effect flag, bool enabled) {
+  m_enabled = enabled ? m_enabled | flag : m_enabled & ~flag;
+}
+
+void post_chain::toggle(effect flag) {
+  m_enabled ^= flag;
+}
+
+bool post_chain::enabled(effect flag) const {
+  return (m_enabled & flag) != 0;
+}
+
+bool post_chain::active() const {
+  return m_enabled != 0;
+}
+
+std::vector<post_pass> post_chain::plan() const {
+  std::vector<post_pass> passes;
+  unsigned composite = 0;
+  for (composite_effect const& effect : m_composites) {
+    composite |= m_enabled & effect.flag;
+  }
+  // blurred back into the scene texture, so the next effect reads it from there
+  for (std::size_t i = 0; i < m_separables.size(); ++i) {
+    if (enabled(m_separables[i].flag)) {
+      passes.push_back(post_pass{i, true, 0, post_pass::SCENE, post_pass::PING});
+      passes.push_back(post_pass{i, false, 0, post_pass::PING, post_pass::SCENE});
+    }
+  }
+  if (composite != 0 || (passes.empty() && active())) {
+    passes.push_back(post_pass{npos, false, composite, post_pass::SCENE, post_pass::SCREEN});
+  }
+  // without a final pass the last separable pass writes to the screen directly
+  else if (!passes.empty()) {
+    passes.back().target = post_pass::SCREEN;
+  }
+  return passes;
+}
+
+static void create_target(framebuffer_object& target, unsigned width, unsigned height, bool depth) {
+  glGenFramebuffers(1, &target.handle);
+  glBindFramebuffer(GL_FRAMEBUFFER, target.handle);
+
+  target.texture_obj.target = GL_TEXTURE_2D;
+  glActiveTexture(GL_TEXTURE0);
+  glGenTextures(1, &target.texture_obj.handle);
+  glBindTexture(GL_TEXTURE_2D, target.texture_obj.handle);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, GLsizei(width), GLsizei(height), 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+  // passes sample texel centers of a texture of the same size
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture_obj.handle, 0);
+  target.texture_handle = target.texture_obj.handle;
+
+  target.renderbuffer_handle = 0;
+  if (depth) {
+    glGenRenderbuffers(1, &target.renderbuffer_handle);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.renderbuffer_handle);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, GLsizei(width), GLsizei(height));
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target.renderbuffer_handle);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  }
+
+  GLenum draw_buffers[1] = {GL_COLOR_ATTACHMENT0};
+  glDrawBuffers(1, draw_buffers);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    throw std::logic_error("post_chain: incomplete framebuffer");
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static void delete_target(framebuffer_object& target) {
+  glDeleteFramebuffers(1, &target.handle);
+  glDeleteTextures(1, &target.texture_obj.handle);
+  glDeleteRenderbuffers(1, &target.renderbuffer_handle);
+  target = framebuffer_object{};
+}
+
+void post_chain::release_targets() {
+  if (m_scene.handle != 0) {
+    delete_target(m_scene);
+    delete_target(m_ping);
+  }
+}
+
+void post_chain::resize(unsigned width, unsigned height) {
+  release_targets();
+  m_width = width;
+  m_height = height;
+  create_target(m_scene, width, height, true);
+  create_target(m_ping, width, height, false);
+}
+
+GLuint post_chain::target() const {
+  return active() ? m_scene.handle : 0;
+}
+
+static std::tuple<std::size_t, bool, unsigned> key_of(post_pass const& pass) {
+  return std::make_tuple(pass.separable, pass.horizontal, pass.composite);
+}
+
+bool post_chain::request(variant_key const& key, bool throwing) {
+  std::size_t const separable = std::get<0>(key);
+  std::vector<std::string> defines;
+  std::string fragment_shader = m_composite_shader;
+  if (separable != npos) {
+    defines.push_back(std::get<1>(key) ? "HORIZONTAL" : "VERTICAL");
+    fragment_shader = m_separables[separable].fragment_shader;
+  }
+  for (composite_effect const& effect : m_composites) {
+    if (std::get<2>(key) & effect.flag) {
+      defines.push_back(effect.define);
+    }
+  }
+  auto previous = m_programs.find(key);
+  program compiled;
+  try {
+    compiled.handle = m_cache.get({{GL_VERTEX_SHADER, m_vertex_shader}, {GL_FRAGMENT_SHADER, fragment_shader}}, defines);
+  }
+  catch (std::exception&) {
+    if (throwing) {
+      throw;
+    }
+    // keep drawing with the previous program, allow another try
+    if (previous == m_programs.end()) {
+      return false;
+    }
+    m_cache.keep(previous->second.handle);
+    return true;
+  }
+  uniform::table locations = utils::reflect_uniforms(compiled.handle);
+  compiled.screen_texture = locations[uniform::SCREEN_TEXTURE];
+  compiled.texture_size = locations[uniform::TEXTURE_SIZE];
+  glUseProgram(compiled.handle);
+  glUniform1i(compiled.screen_texture, 0);
+  // a replaced program is deleted by the next sweep of the cache
+  m_programs[key] = compiled;
+  return true;
+}
+
+void post_chain::execute(GLuint quad_vertex_array, GLenum mode, GLsizei count) {
+  std::vector<post_pass> const passes = plan();
+  if (passes.empty()) {
+    return;
+  }
+  std::vector<program const*> programs;
+  for (post_pass const& pass : passes) {
+    auto found = m_programs.find(key_of(pass));
+    if (found == m_programs.end()) {
+      return;
+    }
+    programs.push_back(&found->second);
+  }
+  glDisable(GL_DEPTH_TEST);
+  glBindVertexArray(quad_vertex_array);
+  glActiveTexture(GL_TEXTURE0);
+  for (std::size_t i = 0; i < passes.size(); ++i) {
+    post_pass const& pass = passes[i];
+    program const& current = *programs[i];
+    glUseProgram(current.handle);
+    if (current.texture_size != -1) {
+      glUniform2f(current.texture_size, float(m_width), float(m_height));
+    }
+    GLuint source = pass.source == post_pass::PING ? m_ping.texture_obj.handle : m_scene.texture_obj.handle;
+    GLuint target = pass.target == post_pass::SCREEN ? 0 : pass.target == post_pass::PING ? m_ping.handle : m_scene.handle;
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glBindTexture(GL_TEXTURE_2D, source);
+    glDrawArrays(mode, 0, count);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glEnable(GL_DEPTH_TEST);
+}
+
+bool post_chain::reload(bool throwing) {
+  std::vector<variant_key> keys;
+  for (auto const& compiled : m_programs) {
+    keys.push_back(compiled.first);
+  }
+  for (post_pass const& pass : plan()) {
+    if (m_programs.find(key_of(pass)) == m_programs.end()) {
+      keys.push_back(key_of(pass));
+    }
+  }
+  bool complete = true;
+  for (variant_key const& key : keys) {
+    complete = request(key, throwing) && complete;
+  }
+  return complete;
+}
+
@@ -0,0 +1,116 @@
+#include "render_queue.hpp"
+
+#include <glbinding/gl/functions.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <algorithm>
+
+std::uint64_t render_queue::key(unsigned pass, GLuint program, GLuint vertex_array, GLuint texture, float depth) {
+  float clamped = std::min(std::max(depth, 0.0f), 1.0f);
+  std::uint64_t depth_bits = std::uint64_t(clamped * 65535.0f + 0.5f);
+  return (std::uint64_t(pass & 0xffu) << 56) |
+         (std::uint64_t(program & 0xfffu) << 44) |
+         (std::uint64_t(vertex_array & 0xfffu) << 32) |
+         (std::uint64_t(texture & 0xffffu) << 16) |
+         depth_bits;
+}
+
+void render_queue::submit(draw_command const& command) {
+  m_commands.push_back(command);
+}
+
+void render_queue::clear() {
+  m_commands.clear();
+}
+
+void render_queue::sort() {
+  std::stable_sort(m_commands.begin(), m_commands.end(), [](draw_command const& a, draw_command const& b) {
+    return a.key < b.key;
+  });
+}
+
+std::size_t render_queue::execute() {
+  sort();
+
+  // state is unknown before the first command
+  bool first = true;
+  GLuint program = 0;
+  GLuint vertex_array = 0;
+  bool depth_write = true;
+  std::array<texture_object, draw_command::max_textures> textures{};
+  GLenum active_unit = GL_NONE;
+  std::size_t changes = 0;
+
+  for (draw_command const& command : m_commands) {
+    if (first || command.depth_write != depth_write) {
+      depth_write = command.depth_write;
+      glDepthMask(GLboolean(depth_write));
+      ++changes;
+    }
+    if (first || command.program != program) {
+      program = command.program;
+      glUseProgram(program);
+      ++changes;
+    }
+    if (first || command.vertex_array != vertex_array) {
+      vertex_array = command.vertex_array;
+      glBindVertexArray(vertex_array);
+      ++changes;
+    }
+    for (std::size_t unit = 0; unit < draw_command::max_textures; ++unit) {
+      texture_object const& texture = command.textures[unit];
+      if (texture.target == GL_NONE) {
+        continue;
+      }
+      if (first || texture.target != textures[unit].target || texture.handle != textures[unit].handle) {
+        GLenum texture_unit = GLenum(GLuint(GL_TEXTURE0) + GLuint(unit));
+        if (texture_unit != active_unit) {
+          active_unit = texture_unit;
+          glActiveTexture(active_unit);
+        }
+        glBindTexture(texture.target, texture.handle);
+        textures[unit] = texture;
+        ++changes;
+      }
+    }
+    first = false;
+
+    if (command.uniforms != nullptr) {
+      command.uniforms(command);
+    }
+
+    if (command.kind == draw_command::ARRAYS) {
+      if (command.instances > 1) {
+        glDrawArraysInstanced(command.mode, command.first, command.count, command.instances);
+      }
+      else {
+        glDrawArrays(command.mode, command.first, command.count);
+      }
+    }
+    else if (command.kind == draw_command::ELEMENTS) {
+      // first is an offset into the element buffer
+      void const* offset = reinterpret_cast<void const*>(std::size_t(command.first));
+      if (command.instances > 1) {
+        glDrawElementsInstanced(command.mode, command.count, command.index_type, offset, command.instances);
+      }
+      else {
+        glDrawElements(command.mode, command.count, command.index_type, offset);
+      }
+    }
+    else {
+      glMultiDrawArrays(command.mode, command.firsts, command.counts, command.count);
+    }
+  }
+
+  // commands of the next frame may rely on writing depth
+  if (!depth_write) {
+    glDepthMask(GLboolean(true));
+  }
+  clear();
+  return changes;
+}
+
+std::vector<draw_command> const& render_queue::commands() const {
+  return m_commands;
+}
@@ -1,6 +1,7 @@
 #include "shader_loader.hpp"
 
 #include "utils.hpp"
+#include "mapped_file.hpp"
 
 
 #include <glbinding/gl/functions.h>
@@ -9,26 +10,81 @@
 // use gl definitions from glbinding 
 using namespace gl;
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <fstream>
 #include <vector>
 #include <string.h>
+#include <stdexcept>
 
 
 static std::string file_name(std::string const& file_path) {
   return file_path.substr(file_path.find_last_of("/\\") + 1);
 }
 
-namespace shader_loader {
+static std::string directory(std::string const& file_path) {
+  return file_path.substr(0, file_path.find_last_of("/\\") + 1);
+}
+
+// glsl 150 has no includes, replace lines of the form #include "file" with the file content
+// paths are relative to the including file
+static std::string expand_includes(std::string const& file_path, std::string const& source, unsigned depth = 0) {
+  if (depth > 16) {
+    throw std::logic_error("Shader include depth exceeded in " + file_name(file_path));
+  }
+  std::istringstream lines{source};
+  std::string expanded{};
+  std::string line{};
+  while (std::getline(lines, line)) {
+    std::size_t start = line.find_first_not_of(" \t");
+    if (start != std::string::npos && line.compare(start, 8, "#include") == 0) {
+      std::size_t open = line.find('"', start + 8);
+      std::size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+      if (close == std::string::npos) {
+        throw std::logic_error("Malformed include in " + file_name(file_path) + ": " + line);
+      }
+      std::string include_path = directory(file_path) + line.substr(open + 1, close - open - 1);
+      expanded += expand_includes(include_path, utils::read_file(include_path), depth + 1);
+    }
+    else {
+      expanded += line + "\n";
+    }
+  }
+  return expanded;
+}
+
+// defines must follow the #version directive, which has to be the first statement
+static std::string inject_defines(std::string const& source, std::vector<std::string> const& defines) {
+  if (defines.empty()) {
+    return source;
+  }
+  std::string lines{};
+  for (auto const& define : defines) {
+    lines += "#define " + define + "\n";
+  }
+  std::size_t version = source.find("#version");
+  if (version == std::string::npos) {
+    return lines + source;
+  }
+  std::size_t line_end = source.find('\n', version);
+  if (line_end == std::string::npos) {
+    return source + "\n" + lines;
+  }
+  return source.substr(0, line_end + 1) + lines + source.substr(line_end + 1);
+}
 
-GLuint shader(std::string const& file_path, GLenum shader_type) {
+// compile source of the given file, errors are reported with the file name
+static GLuint compile(std::string const& file_path, std::string const& source, GLenum shader_type) {
   GLuint shader = 0;
   shader = glCreateShader(shader_type);
 
-  std::string shader_source{utils::read_file(file_path)};
   // glshadersource expects array of c-strings
-  const char* shader_chars = shader_source.c_str();
+  const char* shader_chars = source.c_str();
   glShaderSource(shader, 1, &shader_chars, 0);
 
   glCompileShader(shader);
@@ -55,13 +111,29 @@ GLuint shader(std::string const& file_path, GLenum shader_type) {
   return shader;
 }
 
-unsigned program(std::map<GLenum, std::string> const& stages) {
+// link the stages from their final sources, retrievable programs can be read with glGetProgramBinary
+static unsigned link(std::map<GLenum, std::string> const& stages, std::map<GLenum, std::string> const& sources,
+                     bool retrievable = false) {
   unsigned program = glCreateProgram();
+  if (retrievable) {
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, 1);
+  }
 
   std::vector<GLuint> shaders{};
-  // load and compile vert and frag shader
+  // compile vert and frag shader
   for (auto const& stage : stages) {
-    GLuint shader_handle = shader(stage.second, stage.first);
+    GLuint shader_handle = 0;
+    try {
+      shader_handle = compile(stage.second, sources.at(stage.first), stage.first);
+    }
+    catch (std::logic_error&) {
+      // free the stages compiled so far
+      for (auto compiled : shaders) {
+        glDeleteShader(compiled);
+      }
+      glDeleteProgram(program);
+      throw;
+    }
     shaders.push_back(shader_handle);
     // attach the shader to program
     glAttachShader(program, shader_handle);
@@ -91,6 +163,9 @@ unsigned program(std::map<GLenum, std::string> const& stages) {
     std::cerr << "OpenGl error: Linking of " << names << ":\n";
     std::cerr << std::string{log_buffer.begin(), log_buffer.end()};
 
+    for (auto shader_handle : shaders) {
+      glDeleteShader(shader_handle);
+    }
     // free broken program
     glDeleteProgram(program);
 
@@ -107,4 +182,200 @@ unsigned program(std::map<GLenum, std::string> const& stages) {
   return program;
 }
 
+// sources of all stages with includes expanded
+static std::map<GLenum, std::string> read_sources(std::map<GLenum, std::string> const& stages) {
+  std::map<GLenum, std::string> sources{};
+  for (auto const& stage : stages) {
+    sources[stage.first] = expand_includes(stage.second, utils::read_file(stage.second));
+  }
+  return sources;
+}
+
+namespace shader_loader {
+
+GLuint shader(std::string const& file_path, GLenum shader_type, std::vector<std::string> const& defines) {
+  return compile(file_path, inject_defines(expand_includes(file_path, utils::read_file(file_path)), defines), shader_type);
+}
+
+unsigned program(std::map<GLenum, std::string> const& stages, std::vector<std::string> const& defines) {
+  std::map<GLenum, std::string> sources{read_sources(stages)};
+  for (auto& source : sources) {
+    source.second = inject_defines(source.second, defines);
+  }
+  return link(stages, sources);
+}
+
+std::uint64_t hash(std::map<GLenum, std::string> const& sources) {
+  // 64 bit FNV-1a over stage types and sources
+  std::uint64_t value = 0xcbf29ce484222325ull;
+  for (auto const& source : sources) {
+    std::uint32_t type = std::uint32_t(source.first);
+    value = hash(std::string{reinterpret_cast<char const*>(&type), sizeof(type)}, value);
+    // terminator separates the sources
+    value = hash(std::string{source.second.c_str(), source.second.size() + 1}, value);
+  }
+  return value;
+}
+
+std::uint64_t hash(std::string const& data, std::uint64_t value) {
+  for (char byte : data) {
+    value = (value ^ std::uint64_t(static_cast<unsigned char>(byte))) * 0x100000001b3ull;
+  }
+  return value;
+}
+
+program_cache::program_cache(std::string const& binary_directory)
+ :m_programs{}
+ ,m_directory{binary_directory}
+ ,m_driver{}
+ ,m_binary_formats{-1}
+{}
+
+program_cache::~program_cache() {
+  clear();
+}
+
+unsigned program_cache::get(std::map<GLenum, std::string> const& stages, std::vector<std::string> const& defines) {
+  std::map<GLenum, std::string> sources{read_sources(stages)};
+  // the order of defines does not matter, so they are sorted for the key
+  std::vector<std::string> sorted{defines};
+  std::sort(sorted.begin(), sorted.end());
+  std::string joined{};
+  for (auto const& define : sorted) {
+    joined += define + "\n";
+  }
+  auto key = std::make_pair(hash(sources), joined);
+  auto found = m_programs.find(key);
+  if (found == m_programs.end()) {
+    unsigned handle = 0;
+    std::string file{};
+    std::uint64_t binary_key = 0;
+    if (binaries_supported()) {
+      binary_key = hash(m_driver, hash(joined, key.first));
+      std::ostringstream name{};
+      name << m_directory << std::hex << std::setw(16) << std::setfill('0') << binary_key << ".bin";
+      file = name.str();
+      handle = load_binary(file, binary_key);
+    }
+    if (handle == 0) {
+      for (auto& source : sources) {
+        source.second = inject_defines(source.second, sorted);
+      }
+      handle = link(stages, sources, !file.empty());
+      if (!file.empty()) {
+        store_binary(file, binary_key, handle);
+      }
+    }
+    found = m_programs.emplace(key, entry{handle, true}).first;
+  }
+  found->second.used = true;
+  return found->second.handle;
+}
+
+void program_cache::keep(unsigned handle) {
+  for (auto& program : m_programs) {
+    if (program.second.handle == handle) {
+      program.second.used = true;
+    }
+  }
+}
+
+std::size_t program_cache::sweep() {
+  std::size_t removed = 0;
+  for (auto it = m_programs.begin(); it != m_programs.end();) {
+    if (it->second.used) {
+      it->second.used = false;
+      ++it;
+    }
+    else {
+      glDeleteProgram(it->second.handle);
+      it = m_programs.erase(it);
+      ++removed;
+    }
+  }
+  return removed;
+}
+
+void program_cache::clear() {
+  for (auto const& program : m_programs) {
+    glDeleteProgram(program.second.handle);
+  }
+  m_programs.clear();
+}
+
+std::size_t program_cache::size() const {
+  return m_programs.size();
+}
+
+bool program_cache::binaries_supported() {
+  if (m_directory.empty()) {
+    return false;
+  }
+  if (m_binary_formats < 0) {
+    // stays 0 if the context has no program binaries
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    m_binary_formats = formats;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+      GLubyte const* value = glGetString(name);
+      if (value != nullptr) {
+        m_driver += reinterpret_cast<char const*>(value);
+      }
+      m_driver += "\n";
+    }
+  }
+  return m_binary_formats > 0;
+}
+
+// file layout: 64 bit key, 32 bit binary format, binary
+unsigned program_cache::load_binary(std::string const& file, std::uint64_t key) const {
+  std::ifstream in{file, std::ios::binary};
+  if (!in) {
+    return 0;
+  }
+  std::uint64_t stored_key = 0;
+  std::uint32_t format = 0;
+  in.read(reinterpret_cast<char*>(&stored_key), sizeof(stored_key));
+  in.read(reinterpret_cast<char*>(&format), sizeof(format));
+  std::vector<char> binary{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+  in.close();
+  if (stored_key != key || binary.empty()) {
+    return 0;
+  }
+
+  unsigned program = glCreateProgram();
+  glProgramBinary(program, GLenum(format), binary.data(), GLsizei(binary.size()));
+  GLint success = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (success == 0) {
+    // drivers may reject binaries after updates, the file is replaced by the compiled program
+    glDeleteProgram(program);
+    return 0;
+  }
+  return program;
+}
+
+void program_cache::store_binary(std::string const& file, std::uint64_t key, unsigned program) const {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(static_cast<std::size_t>(length));
+  GLsizei written = 0;
+  GLenum format = GL_NONE;
+  glGetProgramBinary(program, length, &written, &format, binary.data());
+  if (written <= 0) {
+    return;
+  }
+
+  // key and format are stored before the binary, other processes see the previous or the whole new file
+  std::uint32_t stored_format = std::uint32_t(format);
+  std::vector<char> content(sizeof(key) + sizeof(stored_format) + std::size_t(written));
+  std::memcpy(content.data(), &key, sizeof(key));
+  std::memcpy(content.data() + sizeof(key), &stored_format, sizeof(stored_format));
+  std::memcpy(content.data() + sizeof(key) + sizeof(stored_format), binary.data(), std::size_t(written));
+  replace_file(file, content.data(), content.size());
+}
+
 }
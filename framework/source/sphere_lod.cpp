@@ -0,0 +1,173 @@
+#include "sphere_lod.hpp"
+
+#include "tangent_space.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+
+namespace sphere_lod {
+
+// edge length of an icosahedron with circumradius 1
+static const float icosahedron_edge = 1.0515f;
+
+model icosphere(unsigned subdivisions) {
+  // icosahedron with a vertex at each pole and two rings of five vertices at latitude +-atan(1/2)
+  float const height = 1.0f / std::sqrt(5.0f);
+  float const ring = 2.0f / std::sqrt(5.0f);
+  std::vector<glm::fvec3> positions{{0.0f, 1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}};
+  for (int i = 0; i < 10; ++i) {
+    // upper vertices at multiples of 72 degrees, lower ones halfway in between
+    float longitude = float(i) * glm::two_pi<float>() / 10.0f;
+    positions.emplace_back(ring * std::cos(longitude), i % 2 == 0 ? height : -height, -ring * std::sin(longitude));
+  }
+  std::vector<GLuint> triangles;
+  for (GLuint i = 0; i < 5; ++i) {
+    GLuint upper = 2 + 2 * i, lower = upper + 1;
+    GLuint next_upper = 2 + 2 * ((i + 1) % 5), next_lower = next_upper + 1;
+    GLuint faces[12] = {0, upper, next_upper,  upper, lower, next_upper,  lower, next_lower, next_upper,  1, lower, next_lower};
+    triangles.insert(triangles.end(), faces, faces + 12);
+  }
+  // counter-clockwise seen from outside
+  for (std::size_t i = 0; i < triangles.size(); i += 3) {
+    glm::fvec3 const& a = positions[triangles[i]];
+    glm::fvec3 const& b = positions[triangles[i + 1]];
+    glm::fvec3 const& c = positions[triangles[i + 2]];
+    if (glm::dot(glm::cross(b - a, c - a), a + b + c) < 0.0f) {
+      std::swap(triangles[i + 1], triangles[i + 2]);
+    }
+  }
+
+  // split every triangle into four, edge midpoints are shared by both adjacent triangles
+  for (unsigned s = 0; s < subdivisions; ++s) {
+    std::unordered_map<std::uint64_t, GLuint> midpoints;
+    auto midpoint = [&](GLuint a, GLuint b) {
+      std::uint64_t key = a < b ? (std::uint64_t(a) << 32) | b : (std::uint64_t(b) << 32) | a;
+      auto found = midpoints.find(key);
+      if (found != midpoints.end()) {
+        return found->second;
+      }
+      GLuint index = GLuint(positions.size());
+      positions.push_back(glm::normalize(positions[a] + positions[b]));
+      midpoints.emplace(key, index);
+      return index;
+    };
+    std::vector<GLuint> subdivided;
+    subdivided.reserve(triangles.size() * 4);
+    for (std::size_t i = 0; i < triangles.size(); i += 3) {
+      GLuint a = triangles[i], b = triangles[i + 1], c = triangles[i + 2];
+      GLuint ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+      GLuint split[12] = {a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca};
+      subdivided.insert(subdivided.end(), split, split + 12);
+    }
+    triangles.swap(subdivided);
+  }
+
+  // longitude increases towards -z, so textures are not mirrored seen from outside
+  std::vector<glm::fvec2> texcoords(positions.size());
+  for (std::size_t i = 0; i < positions.size(); ++i) {
+    glm::fvec3 const& p = positions[i];
+    texcoords[i] = glm::fvec2{0.5f + std::atan2(-p.z, p.x) / glm::two_pi<float>(),
+                              0.5f + std::asin(glm::clamp(p.y, -1.0f, 1.0f)) / glm::pi<float>()};
+  }
+  // triangles crossing the seam get copies of their vertices with u beyond 1
+  std::unordered_map<GLuint, GLuint> wrapped;
+  for (std::size_t i = 0; i < triangles.size(); i += 3) {
+    float u[3] = {texcoords[triangles[i]].x, texcoords[triangles[i + 1]].x, texcoords[triangles[i + 2]].x};
+    if (std::max(u[0], std::max(u[1], u[2])) - std::min(u[0], std::min(u[1], u[2])) < 0.5f) {
+      continue;
+    }
+    for (std::size_t corner = i; corner < i + 3; ++corner) {
+      GLuint index = triangles[corner];
+      if (texcoords[index].x >= 0.5f) {
+        continue;
+      }
+      auto found = wrapped.find(index);
+      if (found == wrapped.end()) {
+        found = wrapped.emplace(index, GLuint(positions.size())).first;
+        positions.push_back(positions[index]);
+        texcoords.push_back(texcoords[index] + glm::fvec2{1.0f, 0.0f});
+      }
+      triangles[corner] = found->second;
+    }
+  }
+  // the longitude of a pole is undefined, every triangle gets its own pole at the longitude of its other corners
+  for (std::size_t i = 0; i < triangles.size(); i += 3) {
+    for (std::size_t corner = 0; corner < 3; ++corner) {
+      // the poles are the first two vertices
+      GLuint index = triangles[i + corner];
+      if (index > 1) {
+        continue;
+      }
+      float u = (texcoords[triangles[i + (corner + 1) % 3]].x + texcoords[triangles[i + (corner + 2) % 3]].x) * 0.5f;
+      triangles[i + corner] = GLuint(positions.size());
+      positions.push_back(positions[index]);
+      texcoords.push_back(glm::fvec2{u, texcoords[index].y});
+    }
+  }
+
+  // on a unit sphere the normal is the position
+  std::vector<glm::fvec4> tangents = tangent_space::tangents(positions, positions, texcoords, triangles);
+
+  // interleave in the order of model::VERTEX_ATTRIBS
+  std::vector<GLfloat> data;
+  data.reserve(positions.size() * 12);
+  for (std::size_t i = 0; i < positions.size(); ++i) {
+    glm::fvec3 const& p = positions[i];
+    glm::fvec4 const& t = tangents[i];
+    GLfloat vertex[12] = {p.x, p.y, p.z, p.x, p.y, p.z, texcoords[i].x, texcoords[i].y, t.x, t.y, t.z, t.w};
+    data.insert(data.end(), vertex, vertex + 12);
+  }
+  return model{data, model::POSITION | model::NORMAL | model::TEXCOORD | model::TANGENT, triangles};
+}
+
+model chain(unsigned count, std::vector<level>& levels) {
+  std::vector<GLfloat> data;
+  std::vector<GLuint> indices;
+  levels.clear();
+  GLuint vertex_offset = 0;
+  for (unsigned subdivisions = 0; subdivisions < count; ++subdivisions) {
+    model sphere = icosphere(subdivisions);
+    levels.push_back(level{GLsizei(indices.size()), GLsizei(sphere.indices.size())});
+    data.insert(data.end(), sphere.data.begin(), sphere.data.end());
+    // indices refer to the shared vertex buffer, so no base vertex is needed
+    for (GLuint index : sphere.indices) {
+      indices.push_back(index + vertex_offset);
+    }
+    vertex_offset += GLuint(sphere.vertex_num);
+  }
+  return model{data, model::POSITION | model::NORMAL | model::TEXCOORD | model::TANGENT, indices};
+}
+
+float screen_radius(glm::vec3 const& view_center, float radius, glm::mat4 const& projection, float viewport_height) {
+  float distance = glm::length(view_center);
+  if (distance <= radius) {
+    return std::numeric_limits<float>::max();
+  }
+  // projection[1][1] is the cotangent of half the vertical field of view
+  return radius * projection[1][1] * 0.5f * viewport_height / distance;
+}
+
+unsigned select(float radius_pixels, unsigned previous, unsigned count, float edge_pixels, float hysteresis) {
+  if (count == 0) {
+    return 0;
+  }
+  // every subdivision halves the edges, level n is needed above this radius
+  auto boundary = [edge_pixels](unsigned n) {
+    return edge_pixels * std::ldexp(1.0f, int(n) - 1) / icosahedron_edge;
+  };
+  unsigned level = previous < count ? previous : count - 1;
+  while (level + 1 < count && radius_pixels > boundary(level + 1) * (1.0f + hysteresis)) {
+    ++level;
+  }
+  while (level > 0 && radius_pixels < boundary(level) * (1.0f - hysteresis)) {
+    --level;
+  }
+  return level;
+}
+
+}
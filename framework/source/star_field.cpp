@@ -0,0 +1,172 @@
+#include "star_field.hpp"
+#include "ThreadPool.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// stars generated by one parallel task
+static const std::size_t block_size = 1 << 16;
+// random numbers drawn per star
+static const std::uint64_t star_counters = 5;
+
+float counter_random(std::uint64_t seed, std::uint64_t counter) {
+  // splitmix64 finalizer of the combined key
+  std::uint64_t z = seed * 0x9E3779B97F4A7C15ull + counter;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  z ^= z >> 31;
+  // upper 24 bits fit exactly into a float
+  return float(z >> 40) * (1.0f / 16777216.0f);
+}
+
+// spectral colors from hot to cool stars
+static glm::fvec3 star_color(float temperature) {
+  static const glm::fvec3 colors[4] = {
+    {0.7f, 0.8f, 1.0f}, {1.0f, 1.0f, 1.0f}, {1.0f, 0.9f, 0.7f}, {1.0f, 0.7f, 0.5f}
+  };
+  float scaled = temperature * 3.0f;
+  int lower = std::min(int(scaled), 2);
+  return glm::mix(colors[lower], colors[lower + 1], scaled - float(lower));
+}
+
+static star generate(star_field::parameters const& params, std::size_t index) {
+  std::uint64_t counter = std::uint64_t(index) * star_counters;
+  float u[star_counters];
+  for (std::uint64_t i = 0; i < star_counters; ++i) {
+    u[i] = counter_random(params.seed, counter + i);
+  }
+  // uniform in the ball: uniform direction, radius from the cube root
+  float z = 1.0f - 2.0f * u[0];
+  float azimuth = glm::two_pi<float>() * u[1];
+  float ring = std::sqrt(std::max(0.0f, 1.0f - z * z));
+  float distance = params.radius * std::cbrt(u[2]);
+
+  star result;
+  result.position = glm::fvec3{ring * std::cos(azimuth), z, ring * std::sin(azimuth)} * distance;
+  result.color = star_color(u[3]);
+  // the number of stars brighter than m grows with 10^(0.6 m), sampled by inverting that distribution
+  float low = std::pow(10.0f, 0.6f * params.brightest);
+  float high = std::pow(10.0f, 0.6f * params.faintest);
+  result.magnitude = std::log10(low + u[4] * (high - low)) / 0.6f;
+  return result;
+}
+
+star_field::star_field()
+ :m_stars{}
+ ,m_chunks{}
+{}
+
+star_field::star_field(parameters const& params, ThreadPool* pool)
+ :m_stars{}
+ ,m_chunks{}
+{
+  std::size_t const count = params.count;
+  unsigned const axis = std::max(params.chunks_per_axis, 1u);
+  std::vector<star> generated(count);
+  std::vector<unsigned> cells(count);
+  // each star depends only on its index, so blocks can be generated in any order
+  auto task = [&](std::size_t block) {
+    std::size_t end = std::min(count, (block + 1) * block_size);
+    for (std::size_t i = block * block_size; i < end; ++i) {
+      generated[i] = generate(params, i);
+      glm::fvec3 cell = (generated[i].position / params.radius + 1.0f) * (0.5f * float(axis));
+      cell = glm::clamp(cell, glm::fvec3{0.0f}, glm::fvec3{float(axis - 1)});
+      cells[i] = (unsigned(cell.z) * axis + unsigned(cell.y)) * axis + unsigned(cell.x);
+    }
+  };
+  std::size_t const blocks = (count + block_size - 1) / block_size;
+  if (pool != nullptr && blocks > 1) {
+    pool->run(blocks, task);
+  }
+  else {
+    for (std::size_t block = 0; block < blocks; ++block) {
+      task(block);
+    }
+  }
+
+  // counting sort by cell keeps the index order inside a cell
+  std::vector<std::size_t> starts(std::size_t(axis) * axis * axis + 1, 0);
+  for (unsigned cell : cells) {
+    ++starts[cell + 1];
+  }
+  for (std::size_t cell = 1; cell < starts.size(); ++cell) {
+    starts[cell] += starts[cell - 1];
+  }
+  m_stars.resize(count);
+  std::vector<std::size_t> positions(starts.begin(), starts.end() - 1);
+  for (std::size_t i = 0; i < count; ++i) {
+    m_stars[positions[cells[i]]++] = generated[i];
+  }
+
+  for (std::size_t cell = 0; cell + 1 < starts.size(); ++cell) {
+    if (starts[cell] == starts[cell + 1]) {
+      continue;
+    }
+    star_chunk chunk;
+    chunk.first = GLint(starts[cell]);
+    chunk.count = GLsizei(starts[cell + 1] - starts[cell]);
+    m_chunks.push_back(chunk);
+  }
+  // brightest first, so a prefix of a chunk is a decimated version of it
+  auto finish = [this](std::size_t index) {
+    star_chunk& chunk = m_chunks[index];
+    auto begin = m_stars.begin() + chunk.first;
+    auto end = begin + chunk.count;
+    std::stable_sort(begin, end, [](star const& a, star const& b) { return a.magnitude < b.magnitude; });
+    glm::fvec3 min{begin->position};
+    glm::fvec3 max{min};
+    for (auto it = begin; it != end; ++it) {
+      min = glm::min(min, it->position);
+      max = glm::max(max, it->position);
+    }
+    glm::fvec3 center = (min + max) * 0.5f;
+    float radius = 0.0f;
+    for (auto it = begin; it != end; ++it) {
+      radius = std::max(radius, glm::length(it->position - center));
+    }
+    chunk.bounds = glm::fvec4{center, radius};
+  };
+  if (pool != nullptr) {
+    pool->run(m_chunks.size(), finish);
+  }
+  else {
+    for (std::size_t chunk = 0; chunk < m_chunks.size(); ++chunk) {
+      finish(chunk);
+    }
+  }
+}
+
+std::vector<star> const& star_field::stars() const {
+  return m_stars;
+}
+
+std::vector<star_chunk> const& star_field::chunks() const {
+  return m_chunks;
+}
+
+std::size_t star_field::select(frustum_culling::frustum const& planes, glm::fvec3 const& eye,
+                               float full_detail_distance, float min_fraction,
+                               std::vector<GLint>& firsts, std::vector<GLsizei>& counts) const {
+  firsts.clear();
+  counts.clear();
+  std::size_t selected = 0;
+  for (star_chunk const& chunk : m_chunks) {
+    if (frustum_culling::classify(planes, chunk.bounds) == frustum_culling::OUTSIDE) {
+      continue;
+    }
+    // distance to the nearest point of the bounds
+    float distance = glm::length(glm::fvec3(chunk.bounds) - eye) - chunk.bounds.w;
+    float fraction = 1.0f;
+    if (distance > full_detail_distance) {
+      float ratio = full_detail_distance / distance;
+      fraction = std::max(ratio * ratio, min_fraction);
+    }
+    GLsizei count = std::max(GLsizei(1), GLsizei(float(chunk.count) * fraction));
+    firsts.push_back(chunk.first);
+    counts.push_back(count);
+    selected += std::size_t(count);
+  }
+  return selected;
+}
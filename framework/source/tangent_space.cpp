@@ -0,0 +1,266 @@
+#include "tangent_space.hpp"
+
+#include "matrix_kernels.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+// vector kernels are only provided for x86-64, where SSE is always available
+#if defined(__x86_64__) || defined(_M_X64)
+#define TANGENT_SPACE_X86
+#include <immintrin.h>
+#endif
+
+namespace tangent_space {
+
+// faces or vertices per task
+static const std::size_t block_size = 1 << 14;
+
+// run body(begin, end) for blocks of [0, size), on the pool if there is one
+static void for_blocks(ThreadPool* pool, std::size_t size, std::function<void(std::size_t, std::size_t)> const& body) {
+  std::size_t count = (size + block_size - 1) / block_size;
+  ThreadPool::Task task = [&](std::size_t block) {
+    body(block * block_size, std::min(size, (block + 1) * block_size));
+  };
+  if (pool != nullptr && count > 1) {
+    pool->run(count, task);
+  }
+  else {
+    for (std::size_t i = 0; i < count; ++i) {
+      task(i);
+    }
+  }
+}
+
+// corners of vertex v in index order are corners[first[v]] to corners[first[v + 1] - 1]
+struct adjacency {
+  std::vector<std::size_t> first;
+  std::vector<std::size_t> corners;
+};
+
+static adjacency corners_of_vertices(std::size_t vertex_num, std::vector<GLuint> const& indices) {
+  adjacency result{std::vector<std::size_t>(vertex_num + 1, 0), std::vector<std::size_t>(indices.size() / 3 * 3)};
+  for (std::size_t c = 0; c < result.corners.size(); ++c) {
+    if (indices[c] >= vertex_num) {
+      throw std::logic_error("tangent_space: index " + std::to_string(indices[c]) + " out of range");
+    }
+    ++result.first[indices[c] + 1];
+  }
+  for (std::size_t v = 0; v < vertex_num; ++v) {
+    result.first[v + 1] += result.first[v];
+  }
+  std::vector<std::size_t> filled(result.first.begin(), result.first.end() - 1);
+  for (std::size_t c = 0; c < result.corners.size(); ++c) {
+    result.corners[filled[indices[c]]++] = c;
+  }
+  return result;
+}
+
+///////////////////////////// scalar kernels /////////////////////////////////
+// vector kernels evaluate the same expressions lane-wise, so both give identical results
+
+// cross product of the edges from the first corner, length is twice the area
+static inline glm::fvec3 face_normal_scalar(glm::fvec3 const& a, glm::fvec3 const& b, glm::fvec3 const& c) {
+  float e1x = b.x - a.x, e1y = b.y - a.y, e1z = b.z - a.z;
+  float e2x = c.x - a.x, e2y = c.y - a.y, e2z = c.z - a.z;
+  return glm::fvec3{e1y * e2z - e1z * e2y, e1z * e2x - e1x * e2z, e1x * e2y - e1y * e2x};
+}
+
+// unit directions of increasing u and v in the plane of the face, mirrored with the uv mapping
+// zero for faces without uv area
+static inline void face_frame_scalar(glm::fvec3 const& a, glm::fvec3 const& b, glm::fvec3 const& c,
+                                     glm::fvec2 const& ta, glm::fvec2 const& tb, glm::fvec2 const& tc,
+                                     glm::fvec3& tangent, glm::fvec3& bitangent) {
+  float e1x = b.x - a.x, e1y = b.y - a.y, e1z = b.z - a.z;
+  float e2x = c.x - a.x, e2y = c.y - a.y, e2z = c.z - a.z;
+  float s1 = tb.x - ta.x, t1 = tb.y - ta.y;
+  float s2 = tc.x - ta.x, t2 = tc.y - ta.y;
+  float area = s1 * t2 - s2 * t1;
+  float sign = area < 0.0f ? -1.0f : 1.0f;
+  float tx = e1x * t2 - e2x * t1, ty = e1y * t2 - e2y * t1, tz = e1z * t2 - e2z * t1;
+  float bx = e2x * s1 - e1x * s2, by = e2y * s1 - e1y * s2, bz = e2z * s1 - e1z * s2;
+  float tangent_length = std::sqrt(tx * tx + ty * ty + tz * tz);
+  float bitangent_length = std::sqrt(bx * bx + by * by + bz * bz);
+  float tangent_scale = area != 0.0f && tangent_length > 0.0f ? sign / tangent_length : 0.0f;
+  float bitangent_scale = area != 0.0f && bitangent_length > 0.0f ? sign / bitangent_length : 0.0f;
+  tangent = glm::fvec3{tx * tangent_scale, ty * tangent_scale, tz * tangent_scale};
+  bitangent = glm::fvec3{bx * bitangent_scale, by * bitangent_scale, bz * bitangent_scale};
+}
+
+#ifdef TANGENT_SPACE_X86
+///////////////////////////// SSE kernels ////////////////////////////////////
+// components of one attribute of four faces, one face per lane
+static inline __m128 gather(float const* base, std::size_t stride, GLuint const* corners, std::size_t component) {
+  return _mm_setr_ps(base[corners[0] * stride + component], base[corners[3] * stride + component],
+                     base[corners[6] * stride + component], base[corners[9] * stride + component]);
+}
+
+static inline void scatter(__m128 x, __m128 y, __m128 z, glm::fvec3* out) {
+  float lanes[3][4];
+  _mm_storeu_ps(lanes[0], x);
+  _mm_storeu_ps(lanes[1], y);
+  _mm_storeu_ps(lanes[2], z);
+  for (unsigned i = 0; i < 4; ++i) {
+    out[i] = glm::fvec3{lanes[0][i], lanes[1][i], lanes[2][i]};
+  }
+}
+
+static void face_normals_sse(float const* positions, GLuint const* corners, glm::fvec3* out) {
+  __m128 ax = gather(positions, 3, corners, 0), ay = gather(positions, 3, corners, 1), az = gather(positions, 3, corners, 2);
+  __m128 e1x = _mm_sub_ps(gather(positions, 3, corners + 1, 0), ax);
+  __m128 e1y = _mm_sub_ps(gather(positions, 3, corners + 1, 1), ay);
+  __m128 e1z = _mm_sub_ps(gather(positions, 3, corners + 1, 2), az);
+  __m128 e2x = _mm_sub_ps(gather(positions, 3, corners + 2, 0), ax);
+  __m128 e2y = _mm_sub_ps(gather(positions, 3, corners + 2, 1), ay);
+  __m128 e2z = _mm_sub_ps(gather(positions, 3, corners + 2, 2), az);
+  scatter(_mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y)),
+          _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z)),
+          _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x)), out);
+}
+
+static void face_frames_sse(float const* positions, float const* texcoords, GLuint const* corners,
+                            glm::fvec3* tangents, glm::fvec3* bitangents) {
+  __m128 ax = gather(positions, 3, corners, 0), ay = gather(positions, 3, corners, 1), az = gather(positions, 3, corners, 2);
+  __m128 e1x = _mm_sub_ps(gather(positions, 3, corners + 1, 0), ax);
+  __m128 e1y = _mm_sub_ps(gather(positions, 3, corners + 1, 1), ay);
+  __m128 e1z = _mm_sub_ps(gather(positions, 3, corners + 1, 2), az);
+  __m128 e2x = _mm_sub_ps(gather(positions, 3, corners + 2, 0), ax);
+  __m128 e2y = _mm_sub_ps(gather(positions, 3, corners + 2, 1), ay);
+  __m128 e2z = _mm_sub_ps(gather(positions, 3, corners + 2, 2), az);
+  __m128 u = gather(texcoords, 2, corners, 0), v = gather(texcoords, 2, corners, 1);
+  __m128 s1 = _mm_sub_ps(gather(texcoords, 2, corners + 1, 0), u), t1 = _mm_sub_ps(gather(texcoords, 2, corners + 1, 1), v);
+  __m128 s2 = _mm_sub_ps(gather(texcoords, 2, corners + 2, 0), u), t2 = _mm_sub_ps(gather(texcoords, 2, corners + 2, 1), v);
+  __m128 area = _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1));
+  __m128 const zero = _mm_setzero_ps();
+  __m128 sign = _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(area, zero), _mm_set1_ps(-1.0f)),
+                          _mm_andnot_ps(_mm_cmplt_ps(area, zero), _mm_set1_ps(1.0f)));
+  __m128 tx = _mm_sub_ps(_mm_mul_ps(e1x, t2), _mm_mul_ps(e2x, t1));
+  __m128 ty = _mm_sub_ps(_mm_mul_ps(e1y, t2), _mm_mul_ps(e2y, t1));
+  __m128 tz = _mm_sub_ps(_mm_mul_ps(e1z, t2), _mm_mul_ps(e2z, t1));
+  __m128 bx = _mm_sub_ps(_mm_mul_ps(e2x, s1), _mm_mul_ps(e1x, s2));
+  __m128 by = _mm_sub_ps(_mm_mul_ps(e2y, s1), _mm_mul_ps(e1y, s2));
+  __m128 bz = _mm_sub_ps(_mm_mul_ps(e2z, s1), _mm_mul_ps(e1z, s2));
+  __m128 tangent_length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz)));
+  __m128 bitangent_length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(bx, bx), _mm_mul_ps(by, by)), _mm_mul_ps(bz, bz)));
+  // lanes without area or length are masked to zero, their quotients are never used
+  __m128 has_area = _mm_cmpneq_ps(area, zero);
+  __m128 tangent_scale = _mm_and_ps(_mm_and_ps(has_area, _mm_cmpgt_ps(tangent_length, zero)),
+                                    _mm_div_ps(sign, tangent_length));
+  __m128 bitangent_scale = _mm_and_ps(_mm_and_ps(has_area, _mm_cmpgt_ps(bitangent_length, zero)),
+                                      _mm_div_ps(sign, bitangent_length));
+  scatter(_mm_mul_ps(tx, tangent_scale), _mm_mul_ps(ty, tangent_scale), _mm_mul_ps(tz, tangent_scale), tangents);
+  scatter(_mm_mul_ps(bx, bitangent_scale), _mm_mul_ps(by, bitangent_scale), _mm_mul_ps(bz, bitangent_scale), bitangents);
+}
+#endif
+
+static bool use_sse() {
+#ifdef TANGENT_SPACE_X86
+  return matrix_kernels::active_isa() >= matrix_kernels::SSE;
+#else
+  return false;
+#endif
+}
+
+// component of v orthogonal to the unit vector n, normalized, zero if there is none
+static glm::fvec3 project(glm::fvec3 const& v, glm::fvec3 const& n) {
+  glm::fvec3 projected = v - n * glm::dot(n, v);
+  float length = glm::length(projected);
+  return length > 0.0f ? projected / length : glm::fvec3{0.0f};
+}
+
+std::vector<glm::fvec3> normals(std::vector<glm::fvec3> const& positions, std::vector<GLuint> const& indices,
+                                ThreadPool* pool) {
+  adjacency adjacent = corners_of_vertices(positions.size(), indices);
+  std::size_t const face_num = indices.size() / 3;
+  std::vector<glm::fvec3> face_normals(face_num);
+  bool const sse = use_sse();
+  for_blocks(pool, face_num, [&](std::size_t begin, std::size_t end) {
+    std::size_t f = begin;
+#ifdef TANGENT_SPACE_X86
+    for (; sse && f + 4 <= end; f += 4) {
+      face_normals_sse(&positions[0].x, &indices[f * 3], &face_normals[f]);
+    }
+#endif
+    for (; f < end; ++f) {
+      face_normals[f] = face_normal_scalar(positions[indices[f * 3]], positions[indices[f * 3 + 1]],
+                                           positions[indices[f * 3 + 2]]);
+    }
+  });
+
+  std::vector<glm::fvec3> result(positions.size());
+  for_blocks(pool, positions.size(), [&](std::size_t begin, std::size_t end) {
+    for (std::size_t v = begin; v < end; ++v) {
+      glm::fvec3 sum{0.0f};
+      for (std::size_t i = adjacent.first[v]; i < adjacent.first[v + 1]; ++i) {
+        sum += face_normals[adjacent.corners[i] / 3];
+      }
+      float length = glm::length(sum);
+      result[v] = length > 0.0f ? sum / length : glm::fvec3{0.0f, 0.0f, 1.0f};
+    }
+  });
+  return result;
+}
+
+std::vector<glm::fvec4> tangents(std::vector<glm::fvec3> const& positions, std::vector<glm::fvec3> const& normals,
+                                 std::vector<glm::fvec2> const& texcoords, std::vector<GLuint> const& indices,
+                                 ThreadPool* pool) {
+  if (normals.size() != positions.size() || texcoords.size() != positions.size()) {
+    throw std::logic_error("tangent_space: normals and texture coordinates must match the positions");
+  }
+  adjacency adjacent = corners_of_vertices(positions.size(), indices);
+  std::size_t const face_num = indices.size() / 3;
+  std::vector<glm::fvec3> face_tangents(face_num);
+  std::vector<glm::fvec3> face_bitangents(face_num);
+  bool const sse = use_sse();
+  for_blocks(pool, face_num, [&](std::size_t begin, std::size_t end) {
+    std::size_t f = begin;
+#ifdef TANGENT_SPACE_X86
+    for (; sse && f + 4 <= end; f += 4) {
+      face_frames_sse(&positions[0].x, &texcoords[0].x, &indices[f * 3], &face_tangents[f], &face_bitangents[f]);
+    }
+#endif
+    for (; f < end; ++f) {
+      GLuint a = indices[f * 3], b = indices[f * 3 + 1], c = indices[f * 3 + 2];
+      face_frame_scalar(positions[a], positions[b], positions[c], texcoords[a], texcoords[b], texcoords[c],
+                        face_tangents[f], face_bitangents[f]);
+    }
+  });
+
+  std::vector<glm::fvec4> result(positions.size());
+  for_blocks(pool, positions.size(), [&](std::size_t begin, std::size_t end) {
+    for (std::size_t v = begin; v < end; ++v) {
+      float normal_length = glm::length(normals[v]);
+      glm::fvec3 n = normal_length > 0.0f ? normals[v] / normal_length : glm::fvec3{0.0f, 0.0f, 1.0f};
+      glm::fvec3 tangent{0.0f};
+      glm::fvec3 bitangent{0.0f};
+      for (std::size_t i = adjacent.first[v]; i < adjacent.first[v + 1]; ++i) {
+        std::size_t face = adjacent.corners[i] / 3;
+        std::size_t corner = adjacent.corners[i] % 3;
+        // angle between the edges of the corner in the tangent plane
+        glm::fvec3 p = positions[v];
+        glm::fvec3 edge1 = project(positions[indices[face * 3 + (corner + 1) % 3]] - p, n);
+        glm::fvec3 edge2 = project(positions[indices[face * 3 + (corner + 2) % 3]] - p, n);
+        float angle = std::acos(glm::clamp(glm::dot(edge1, edge2), -1.0f, 1.0f));
+        tangent += project(face_tangents[face], n) * angle;
+        bitangent += project(face_bitangents[face], n) * angle;
+      }
+      float length = glm::length(tangent);
+      if (length > 0.0f) {
+        tangent /= length;
+      }
+      else {
+        // no uv mapping around the vertex, any direction in the tangent plane will do
+        tangent = project(std::abs(n.x) < 0.9f ? glm::fvec3{1.0f, 0.0f, 0.0f} : glm::fvec3{0.0f, 1.0f, 0.0f}, n);
+      }
+      float sign = glm::dot(glm::cross(n, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+      result[v] = glm::fvec4{tangent, sign};
+    }
+  });
+  return result;
+}
+
+}
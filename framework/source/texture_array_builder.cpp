@@ -0,0 +1,130 @@
+#include "texture_array_builder.hpp"
+
+#include <glbinding/gl/functions.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+static std::size_t num_components(GLenum channels) {
+  if (channels == GL_RED) return 1;
+  if (channels == GL_RG) return 2;
+  if (channels == GL_RGB) return 3;
+  if (channels == GL_RGBA) return 4;
+  throw std::logic_error("texture_array_builder: unsupported channel format");
+}
+
+// texture arrays need a sized internal format
+static GLenum internal_format(GLenum channels) {
+  if (channels == GL_RED) return GL_R8;
+  if (channels == GL_RG) return GL_RG8;
+  if (channels == GL_RGB) return GL_RGB8;
+  return GL_RGBA8;
+}
+
+texture_array_builder::texture_array_builder(std::size_t width, std::size_t height)
+ :m_width{width}
+ ,m_height{height}
+ ,m_arrays{}
+{}
+
+texture_layer texture_array_builder::add(pixel_data const& texture) {
+  if (texture.width == 0 || texture.height == 0 || texture.pixels.empty()) {
+    throw std::logic_error("texture_array_builder: empty texture");
+  }
+  bool resize = m_width != 0 && m_height != 0 && (texture.width != m_width || texture.height != m_height);
+  std::size_t width = resize ? m_width : texture.width;
+  std::size_t height = resize ? m_height : texture.height;
+
+  // find array with the same size and format
+  unsigned array = 0;
+  for (; array < m_arrays.size(); ++array) {
+    array_data const& candidate = m_arrays[array];
+    if (candidate.width == width && candidate.height == height &&
+        candidate.channels == texture.channels && candidate.channel_type == texture.channel_type) {
+      break;
+    }
+  }
+  if (array == m_arrays.size()) {
+    m_arrays.push_back(array_data{width, height, texture.channels, texture.channel_type, {}});
+  }
+
+  std::vector<pixel_data>& layers = m_arrays[array].layers;
+  layers.push_back(resize ? resample(texture, width, height) : texture);
+  return texture_layer{array, GLint(layers.size() - 1)};
+}
+
+std::size_t texture_array_builder::size() const {
+  return m_arrays.size();
+}
+
+std::size_t texture_array_builder::layers(unsigned array) const {
+  return m_arrays.at(array).layers.size();
+}
+
+std::vector<texture_object> texture_array_builder::build() const {
+  std::vector<texture_object> objects{};
+  for (array_data const& array : m_arrays) {
+    texture_object object{};
+    object.target = GL_TEXTURE_2D_ARRAY;
+    glGenTextures(1, &object.handle);
+    glBindTexture(object.target, object.handle);
+
+    // rows of 8 bit rgb textures are not 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage3D(object.target, 0, GLint(internal_format(array.channels)),
+                 GLsizei(array.width), GLsizei(array.height), GLsizei(array.layers.size()),
+                 0, array.channels, array.channel_type, nullptr);
+    for (std::size_t layer = 0; layer < array.layers.size(); ++layer) {
+      glTexSubImage3D(object.target, 0, 0, 0, GLint(layer),
+                      GLsizei(array.width), GLsizei(array.height), 1,
+                      array.channels, array.channel_type, array.layers[layer].ptr());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // sphere texture coordinates run past 1 at the seam
+    glTexParameteri(object.target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(object.target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(object.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(object.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // mip levels are generated per layer
+    glGenerateMipmap(object.target);
+
+    objects.push_back(object);
+  }
+  return objects;
+}
+
+pixel_data resample(pixel_data const& texture, std::size_t width, std::size_t height) {
+  if (texture.channel_type != GL_UNSIGNED_BYTE) {
+    throw std::logic_error("resample: only 8 bit textures are supported");
+  }
+  std::size_t components = num_components(texture.channels);
+  std::vector<std::uint8_t> pixels(width * height * components);
+
+  // sample at pixel centers
+  float scale_x = float(texture.width) / float(width);
+  float scale_y = float(texture.height) / float(height);
+  for (std::size_t y = 0; y < height; ++y) {
+    float source_y = std::max((float(y) + 0.5f) * scale_y - 0.5f, 0.0f);
+    std::size_t y0 = std::min(std::size_t(source_y), texture.height - 1);
+    std::size_t y1 = std::min(y0 + 1, texture.height - 1);
+    float fy = source_y - float(y0);
+    for (std::size_t x = 0; x < width; ++x) {
+      float source_x = std::max((float(x) + 0.5f) * scale_x - 0.5f, 0.0f);
+      std::size_t x0 = std::min(std::size_t(source_x), texture.width - 1);
+      std::size_t x1 = std::min(x0 + 1, texture.width - 1);
+      float fx = source_x - float(x0);
+      for (std::size_t c = 0; c < components; ++c) {
+        float top = float(texture.pixels[(y0 * texture.width + x0) * components + c]) * (1.0f - fx) +
+                    float(texture.pixels[(y0 * texture.width + x1) * components + c]) * fx;
+        float bottom = float(texture.pixels[(y1 * texture.width + x0) * components + c]) * (1.0f - fx) +
+                       float(texture.pixels[(y1 * texture.width + x1) * components + c]) * fx;
+        pixels[(y * width + x) * components + c] = std::uint8_t(std::lround(top * (1.0f - fy) + bottom * fy));
+      }
+    }
+  }
+  return pixel_data{pixels, texture.channels, texture.channel_type, width, height};
+}
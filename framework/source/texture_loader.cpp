@@ -29,6 +29,8 @@ pixel_data file(std::string const& file_name) {
   if(!data_ptr) {
     throw std::logic_error(std::string{"stb_image: "} + stbi_failure_reason());
   }
+  // format holds the channels in the file, the data is converted to the requested rgba
+  format = STBI_rgb_alpha;
 
   // determine format of image data, internal format should be sized
   GLenum pixel_format = GL_NONE;
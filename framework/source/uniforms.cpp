@@ -0,0 +1,41 @@
+#include "uniforms.hpp"
+
+#include <cstring>
+
+namespace uniform {
+
+// indexed by id
+static char const* const names[COUNT] = {
+  "ModelMatrices",
+  "Instances",
+  "FirstInstance",
+  "MaterialColors",
+  "TextureSampler",
+  "NormalSampler",
+  "screenTexture",
+  "textureSize",
+  "PositionScale",
+  "PositionOffset"
+};
+
+table empty_table() {
+  table locations;
+  locations.fill(-1);
+  return locations;
+}
+
+char const* name(id uniform) {
+  return uniform < COUNT ? names[uniform] : "";
+}
+
+id find(std::string const& name) {
+  // only called when shaders are reloaded, a linear search is fine
+  for (unsigned i = 0; i < COUNT; ++i) {
+    if (std::strcmp(names[i], name.c_str()) == 0) {
+      return id(i);
+    }
+  }
+  return COUNT;
+}
+
+}
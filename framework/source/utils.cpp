@@ -64,6 +64,45 @@ GLint glGetUniformLocation(GLuint program, const GLchar* name) {
   return loc;
 }
 
+uniform::table reflect_uniforms(GLuint program) {
+  uniform::table locations = uniform::empty_table();
+
+  GLint count = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+  GLint max_length = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+  std::vector<GLchar> name_buffer(std::size_t(max_length) + 1);
+
+  for (GLint i = 0; i < count; ++i) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = GL_NONE;
+    glGetActiveUniform(program, GLuint(i), GLsizei(name_buffer.size()), &length, &size, &type, name_buffer.data());
+    std::string name{name_buffer.data(), std::size_t(length)};
+    // arrays are reported as name[0]
+    std::size_t bracket = name.find('[');
+    if (bracket != std::string::npos) {
+      name.resize(bracket);
+    }
+    uniform::id id = uniform::find(name);
+    // block members have no location and no id
+    if (id != uniform::COUNT) {
+      locations[id] = ::glGetUniformLocation(program, name.c_str());
+    }
+  }
+  return locations;
+}
+
+bool bind_uniform_block(GLuint program, const GLchar* name, GLuint binding) {
+  // glsl 150 has no layout(binding = n), so blocks are bound after linking
+  GLuint index = glGetUniformBlockIndex(program, name);
+  if (index == GL_INVALID_INDEX) {
+    return false;
+  }
+  glUniformBlockBinding(program, index, binding);
+  return true;
+}
+
 void validate_program(GLuint program) {
   glValidateProgram(program);
   // check if validation was successfull
@@ -0,0 +1,217 @@
+#include "vertex_quantization.hpp"
+
+#include <glbinding/gl/enum.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace vertex_quantization {
+
+GLushort pack_half(float value) {
+  std::uint32_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  std::uint32_t sign = (bits >> 16) & 0x8000u;
+  std::uint32_t mantissa = bits & 0x7fffffu;
+  int exponent = int((bits >> 23) & 0xffu) - 127 + 15;
+  // infinity and nan, nan keeps a mantissa bit
+  if ((bits & 0x7fffffffu) >= 0x7f800000u) {
+    return GLushort(sign | 0x7c00u | (mantissa != 0 ? 0x200u : 0u));
+  }
+  if (exponent >= 31) {
+    return GLushort(sign | 0x7c00u);
+  }
+  // denormal halfs, values below half the smallest one become zero
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return GLushort(sign);
+    }
+    mantissa |= 0x800000u;
+    unsigned shift = unsigned(14 - exponent);
+    std::uint32_t half = mantissa >> shift;
+    half += (mantissa >> (shift - 1)) & 1u;
+    return GLushort(sign | half);
+  }
+  // rounding may carry into the exponent, which is still the nearest value
+  std::uint32_t half = sign | (std::uint32_t(exponent) << 10) | (mantissa >> 13);
+  half += (mantissa >> 12) & 1u;
+  return GLushort(half);
+}
+
+float unpack_half(GLushort value) {
+  std::uint32_t sign = std::uint32_t(value & 0x8000u) << 16;
+  std::uint32_t exponent = (value >> 10) & 0x1fu;
+  std::uint32_t mantissa = value & 0x3ffu;
+  std::uint32_t bits = 0;
+  if (exponent == 0x1fu) {
+    bits = sign | 0x7f800000u | (mantissa << 13);
+  }
+  else if (exponent != 0) {
+    bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+  }
+  else {
+    // zero and denormals are exact in float
+    float magnitude = std::ldexp(float(mantissa), -24);
+    return sign != 0 ? -magnitude : magnitude;
+  }
+  float result = 0.0f;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+// two's complement field with the given number of bits
+static GLuint pack_signed(float value, unsigned bits) {
+  float max = float((1u << (bits - 1)) - 1u);
+  int quantized = int(std::round(std::min(std::max(value, -1.0f), 1.0f) * max));
+  return GLuint(quantized) & ((1u << bits) - 1u);
+}
+
+static float unpack_signed(GLuint value, unsigned bits) {
+  int quantized = int(value & ((1u << bits) - 1u));
+  if (quantized >= int(1u << (bits - 1))) {
+    quantized -= int(1u << bits);
+  }
+  return std::max(float(quantized) / float((1u << (bits - 1)) - 1u), -1.0f);
+}
+
+GLuint pack_snorm(glm::fvec4 const& value) {
+  return pack_signed(value.x, 10) | (pack_signed(value.y, 10) << 10) | (pack_signed(value.z, 10) << 20)
+       | (pack_signed(value.w, 2) << 30);
+}
+
+glm::fvec4 unpack_snorm(GLuint value) {
+  return glm::fvec4{unpack_signed(value, 10), unpack_signed(value >> 10, 10), unpack_signed(value >> 20, 10),
+                    unpack_signed(value >> 30, 2)};
+}
+
+// flags of the attributes contained in the model
+static model::attrib_flag_t contained(model const& mesh) {
+  model::attrib_flag_t attributes = 0;
+  for (auto const& offset : mesh.offsets) {
+    attributes |= offset.first;
+  }
+  return attributes;
+}
+
+static std::size_t byte_offset(model const& mesh, model::attrib_flag_t attribute) {
+  return std::size_t(reinterpret_cast<std::uintptr_t>(mesh.offsets.at(attribute)));
+}
+
+model pack(model const& mesh) {
+  if (mesh.packed) {
+    return mesh;
+  }
+  model::attrib_flag_t attributes = contained(mesh);
+  model packed{std::vector<GLfloat>{}, attributes, std::vector<GLuint>{}, true};
+  std::size_t const packed_words = std::size_t(packed.vertex_bytes) / sizeof(GLfloat);
+  std::vector<GLfloat> data(mesh.vertex_num * packed_words);
+  char const* source = reinterpret_cast<char const*>(mesh.data.data());
+  char* target = reinterpret_cast<char*>(data.data());
+
+  glm::fvec3 minimum{0.0f};
+  glm::fvec3 extent{1.0f};
+  if ((attributes & model::POSITION) && mesh.vertex_num > 0) {
+    std::size_t offset = byte_offset(mesh, model::POSITION);
+    glm::fvec3 maximum{};
+    for (std::size_t v = 0; v < mesh.vertex_num; ++v) {
+      float values[3];
+      std::memcpy(values, source + v * std::size_t(mesh.vertex_bytes) + offset, sizeof(values));
+      glm::fvec3 position{values[0], values[1], values[2]};
+      minimum = v == 0 ? position : glm::min(minimum, position);
+      maximum = v == 0 ? position : glm::max(maximum, position);
+    }
+    extent = maximum - minimum;
+  }
+
+  for (std::size_t a = 0; a < model::PACKED_ATTRIBS.size(); ++a) {
+    model::attribute const& attribute = model::PACKED_ATTRIBS[a];
+    if ((attributes & attribute.flag) == 0) {
+      continue;
+    }
+    std::size_t from = byte_offset(mesh, attribute.flag);
+    std::size_t to = byte_offset(packed, attribute.flag);
+    std::size_t const components = std::size_t(model::VERTEX_ATTRIBS[a].components);
+    for (std::size_t v = 0; v < mesh.vertex_num; ++v) {
+      float values[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+      std::memcpy(values, source + v * std::size_t(mesh.vertex_bytes) + from, components * sizeof(float));
+      char* out = target + v * std::size_t(packed.vertex_bytes) + to;
+      if (attribute.type == GL_UNSIGNED_SHORT) {
+        // the padding short stays zero
+        GLushort position[4] = {0, 0, 0, 0};
+        for (int i = 0; i < 3; ++i) {
+          float normalized = extent[i] > 0.0f ? (values[i] - minimum[i]) / extent[i] : 0.0f;
+          position[i] = GLushort(std::round(std::min(std::max(normalized, 0.0f), 1.0f) * 65535.0f));
+        }
+        std::memcpy(out, position, sizeof(position));
+      }
+      else if (attribute.type == GL_HALF_FLOAT) {
+        GLushort texcoord[2] = {pack_half(values[0]), pack_half(values[1])};
+        std::memcpy(out, texcoord, sizeof(texcoord));
+      }
+      else {
+        // the sign of tangents fits into the two bit w
+        GLuint direction = pack_snorm(glm::fvec4{values[0], values[1], values[2], values[3]});
+        std::memcpy(out, &direction, sizeof(direction));
+      }
+    }
+  }
+
+  packed.data = std::move(data);
+  packed.indices = mesh.indices;
+  packed.vertex_num = mesh.vertex_num;
+  packed.bounding_sphere = mesh.bounding_sphere;
+  packed.position_scale = extent;
+  packed.position_offset = minimum;
+  return packed;
+}
+
+model unpack(model const& mesh) {
+  if (!mesh.packed) {
+    return mesh;
+  }
+  model::attrib_flag_t attributes = contained(mesh);
+  model unpacked{std::vector<GLfloat>{}, attributes};
+  std::size_t const float_num = std::size_t(unpacked.vertex_bytes) / sizeof(GLfloat);
+  std::vector<GLfloat> data(mesh.vertex_num * float_num);
+  char const* source = reinterpret_cast<char const*>(mesh.data.data());
+
+  for (std::size_t a = 0; a < model::PACKED_ATTRIBS.size(); ++a) {
+    model::attribute const& attribute = model::PACKED_ATTRIBS[a];
+    if ((attributes & attribute.flag) == 0) {
+      continue;
+    }
+    std::size_t from = byte_offset(mesh, attribute.flag);
+    std::size_t to = byte_offset(unpacked, attribute.flag) / sizeof(GLfloat);
+    int const components = model::VERTEX_ATTRIBS[a].components;
+    for (std::size_t v = 0; v < mesh.vertex_num; ++v) {
+      char const* in = source + v * std::size_t(mesh.vertex_bytes) + from;
+      GLfloat* out = data.data() + v * float_num + to;
+      if (attribute.type == GL_UNSIGNED_SHORT) {
+        GLushort position[3];
+        std::memcpy(position, in, sizeof(position));
+        for (int i = 0; i < 3; ++i) {
+          out[i] = mesh.position_offset[i] + mesh.position_scale[i] * float(position[i]) / 65535.0f;
+        }
+      }
+      else if (attribute.type == GL_HALF_FLOAT) {
+        GLushort texcoord[2];
+        std::memcpy(texcoord, in, sizeof(texcoord));
+        out[0] = unpack_half(texcoord[0]);
+        out[1] = unpack_half(texcoord[1]);
+      }
+      else {
+        GLuint direction = 0;
+        std::memcpy(&direction, in, sizeof(direction));
+        glm::fvec4 decoded = unpack_snorm(direction);
+        for (int i = 0; i < components; ++i) {
+          out[i] = decoded[i];
+        }
+      }
+    }
+  }
+  return model{data, attributes, mesh.indices};
+}
+
+}
@@ -0,0 +1,82 @@
+#include "model_loader.hpp"
+#include "ThreadPool.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// writes a textured sphere with about the given size as obj
+static void write_sphere(std::string const &path, std::size_t megabytes) {
+    // every grid point takes about 130 bytes of v, vt, vn and f lines
+    std::size_t const side = std::size_t(std::sqrt(double(megabytes) * 1e6 / 130.0)) + 2;
+    float const pi = 3.14159265f;
+    std::ofstream out{path};
+    for (std::size_t y = 0; y < side; ++y) {
+        for (std::size_t x = 0; x < side; ++x) {
+            float theta = pi * float(y) / float(side - 1);
+            float phi = 2.0f * pi * float(x) / float(side - 1);
+            float nx = std::sin(theta) * std::cos(phi), ny = std::cos(theta), nz = std::sin(theta) * std::sin(phi);
+            out << "v " << nx * 2.5f << ' ' << ny * 2.5f << ' ' << nz * 2.5f << '\n';
+            out << "vt " << float(x) / float(side - 1) << ' ' << float(y) / float(side - 1) << '\n';
+            out << "vn " << nx << ' ' << ny << ' ' << nz << '\n';
+        }
+    }
+    for (std::size_t y = 0; y + 1 < side; ++y) {
+        for (std::size_t x = 0; x + 1 < side; ++x) {
+            std::size_t a = y * side + x + 1, b = a + 1, c = a + side, d = c + 1;
+            out << "f " << a << '/' << a << '/' << a << ' ' << b << '/' << b << '/' << b << ' '
+                << d << '/' << d << '/' << d << ' ' << c << '/' << c << '/' << c << '\n';
+        }
+    }
+}
+
+// parses an obj with tinyobjloader and with the parallel parser for several thread counts
+// usage: obj_benchmark [obj file | size of the generated sphere in MB]
+int main(int argc, char *argv[]) {
+    std::string path = "obj_benchmark.obj";
+    bool generated = true;
+    if (argc > 1 && std::ifstream{argv[1]}) {
+        path = argv[1];
+        generated = false;
+    } else {
+        write_sphere(path, argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100);
+    }
+    std::ifstream size_probe{path, std::ios::binary | std::ios::ate};
+    double const megabytes = double(size_probe.tellg()) / 1e6;
+    model::attrib_flag_t const attributes = model::NORMAL | model::TEXCOORD;
+    std::cout << path << ": " << megabytes << " MB" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    model reference = model_loader::obj(path, attributes);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double const serial_seconds = elapsed.count();
+    std::cout << "tinyobjloader: " << megabytes / serial_seconds << " MB/s, " << reference.vertex_num << " vertices"
+              << std::endl;
+
+    int result = 0;
+    for (unsigned threads : {1u, 2u, 4u, 8u, 16u}) {
+        ThreadPool pool{threads};
+        start = std::chrono::steady_clock::now();
+        model parsed = model_loader::obj_parallel(path, attributes, &pool);
+        elapsed = std::chrono::steady_clock::now() - start;
+
+        // same vertices and triangles as tinyobjloader, floats may differ in the last bit of the rounding
+        bool same = parsed.indices == reference.indices && parsed.data.size() == reference.data.size();
+        float difference = 0.0f;
+        for (std::size_t i = 0; same && i < parsed.data.size(); ++i)
+            difference = std::max(difference, std::abs(parsed.data[i] - reference.data[i]));
+        same = same && difference < 1e-5f;
+        std::cout << threads << " threads: " << megabytes / elapsed.count() << " MB/s, speedup "
+                  << serial_seconds / elapsed.count() << ", max difference " << difference
+                  << (same ? "" : ", RESULTS DIFFER") << std::endl;
+        if (!same)
+            result = 1;
+    }
+    if (generated)
+        std::remove(path.c_str());
+    return result;
+}
@@ -0,0 +1,73 @@
+#include "Node.hpp"
+#include "SceneGraph.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// measures animation and world transform update of a generated scenegraph for several thread counts
+// usage: scene_benchmark [node count] [frames]
+int main(int argc, char *argv[]) {
+    std::size_t const node_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    int const frames = argc > 2 ? std::atoi(argv[2]) : 50;
+
+    // random tree, parents are picked among the previous nodes with a bias towards recent ones
+    SceneGraph graph("benchmark");
+    std::vector<NodeHandle> nodes{graph.getRoot()};
+    std::mt19937 random{42};
+    for (std::size_t i = 1; i < node_count; ++i) {
+        std::uniform_int_distribution<std::size_t> recent(i > 64 ? i - 64 : 0, i - 1);
+        NodeHandle parent = nodes[random() % 8 == 0 ? random() % i : recent(random)];
+        Node *node = graph.create<Node>(parent, "node" + std::to_string(i));
+        node->setSpeed(std::uniform_real_distribution<float>(0.1f, 2.0f)(random));
+        node->setDistance(std::uniform_real_distribution<float>(0.5f, 5.0f)(random));
+        nodes.push_back(node->getHandle());
+    }
+    graph.updateWorldTransforms();
+
+    auto animate = [&graph](float time) {
+        graph.animate([time](Node &node, glm::mat4 &local) {
+            local = glm::rotate(glm::mat4{}, time * node.getSpeed(), glm::vec3{0.0f, 1.0f, 0.0f});
+            local = glm::translate(local, glm::vec3{0.0f, 0.0f, node.getDistance()});
+            return true;
+        });
+        graph.updateWorldTransforms();
+    };
+
+    std::cout << "nodes: " << graph.getTransforms().size() << ", frames: " << frames << std::endl;
+    std::vector<glm::mat4> reference;
+    double serial_ms = 0.0;
+    for (unsigned threads : {1u, 2u, 4u, 8u, 16u}) {
+        graph.setThreadCount(threads);
+        animate(0.0f);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            animate(0.01f * float(frame));
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        double frame_ms = elapsed.count() / frames;
+
+        // every thread count has to produce the same bits as the serial update
+        TransformStore const &transforms = graph.getTransforms();
+        bool identical = true;
+        if (reference.empty()) {
+            serial_ms = frame_ms;
+            for (std::size_t i = 0; i < transforms.size(); ++i)
+                reference.push_back(transforms.getWorld(i));
+        } else {
+            for (std::size_t i = 0; i < transforms.size(); ++i)
+                identical = identical && std::memcmp(&reference[i], &transforms.getWorld(i), sizeof(glm::mat4)) == 0;
+        }
+        std::cout << threads << " threads: " << frame_ms << " ms/frame, speedup " << serial_ms / frame_ms
+                  << (identical ? "" : ", RESULTS DIFFER") << std::endl;
+        if (!identical)
+            return 1;
+    }
+    return 0;
+}
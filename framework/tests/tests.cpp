@@ -1,62 +1,771 @@
 #include "Node.hpp"
 #include "SceneGraph.hpp"
 #include <iostream>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
 #include <GeometryNode.hpp>
+#include <matrix_kernels.hpp>
+#include <uniforms.hpp>
+#include <texture_array_builder.hpp>
+#include <render_queue.hpp>
+#include <frustum_culling.hpp>
+#include <sphere_lod.hpp>
+#include <star_field.hpp>
+#include <post_chain.hpp>
+#include <shader_loader.hpp>
+#include <ThreadPool.hpp>
+#include <model_loader.hpp>
+#include <mapped_file.hpp>
+#include <mesh_optimizer.hpp>
+#include <vertex_quantization.hpp>
+#include <tangent_space.hpp>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
 
 int main() {
-    std::shared_ptr<Node> root = std::make_shared<Node>("root");
-    auto solar_system = SceneGraph("solarSystem", root);
+    auto solar_system = SceneGraph("solarSystem");
+    Node *root = solar_system.get(solar_system.getRoot());
 
     // sun
-    std::shared_ptr<Node> sun_holder = std::make_shared<Node>("sun", root);
-    std::shared_ptr<GeometryNode> geo_sun = std::make_shared<GeometryNode>(sun_holder, "geo_sun");
-    root->addChildren(sun_holder);
+    Node *sun_holder = solar_system.create<Node>(root->getHandle(), "sun");
+    GeometryNode *geo_sun = solar_system.create<GeometryNode>(sun_holder->getHandle(), "geo_sun");
     sun_holder->setDistance(0.0f);
     sun_holder->setSize(7.0f);
-    sun_holder->addChildren(geo_sun);
 
     // merkur
-    std::shared_ptr<Node> merkur_holder = std::make_shared<Node>("merkur", root);
-    std::shared_ptr<GeometryNode> geo_merkur = std::make_shared<GeometryNode>(merkur_holder, "geo_merkur");
+    Node *merkur_holder = solar_system.create<Node>(root->getHandle(), "merkur");
+    solar_system.create<GeometryNode>(merkur_holder->getHandle(), "geo_merkur");
     merkur_holder->setSpeed(4.147f);
     merkur_holder->setDistance(5.0f + sun_holder->getSize());
     merkur_holder->setSize(0.38f);
-    root->addChildren(merkur_holder);
-    merkur_holder->addChildren(geo_merkur);
 
     // venus
-    std::shared_ptr<Node> venus_holder = std::make_shared<Node>("venus", root);
-    std::shared_ptr<GeometryNode> geo_venus = std::make_shared<GeometryNode>(merkur_holder, "geo_venus");
+    Node *venus_holder = solar_system.create<Node>(root->getHandle(), "venus");
+    GeometryNode *geo_venus = solar_system.create<GeometryNode>(venus_holder->getHandle(), "geo_venus");
     venus_holder->setSpeed(2.624f);
     venus_holder->setDistance(9.31f + sun_holder->getSize());
     venus_holder->setSize(0.94f);
-    root->addChildren(venus_holder);
-    venus_holder->addChildren(geo_venus);
 
     // earth planet
-    std::shared_ptr<Node> earth_holder = std::make_shared<Node>("earth", root);
-    std::shared_ptr<GeometryNode> geo_earth = std::make_shared<GeometryNode>(earth_holder, "geo_earth");
+    Node *earth_holder = solar_system.create<Node>(root->getHandle(), "earth");
+    solar_system.create<GeometryNode>(earth_holder->getHandle(), "geo_earth");
     earth_holder->setSpeed(1.0f);
     earth_holder->setDistance(12.93f + sun_holder->getSize());
     earth_holder->setSize(1.0f);
-    root->addChildren(earth_holder);
-    earth_holder->addChildren(geo_earth);
 
 
     // moon
-    std::shared_ptr<Node> moon_holder = std::make_shared<Node>("moon", earth_holder);
-    std::shared_ptr<GeometryNode> geo_moon = std::make_shared<GeometryNode>(earth_holder, "geo_moon");
+    Node *moon_holder = solar_system.create<Node>(earth_holder->getHandle(), "moon");
+    GeometryNode *geo_moon = solar_system.create<GeometryNode>(moon_holder->getHandle(), "geo_moon");
     moon_holder->setSpeed(0.5f);
     moon_holder->setDistance(0.4f + earth_holder->getSize());
     moon_holder->setSize(0.27f);
-    earth_holder->addChildren(moon_holder);
-    moon_holder->addChildren(geo_moon);
 
-    std::shared_ptr<Node> camera = std::make_shared<Node>("camera", root);
-    root->addChildren(camera);
+    solar_system.create<Node>(root->getHandle(), "camera");
 
 
     auto peter = root->getDrawable();
 
+    // cached render list matches the recursive collection and skips geometry subtrees
+    auto render_list = solar_system.getRenderList();
+    assert(render_list.size() == peter.size());
+    for (std::size_t i = 0; i < peter.size(); ++i)
+        assert(render_list.begin()[i] == solar_system.get(peter[i]));
+    assert(geo_sun->getKind() == Node::GEOMETRY && !geo_sun->isDrawable());
+    // breadth-first visits all nodes level by level
+    auto breadth_first = solar_system.breadthFirst();
+    assert(breadth_first.size() == solar_system.depthFirst().size());
+    for (std::size_t i = 1; i < breadth_first.size(); ++i)
+        assert(breadth_first.begin()[i - 1]->getDepth() <= breadth_first.begin()[i]->getDepth());
+
+    // lookups by name, path and id use the index of the graph
+    assert(root->getChildren("geo_moon"));
+    assert(solar_system.get(earth_holder->getChildren("geo_moon"))->getParent() == moon_holder->getHandle());
+    assert(!venus_holder->getChildren("geo_moon"));
+    assert(geo_venus->getPath() == "/root/venus/geo_venus");
+    assert(solar_system.findByPath("/root/earth/moon/geo_moon") == geo_moon->getHandle());
+    assert(solar_system.findById(moon_holder->getId()) == moon_holder->getHandle());
+    assert(geo_moon->getDepth() == 3);
+
+    // world transforms are propagated from the transform store
+    solar_system.updateWorldTransforms();
+    assert(moon_holder->getWorldTransform() == earth_holder->getLocalTransform() * moon_holder->getLocalTransform());
+
+    // only dirty subtrees are recomputed
+    assert(solar_system.updateWorldTransforms() == 0);
+    moon_holder->setSpeed(1.0f);
+    assert(solar_system.updateWorldTransforms() == 0);
+    moon_holder->setDistance(1.0f);
+    assert(solar_system.updateWorldTransforms() == 2);
+    earth_holder->setSize(2.0f);
+    moon_holder->setSize(0.5f);
+    assert(solar_system.updateWorldTransforms() == 4);
+    assert(moon_holder->getWorldTransform() == earth_holder->getLocalTransform() * moon_holder->getLocalTransform());
+
+    // attaching below an earlier node breaks pre-order until the next update
+    Node *sun_child = solar_system.create<Node>(NodeHandle{}, "sun_child");
+    sun_holder->addChildren(sun_child->getHandle());
+    sun_child->setDistance(2.0f);
+    assert(!solar_system.getTransforms().isLinear());
+    assert(solar_system.findByPath("/root/sun/sun_child") == sun_child->getHandle());
+    solar_system.updateWorldTransforms();
+    assert(solar_system.getTransforms().isLinear());
+    assert(sun_child->getWorldTransform() == sun_holder->getLocalTransform() * sun_child->getLocalTransform());
+    assert(moon_holder->getWorldTransform() == earth_holder->getLocalTransform() * moon_holder->getLocalTransform());
+
+    // only dirty subtrees are recomputed
+    assert(solar_system.updateWorldTransforms() == 0);
+    moon_holder->setSpeed(1.0f);
+    assert(solar_system.updateWorldTransforms() == 0);
+    moon_holder->setDistance(1.0f);
+    assert(solar_system.updateWorldTransforms() == 2);
+    earth_holder->setSize(2.0f);
+    moon_holder->setSize(0.5f);
+    assert(solar_system.updateWorldTransforms() == 4);
+    assert(moon_holder->getWorldTransform() == earth_holder->getLocalTransform() * moon_holder->getLocalTransform());
+
+    // removed subtrees leave the index
+    assert(root->removeChildren("sun_child") == sun_child->getHandle());
+    assert(!solar_system.findByPath("/root/sun/sun_child"));
+    assert(sun_child->getId() == 0);
+    assert(solar_system.depthFirst().size() + 1 == solar_system.size());
+
+    // destroyed nodes invalidate their handles, slots are reused with a new generation
+    NodeHandle removed = sun_child->getHandle();
+    solar_system.destroy(removed);
+    assert(solar_system.get(removed) == nullptr);
+    Node *reused = solar_system.create<Node>(sun_holder->getHandle(), "sun_child");
+    assert(reused->getHandle().index == removed.index && reused->getHandle() != removed);
+    assert(solar_system.get(removed) == nullptr);
+    solar_system.destroy(earth_holder->getHandle());
+    assert(!solar_system.findByName("geo_moon") && !solar_system.findByPath("/root/earth"));
+    assert(solar_system.size() == solar_system.depthFirst().size());
+    solar_system.updateWorldTransforms();
+    assert(reused->getWorldTransform() == sun_holder->getLocalTransform());
+    // moved graphs keep their nodes
+    SceneGraph moved_system = std::move(solar_system);
+    assert(moved_system.get(reused->getHandle()) == reused);
+    assert(moved_system.findByPath("/root/sun/sun_child") == reused->getHandle());
+    reused->setDistance(1.0f);
+    assert(moved_system.updateWorldTransforms() == 1);
+
+    // every kernel matches glm exactly, normal matrices up to rounding
+    std::vector<glm::mat4> locals, worlds(11), products(11), normals(11);
+    std::vector<std::size_t> parents;
+    for (std::size_t i = 0; i < 11; ++i) {
+        float f = float(i);
+        glm::mat4 m = glm::rotate(glm::mat4{}, 0.3f * f, glm::vec3{0.2f, 1.0f, 0.1f * f});
+        m = glm::translate(m, glm::vec3{1.0f + f, 0.5f, -2.0f});
+        locals.push_back(glm::scale(m, glm::vec3{0.5f + 0.1f * f}));
+        parents.push_back(i == 0 ? TransformStore::npos : (i - 1) / 2);
+    }
+    glm::mat4 view = glm::lookAt(glm::vec3{0.0f, 3.0f, 10.0f}, glm::vec3{0.0f}, glm::vec3{0.0f, 1.0f, 0.0f});
+    matrix_kernels::isa supported = matrix_kernels::supported_isa();
+    for (int level = matrix_kernels::SCALAR; level <= supported; ++level) {
+        assert(matrix_kernels::set_isa(matrix_kernels::isa(level)) == level);
+        matrix_kernels::multiply(locals.data(), locals.data() + 1, products.data(), 10);
+        for (std::size_t i = 0; i < 10; ++i)
+            assert(products[i] == locals[i] * locals[i + 1]);
+        matrix_kernels::propagate(parents.data(), locals.data(), worlds.data(), 0, 11);
+        for (std::size_t i = 1; i < 11; ++i)
+            assert(worlds[i] == worlds[parents[i]] * locals[i]);
+        matrix_kernels::normal_matrices(view, worlds.data(), normals.data(), 11);
+        for (std::size_t i = 0; i < 11; ++i) {
+            glm::mat3 expected = glm::inverseTranspose(glm::mat3(view * worlds[i]));
+            for (int col = 0; col < 3; ++col)
+                for (int row = 0; row < 3; ++row)
+                    assert(std::abs(normals[i][col][row] - expected[col][row]) < 1e-4f);
+            assert(normals[i][3] == glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        }
+    }
+    std::cout << "matrix kernels: " << matrix_kernels::isa_name(supported) << std::endl;
+
+    // parallel updates give the same bits as the serial one
+    SceneGraph big_graph("big", "big_root");
+    std::vector<NodeHandle> big_nodes{big_graph.getRoot()};
+    for (std::size_t i = 1; i < 3000; ++i) {
+        NodeHandle parent = big_nodes[i < 8 ? i - 1 : (i * 7919) % (i - 1)];
+        Node *node = big_graph.create<Node>(parent, "node");
+        node->setSpeed(0.001f * float(i));
+        node->setDistance(1.0f + 0.01f * float(i % 7));
+        big_nodes.push_back(node->getHandle());
+    }
+    auto spin = [](Node &node, glm::mat4 &local) {
+        local = glm::translate(glm::rotate(glm::mat4{}, node.getSpeed(), glm::vec3{0.0f, 1.0f, 0.0f}),
+                               glm::vec3{0.0f, 0.0f, node.getDistance()});
+        return true;
+    };
+    assert(big_graph.animate(spin) == 3000);
+    assert(big_graph.updateWorldTransforms() == 3000);
+    std::vector<glm::mat4> serial_worlds;
+    for (std::size_t i = 0; i < big_graph.getTransforms().size(); ++i)
+        serial_worlds.push_back(big_graph.getTransforms().getWorld(i));
+    big_graph.setThreadCount(4);
+    assert(big_graph.getThreadCount() == 4);
+    for (std::size_t grain : {1, 16, 1000}) {
+        big_graph.setGrainSize(grain);
+        assert(big_graph.animate(spin) == 3000);
+        assert(big_graph.updateWorldTransforms() == 3000);
+        for (std::size_t i = 0; i < serial_worlds.size(); ++i)
+            assert(std::memcmp(&serial_worlds[i], &big_graph.getTransforms().getWorld(i), sizeof(glm::mat4)) == 0);
+    }
+
+    // exceptions of tasks reach the caller after all tasks finished, the pool stays usable
+    ThreadPool throwing_pool{4};
+    std::vector<int> ran(1000, 0);
+    bool thrown = false;
+    try {
+        throwing_pool.run(ran.size(), [&ran](std::size_t i) {
+            ran[i] = 1;
+            if (i % 100 == 7)
+                throw std::runtime_error("task failed");
+        });
+    }
+    catch (std::runtime_error &) {
+        thrown = true;
+    }
+    assert(thrown && std::count(ran.begin(), ran.end(), 1) == 1000);
+    std::fill(ran.begin(), ran.end(), 0);
+    throwing_pool.run(ran.size(), [&ran](std::size_t i) { ran[i] = 1; });
+    assert(std::count(ran.begin(), ran.end(), 1) == 1000);
+
+    // uniform ids and glsl names map onto each other
+    for (unsigned i = 0; i < uniform::COUNT; ++i)
+        assert(uniform::find(uniform::name(uniform::id(i))) == uniform::id(i));
+    assert(uniform::find("ViewMatrix") == uniform::COUNT);
+    assert(uniform::empty_table()[uniform::INSTANCES] == -1);
+
+    // textures of equal size and format share an array
+    pixel_data small{std::vector<std::uint8_t>(4 * 2 * 4, 200), GL_RGBA, GL_UNSIGNED_BYTE, 4, 2};
+    pixel_data large{std::vector<std::uint8_t>(8 * 4 * 4, 200), GL_RGBA, GL_UNSIGNED_BYTE, 8, 4};
+    texture_array_builder by_size;
+    assert(by_size.add(small).array == 0 && by_size.add(small).layer == 1);
+    assert(by_size.add(large).array == 1 && by_size.add(large).layer == 1);
+    assert(by_size.size() == 2 && by_size.layers(0) == 2);
+    // with a layer size everything is resampled into one array
+    texture_array_builder fixed_size{4, 2};
+    fixed_size.add(small);
+    texture_layer resampled = fixed_size.add(large);
+    assert(resampled.array == 0 && resampled.layer == 1 && fixed_size.size() == 1);
+    pixel_data half = resample(large, 4, 2);
+    assert(half.width == 4 && half.height == 2 && half.pixels == small.pixels);
+
+    // draws are ordered by pass first, then by state, equal keys keep their order
+    assert(render_queue::key(0, 50, 9) < render_queue::key(1, 2, 1));
+    assert(render_queue::key(1, 2, 9) < render_queue::key(1, 3, 1));
+    assert(render_queue::key(1, 2, 1, 0, 0.25f) < render_queue::key(1, 2, 1, 0, 0.5f));
+    render_queue queue;
+    std::uint64_t keys[] = {render_queue::key(1, 3, 1), render_queue::key(0, 7, 2), render_queue::key(1, 3, 1)};
+    for (int i = 0; i < 3; ++i) {
+        draw_command command;
+        command.key = keys[i];
+        command.parameter = i;
+        queue.submit(command);
+    }
+    queue.sort();
+    assert(queue.commands()[0].parameter == 1);
+    assert(queue.commands()[1].parameter == 0 && queue.commands()[2].parameter == 2);
+    queue.clear();
+    assert(queue.commands().empty());
+
+    // subtrees completely inside or outside the frustum are decided by their bounds alone
+    glm::mat4 view_projection = glm::perspective(0.8f, 1.0f, 0.1f, 100.0f);
+    frustum_culling::frustum planes = frustum_culling::extract(view_projection);
+    for (int level = matrix_kernels::SCALAR; level <= supported; ++level) {
+        matrix_kernels::set_isa(matrix_kernels::isa(level));
+        assert(frustum_culling::classify(planes, glm::vec4{0.0f, 0.0f, -10.0f, 1.0f}) == frustum_culling::INSIDE);
+        assert(frustum_culling::classify(planes, glm::vec4{0.0f, 0.0f, -0.1f, 1.0f}) == frustum_culling::INTERSECTING);
+        std::uint8_t plane = 0;
+        assert(frustum_culling::classify(planes, glm::vec4{0.0f, 0.0f, 10.0f, 1.0f}, &plane) == frustum_culling::OUTSIDE);
+        assert(plane < 6 && frustum_culling::outside(planes, glm::vec4{0.0f, 0.0f, 10.0f, 1.0f}, plane));
+    }
+    glm::vec4 merged = frustum_culling::merge(glm::vec4{-1.0f, 0.0f, 0.0f, 1.0f}, glm::vec4{2.0f, 0.0f, 0.0f, 1.0f});
+    assert(merged == glm::vec4(0.5f, 0.0f, 0.0f, 2.5f));
+    SceneGraph culled("culled");
+    Node *inside = culled.create<Node>(culled.getRoot(), "inside");
+    inside->setLocalTransform(glm::translate(glm::mat4{}, glm::vec3{0.0f, 0.0f, -10.0f}));
+    inside->setBoundingSphere(glm::vec4{0.0f, 0.0f, 0.0f, 1.0f});
+    Node *inside_child = culled.create<Node>(inside->getHandle(), "inside_child");
+    inside_child->setLocalTransform(glm::translate(glm::mat4{}, glm::vec3{1.0f, 0.0f, 0.0f}));
+    inside_child->setBoundingSphere(glm::vec4{0.0f, 0.0f, 0.0f, 0.5f});
+    Node *behind = culled.create<Node>(culled.getRoot(), "behind");
+    behind->setLocalTransform(glm::translate(glm::mat4{}, glm::vec3{0.0f, 0.0f, 50.0f}));
+    behind->setBoundingSphere(glm::vec4{0.0f, 0.0f, 0.0f, 1.0f});
+    Node *behind_child = culled.create<Node>(behind->getHandle(), "behind_child");
+    behind_child->setBoundingSphere(glm::vec4{0.0f, 0.0f, 0.0f, 1.0f});
+    Node *partial = culled.create<Node>(culled.getRoot(), "partial");
+    partial->setLocalTransform(glm::scale(glm::translate(glm::mat4{}, glm::vec3{0.0f, 0.0f, -10.0f}), glm::vec3{2.0f}));
+    partial->setBoundingSphere(glm::vec4{0.0f, 0.0f, 0.0f, 1.0f});
+    Node *partial_child = culled.create<Node>(partial->getHandle(), "partial_child");
+    partial_child->setLocalTransform(glm::translate(glm::mat4{}, glm::vec3{50.0f, 0.0f, 0.0f}));
+    partial_child->setBoundingSphere(glm::vec4{0.0f, 0.0f, 0.0f, 1.0f});
+    culled.updateWorldTransforms();
+    // root without bounds, inside and its child, partial
+    assert(culled.cull(view_projection) == 4);
+    assert(inside->isVisible() && inside_child->isVisible() && partial->isVisible());
+    assert(!behind->isVisible() && !behind_child->isVisible() && !partial_child->isVisible());
+    assert(culled.getTransforms().getCullReused() == 0);
+    // unchanged subtrees reuse the previous result, partial is tested again
+    assert(culled.cull(view_projection) == 4);
+    assert(culled.getTransforms().getCullReused() == 3);
+    // moving into view is noticed although the subtree was rejected before
+    behind->setLocalTransform(glm::translate(glm::mat4{}, glm::vec3{0.0f, 0.0f, -20.0f}));
+    culled.updateWorldTransforms();
+    assert(culled.cull(view_projection) == 6);
+    assert(behind->isVisible() && behind_child->isVisible() && culled.getTransforms().getCullReused() == 2);
+
+    // every level has four times the triangles of the previous one, all on the unit sphere
+    std::vector<sphere_lod::level> levels;
+    model spheres = sphere_lod::chain(4, levels);
+    assert(levels.size() == 4 && levels[0].first == 0 && levels[0].count == 60);
+    for (std::size_t i = 1; i < levels.size(); ++i)
+        assert(levels[i].count == 4 * levels[i - 1].count && levels[i].first == levels[i - 1].first + levels[i - 1].count);
+    assert(spheres.indices.size() == std::size_t(levels[3].first + levels[3].count));
+    assert(std::abs(spheres.bounding_sphere.w - 1.0f) < 1e-4f);
+    for (std::size_t i = 0; i < spheres.vertex_num; ++i) {
+        GLfloat const *vertex = &spheres.data[i * 12];
+        assert(std::abs(glm::length(glm::vec3(vertex[0], vertex[1], vertex[2])) - 1.0f) < 1e-5f);
+    }
+    // no triangle stretches across the texture seam
+    for (std::size_t i = 0; i < spheres.indices.size(); i += 3) {
+        float u[3] = {spheres.data[spheres.indices[i] * 12 + 6], spheres.data[spheres.indices[i + 1] * 12 + 6],
+                      spheres.data[spheres.indices[i + 2] * 12 + 6]};
+        assert(std::max(u[0], std::max(u[1], u[2])) - std::min(u[0], std::min(u[1], u[2])) < 0.5f);
+    }
+    // levels grow with the size on screen, but not back and forth around a boundary
+    assert(sphere_lod::select(1.0f, 0, 7) == 0);
+    assert(sphere_lod::select(1000.0f, 0, 7) == 6);
+    unsigned level = sphere_lod::select(50.0f, 0, 7);
+    assert(level > 0 && level < 6);
+    assert(sphere_lod::select(50.0f * 1.1f, level, 7) == level && sphere_lod::select(50.0f / 1.1f, level, 7) == level);
+    assert(sphere_lod::screen_radius(glm::vec3{0.0f, 0.0f, -10.0f}, 1.0f, view_projection, 100.0f) >
+           sphere_lod::screen_radius(glm::vec3{0.0f, 0.0f, -20.0f}, 1.0f, view_projection, 100.0f));
+
+    // star fields only depend on their parameters, not on the number of threads
+    star_field::parameters star_params;
+    star_params.count = 200000;
+    star_params.seed = 7;
+    star_params.chunks_per_axis = 4;
+    star_field serial_stars{star_params};
+    ThreadPool star_pool{4};
+    star_field parallel_stars{star_params, &star_pool};
+    assert(serial_stars.stars().size() == star_params.count);
+    assert(std::memcmp(serial_stars.stars().data(), parallel_stars.stars().data(),
+                       sizeof(star) * star_params.count) == 0);
+    std::size_t chunked = 0;
+    for (star_chunk const &chunk : serial_stars.chunks()) {
+        assert(chunk.first == GLint(chunked));
+        chunked += std::size_t(chunk.count);
+        for (GLint i = chunk.first; i < chunk.first + chunk.count; ++i) {
+            star const &current = serial_stars.stars()[std::size_t(i)];
+            assert(glm::length(current.position - glm::vec3(chunk.bounds)) <= chunk.bounds.w + 1e-3f);
+            assert(i == chunk.first || serial_stars.stars()[std::size_t(i - 1)].magnitude <= current.magnitude);
+        }
+    }
+    assert(chunked == star_params.count);
+    // from the center looking down -z, chunks behind are culled, distant ones decimated
+    std::vector<GLint> star_firsts;
+    std::vector<GLsizei> star_counts;
+    std::size_t all_stars = serial_stars.select(planes, glm::vec3{0.0f}, 1000.0f, 1.0f, star_firsts, star_counts);
+    assert(star_firsts.size() < serial_stars.chunks().size() && all_stars < star_params.count);
+    assert(serial_stars.select(planes, glm::vec3{0.0f}, 5.0f, 0.01f, star_firsts, star_counts) < all_stars);
+    assert(counter_random(1, 2) == counter_random(1, 2) && counter_random(1, 2) != counter_random(2, 2));
+
+    // post processing only runs passes for enabled effects and always ends on the screen
+    shader_loader::program_cache chain_programs;
+    post_chain chain{chain_programs, "quad.vert", "quad.frag"};
+    post_chain::effect mirror = chain.add_composite("MIRROR");
+    post_chain::effect grey = chain.add_composite("GREY");
+    post_chain::effect blurred = chain.add_separable("blur.frag");
+    assert(!chain.active() && chain.plan().empty() && chain.target() == 0);
+    chain.enable(mirror, true);
+    chain.toggle(grey);
+    std::vector<post_pass> passes = chain.plan();
+    assert(passes.size() == 1 && passes[0].composite == (mirror | grey) && passes[0].target == post_pass::SCREEN);
+    chain.toggle(blurred);
+    passes = chain.plan();
+    assert(passes.size() == 3 && passes[0].horizontal && passes[0].target == post_pass::PING);
+    assert(passes[1].source == post_pass::PING && passes[1].target == post_pass::SCENE);
+    assert(passes[2].separable == post_chain::npos && passes[2].source == post_pass::SCENE);
+    chain.enable(mirror, false);
+    chain.enable(grey, false);
+    passes = chain.plan();
+    assert(passes.size() == 2 && passes[1].target == post_pass::SCREEN && chain.enabled(blurred));
+
+    // program variants are keyed by the hash of their sources, which depends on the stage of each source
+    std::map<GLenum, std::string> sources{{GL_VERTEX_SHADER, "void main() {}"}};
+    std::map<GLenum, std::string> swapped{{GL_FRAGMENT_SHADER, "void main() {}"}};
+    assert(shader_loader::hash(sources) == shader_loader::hash(sources));
+    assert(shader_loader::hash(sources) != shader_loader::hash(swapped));
+    sources[GL_FRAGMENT_SHADER] = "";
+    assert(shader_loader::hash(sources) != shader_loader::hash({{GL_VERTEX_SHADER, "void main() {}"}}));
+    // binaries are keyed by chaining the hashes of sources, defines and driver
+    assert(shader_loader::hash("ab") == shader_loader::hash("b", shader_loader::hash("a")));
+    assert(shader_loader::hash("CEL_SHADING\n", 1) != shader_loader::hash("CEL_SHADING\n", 2));
+    shader_loader::program_cache programs;
+    assert(programs.size() == 0 && programs.sweep() == 0);
+
+    // concurrent writers of one file each replace it as a whole
+    ThreadPool writer_pool{4};
+    writer_pool.run(16, [](std::size_t i) {
+        std::string content(1000 + i * 100, char('a' + i));
+        assert(replace_file("tests_replaced.bin", content.data(), content.size()));
+    });
+    {
+        mapped_file replaced{"tests_replaced.bin"};
+        std::size_t writer = std::size_t(replaced.data()[0] - 'a');
+        assert(replaced.size() == 1000 + writer * 100);
+        char const *end = replaced.data() + replaced.size();
+        assert(std::count(replaced.data(), end, replaced.data()[0]) == std::ptrdiff_t(replaced.size()));
+    }
+    std::remove("tests_replaced.bin");
+
+    // binary meshes keep the layout, bounds and data of the model and are mapped again unchanged
+    model mesh_model = sphere_lod::icosphere(1);
+    mesh_file in_memory{mesh_model, model::NORMAL | model::TEXCOORD, 7, 11};
+    assert(in_memory.write("tests_mesh.mesh"));
+    {
+        mesh_file mapped{"tests_mesh.mesh"};
+        assert(mapped.matches(model::NORMAL | model::TEXCOORD, 7, 11) && !mapped.matches(model::NORMAL, 7, 11));
+        assert(mapped.vertex_num() == mesh_model.vertex_num && mapped.index_num() == mesh_model.indices.size());
+        assert(mapped.vertex_bytes() == mesh_model.vertex_bytes && mapped.attributes() == in_memory.attributes());
+        assert(mapped.offset(model::TEXCOORD) == mesh_model.offsets[model::TEXCOORD]);
+        assert(mapped.offset(model::BITANGENT) == nullptr && mapped.bounding_sphere() == mesh_model.bounding_sphere);
+        assert(std::memcmp(mapped.vertices(), mesh_model.data.data(), mesh_model.data.size() * sizeof(float)) == 0);
+        assert(std::equal(mesh_model.indices.begin(), mesh_model.indices.end(), mapped.indices()));
+        mesh_file moved{std::move(mapped)};
+        assert(mapped.vertices() == nullptr && moved.to_model().data == mesh_model.data);
+    }
+    // truncated files are rejected
+    {
+        std::ifstream complete{"tests_mesh.mesh", std::ios::binary};
+        std::string bytes{std::istreambuf_iterator<char>{complete}, std::istreambuf_iterator<char>{}};
+        complete.close();
+        std::ofstream truncated{"tests_mesh.mesh", std::ios::binary | std::ios::trunc};
+        truncated.write(bytes.data(), 300);
+    }
+    bool rejected = false;
+    try {
+        mesh_file broken{"tests_mesh.mesh"};
+    }
+    catch (std::logic_error &) {
+        rejected = true;
+    }
+    assert(rejected);
+    std::remove("tests_mesh.mesh");
+
+    // packed encodings round to the nearest representable value
+    assert(vertex_quantization::unpack_half(vertex_quantization::pack_half(0.5f)) == 0.5f);
+    assert(vertex_quantization::unpack_half(vertex_quantization::pack_half(-2.25f)) == -2.25f);
+    assert(vertex_quantization::unpack_half(vertex_quantization::pack_half(65504.0f)) == 65504.0f);
+    assert(std::isinf(vertex_quantization::unpack_half(vertex_quantization::pack_half(1e6f))));
+    assert(std::abs(vertex_quantization::unpack_half(vertex_quantization::pack_half(0.1f)) - 0.1f) < 5e-5f);
+    assert(std::abs(vertex_quantization::unpack_half(vertex_quantization::pack_half(1e-6f)) - 1e-6f) < 3e-8f);
+    glm::fvec4 direction{-1.0f, 0.5f, 2.0f, -1.0f};
+    direction = vertex_quantization::unpack_snorm(vertex_quantization::pack_snorm(direction));
+    assert(direction.x == -1.0f && std::abs(direction.y - 0.5f) < 1.0f / 511.0f && direction.z == 1.0f);
+    assert(direction.w == -1.0f);
+
+    // packed vertices take half the bytes and decode within the precision of their encodings
+    model float_mesh = sphere_lod::icosphere(2);
+    model packed_mesh = vertex_quantization::pack(float_mesh);
+    assert(packed_mesh.packed && packed_mesh.vertex_bytes == 20 && float_mesh.vertex_bytes == 48);
+    assert(packed_mesh.layout(model::NORMAL).type == GL_INT_2_10_10_10_REV);
+    assert(packed_mesh.layout(model::TEXCOORD).type == GL_HALF_FLOAT && packed_mesh.offsets[model::TEXCOORD] == (GLvoid *) 12);
+    assert(packed_mesh.vertex_num == float_mesh.vertex_num && packed_mesh.indices == float_mesh.indices);
+    assert(packed_mesh.bounding_sphere == float_mesh.bounding_sphere);
+    model unpacked_mesh = vertex_quantization::unpack(packed_mesh);
+    assert(!unpacked_mesh.packed && unpacked_mesh.data.size() == float_mesh.data.size());
+    for (std::size_t i = 0; i < float_mesh.data.size(); ++i) {
+        // position, normal, texture coordinate and tangent of 12 floats, the sign of the tangent is exact
+        std::size_t component = i % 12;
+        float tolerance = component < 3 ? 2.0f / 65535.0f : component < 6 ? 1.0f / 511.0f : component < 8 ? 1.0f / 2048.0f
+                        : component < 11 ? 1.0f / 511.0f : 0.0f;
+        assert(std::abs(unpacked_mesh.data[i] - float_mesh.data[i]) <= tolerance);
+    }
+    // mesh files keep the encoding and the dequantization
+    mesh_file packed_file{packed_mesh, model::NORMAL | model::TEXCOORD};
+    assert(packed_file.write("tests_packed.mesh"));
+    {
+        mesh_file mapped{"tests_packed.mesh"};
+        assert(mapped.packed() && mapped.vertex_bytes() == 20 && mapped.layout(model::POSITION).normalized);
+        assert(mapped.position_scale() == packed_mesh.position_scale);
+        assert(mapped.position_offset() == packed_mesh.position_offset);
+        model restored = mapped.to_model();
+        // packed words may look like nan as floats, so the bytes are compared
+        assert(restored.packed && restored.data.size() == packed_mesh.data.size() && restored.offsets == packed_mesh.offsets);
+        assert(std::memcmp(restored.data.data(), packed_mesh.data.data(), packed_mesh.data.size() * sizeof(float)) == 0);
+        assert(restored.bounding_sphere == packed_mesh.bounding_sphere);
+    }
+    // headers with another normalization or with offsets outside the vertex are rejected, the layout entries
+    // of flag, components, type, offset and normalization follow the magic, version and attribute flags
+    std::string packed_bytes;
+    {
+        std::ifstream complete{"tests_packed.mesh", std::ios::binary};
+        packed_bytes.assign(std::istreambuf_iterator<char>{complete}, std::istreambuf_iterator<char>{});
+    }
+    for (std::size_t field : {std::size_t(16 + 4 * 4), std::size_t(16 + 20 + 3 * 4)}) {
+        std::string corrupted = packed_bytes;
+        std::uint32_t value = 0;
+        std::memcpy(&value, &corrupted[field], sizeof(value));
+        value = value == 0 ? 1u : 1000u;
+        std::memcpy(&corrupted[field], &value, sizeof(value));
+        {
+            std::ofstream out{"tests_packed.mesh", std::ios::binary | std::ios::trunc};
+            out.write(corrupted.data(), std::streamsize(corrupted.size()));
+        }
+        rejected = false;
+        try {
+            mesh_file broken{"tests_packed.mesh"};
+        }
+        catch (std::logic_error &) {
+            rejected = true;
+        }
+        assert(rejected);
+    }
+    // a vertex offset which wraps the end of the vertices around is rejected as well, it follows the
+    // layout of 8 entries, the vertex size, the attribute number and the vertex and index numbers
+    {
+        std::string corrupted = packed_bytes;
+        std::uint64_t vertex_blob = packed_mesh.vertex_num * std::uint64_t(packed_mesh.vertex_bytes);
+        std::uint64_t wrapped = (std::uint64_t(0) - vertex_blob + 256) & ~std::uint64_t(15);
+        std::memcpy(&corrupted[200], &wrapped, sizeof(wrapped));
+        std::ofstream out{"tests_packed.mesh", std::ios::binary | std::ios::trunc};
+        out.write(corrupted.data(), std::streamsize(corrupted.size()));
+    }
+    rejected = false;
+    try {
+        mesh_file broken{"tests_packed.mesh"};
+    }
+    catch (std::logic_error &) {
+        rejected = true;
+    }
+    assert(rejected);
+    std::remove("tests_packed.mesh");
+
+    // tangents point towards increasing u, the sign tells whether the uv mapping is mirrored
+    std::vector<glm::fvec3> quad_positions{{0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 0.0f}, {0.0f, 1.0f, 0.0f}};
+    std::vector<GLuint> quad_indices{0, 1, 2, 0, 2, 3};
+    std::vector<glm::fvec3> quad_normals = tangent_space::normals(quad_positions, quad_indices);
+    for (glm::fvec3 const &normal : quad_normals)
+        assert(normal == glm::fvec3(0.0f, 0.0f, 1.0f));
+    std::vector<glm::fvec2> quad_texcoords{{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}};
+    for (glm::fvec4 const &tangent : tangent_space::tangents(quad_positions, quad_normals, quad_texcoords, quad_indices))
+        assert(tangent == glm::fvec4(1.0f, 0.0f, 0.0f, 1.0f));
+    std::vector<glm::fvec2> mirrored{{1.0f, 0.0f}, {0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 1.0f}};
+    for (glm::fvec4 const &tangent : tangent_space::tangents(quad_positions, quad_normals, mirrored, quad_indices))
+        assert(tangent == glm::fvec4(-1.0f, 0.0f, 0.0f, -1.0f));
+    // faces without uv area still get a tangent orthogonal to the normal
+    std::vector<glm::fvec2> collapsed(4, glm::fvec2{0.5f});
+    for (glm::fvec4 const &tangent : tangent_space::tangents(quad_positions, quad_normals, collapsed, quad_indices))
+        assert(glm::dot(glm::fvec3(tangent), glm::fvec3(0.0f, 0.0f, 1.0f)) == 0.0f && tangent.w == 1.0f);
+
+    // sphere frames are orthonormal and the same for every pool size and instruction set
+    model frame_sphere = sphere_lod::icosphere(6);
+    std::vector<glm::fvec3> sphere_positions(frame_sphere.vertex_num);
+    std::vector<glm::fvec2> sphere_texcoords(frame_sphere.vertex_num);
+    for (std::size_t i = 0; i < frame_sphere.vertex_num; ++i) {
+        GLfloat const *vertex = &frame_sphere.data[i * 12];
+        sphere_positions[i] = glm::fvec3{vertex[0], vertex[1], vertex[2]};
+        sphere_texcoords[i] = glm::fvec2{vertex[6], vertex[7]};
+        glm::fvec3 tangent{vertex[8], vertex[9], vertex[10]};
+        assert(std::abs(glm::length(tangent) - 1.0f) < 1e-5f && std::abs(glm::dot(tangent, sphere_positions[i])) < 1e-5f);
+        assert(vertex[11] == 1.0f);
+    }
+    ThreadPool frame_pool{4};
+    std::vector<glm::fvec3> serial_normals = tangent_space::normals(sphere_positions, frame_sphere.indices);
+    std::vector<glm::fvec4> serial_tangents =
+        tangent_space::tangents(sphere_positions, serial_normals, sphere_texcoords, frame_sphere.indices);
+    for (int level = matrix_kernels::SCALAR; level <= supported; ++level) {
+        matrix_kernels::set_isa(matrix_kernels::isa(level));
+        for (ThreadPool *frame_threads : {static_cast<ThreadPool *>(nullptr), &frame_pool}) {
+            std::vector<glm::fvec3> normals = tangent_space::normals(sphere_positions, frame_sphere.indices, frame_threads);
+            std::vector<glm::fvec4> tangents =
+                tangent_space::tangents(sphere_positions, normals, sphere_texcoords, frame_sphere.indices, frame_threads);
+            assert(normals == serial_normals && tangents == serial_tangents);
+        }
+    }
+    rejected = false;
+    try {
+        tangent_space::normals(quad_positions, {0, 1, 4});
+    }
+    catch (std::logic_error &) {
+        rejected = true;
+    }
+    assert(rejected);
+
+    // missing normals are generated for objs, tangents are generated from them
+    {
+        std::ofstream textured{"tests_textured.obj"};
+        textured << "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nvt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nf 1/1 2/2 3/3\nf 1/1 3/3 4/4\n";
+    }
+    model textured = model_loader::obj("tests_textured.obj", model::NORMAL | model::TEXCOORD | model::TANGENT);
+    assert(textured.vertex_bytes == 48 && textured.vertex_num == 4);
+    for (std::size_t i = 0; i < textured.vertex_num; ++i) {
+        GLfloat const *vertex = &textured.data[i * 12];
+        assert(glm::fvec3(vertex[3], vertex[4], vertex[5]) == glm::fvec3(0.0f, 0.0f, 1.0f));
+        assert(glm::fvec4(vertex[8], vertex[9], vertex[10], vertex[11]) == glm::fvec4(1.0f, 0.0f, 0.0f, 1.0f));
+    }
+    std::remove("tests_textured.obj");
+
+    // objs are parsed once, later loads map the written mesh file
+    {
+        std::ofstream quad{"tests_quad.obj"};
+        quad << "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3\nf 1 3 4\n";
+    }
+    mesh_file parsed = model_loader::obj_mapped("tests_quad.obj");
+    mesh_file loaded = model_loader::obj_mapped("tests_quad.obj");
+    assert(parsed.vertex_num() == 4 && parsed.index_num() == 6);
+    assert(loaded.vertex_num() == 4 && std::memcmp(loaded.vertices(), parsed.vertices(), 4 * 3 * sizeof(float)) == 0);
+    assert(std::equal(parsed.indices(), parsed.indices() + 6, loaded.indices()));
+#ifndef _WIN32
+    // an edit of the same size within the same second still replaces the mesh file
+    timespec const times[2] = {{1000000000, 100}, {1000000000, 100}};
+    utimensat(AT_FDCWD, "tests_quad.obj", times, 0);
+    model_loader::obj_mapped("tests_quad.obj");
+    {
+        std::ofstream quad{"tests_quad.obj", std::ios::trunc};
+        quad << "v 0 0 0\nv 2 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3\nf 1 3 4\n";
+    }
+    timespec const later[2] = {{1000000000, 200}, {1000000000, 200}};
+    utimensat(AT_FDCWD, "tests_quad.obj", later, 0);
+    mesh_file edited = model_loader::obj_mapped("tests_quad.obj");
+    assert(static_cast<float const *>(edited.vertices())[3] == 2.0f);
+#endif
+    std::remove("tests_quad.obj");
+    std::remove("tests_quad.obj.mesh");
+
+    // the parallel parser gives the same model as tinyobjloader for groups, polygons, relative indices and crlf
+    {
+        std::ofstream shapes{"tests_shapes.obj", std::ios::binary};
+        shapes << "# comment\r\nv 0 0 0\r\nv 1.5 0 0\r\nv 1 1e0 0\r\nv 0 1 -0.25\r\n"
+               << "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvn 0 0 1\n"
+               << "g first\nf 1/1/1 2/2/1 3/3/1 4/4/1\nusemtl none\no second\n"
+               << "f -4/-4/-1 -2/-2/-1 -1/-1/-1\nf 1/1/1 3/3/1 4/4/1\n";
+        // large enough to be split into several chunks
+        for (int i = 0; i < 40000; ++i) {
+            shapes << "v " << i << ".001 " << -i << ".25 3.25e-2\nvt 0.5 0.5\n";
+            if (i >= 2)
+                shapes << "f -1/-1/1 -2/-2/1 -3/-3/1\n";
+            if (i % 10000 == 0)
+                shapes << "g part" << i << "\n";
+        }
+    }
+    ThreadPool obj_pool{4};
+    for (model::attrib_flag_t attributes :
+         {model::POSITION.flag, model::NORMAL | model::TEXCOORD, model::NORMAL | model::TEXCOORD | model::TANGENT}) {
+        model expected = model_loader::obj("tests_shapes.obj", attributes);
+        for (ThreadPool *parser_pool : {static_cast<ThreadPool *>(nullptr), &obj_pool}) {
+            model parsed = model_loader::obj_parallel("tests_shapes.obj", attributes, parser_pool);
+            assert(parsed.data == expected.data && parsed.indices == expected.indices);
+            assert(parsed.vertex_bytes == expected.vertex_bytes && parsed.offsets == expected.offsets);
+        }
+    }
+    std::remove("tests_shapes.obj");
+    {
+        std::ofstream missing{"tests_missing.obj"};
+        missing << "v 0 0 0\nf 1 2 3\n";
+    }
+    rejected = false;
+    try {
+        model_loader::obj_parallel("tests_missing.obj");
+    }
+    catch (std::logic_error &) {
+        rejected = true;
+    }
+    assert(rejected);
+    std::remove("tests_missing.obj");
+
+    // two triangles sharing an edge miss the cache once per vertex
+    mesh_optimizer::cache_statistics quad = mesh_optimizer::analyze({0, 1, 2, 0, 2, 3}, 4);
+    assert(quad.acmr == 2.0f && quad.atvr == 1.0f);
+    // grid with separate vertices per triangle in shuffled order, as written by exporters without indexing
+    unsigned const grid = 32;
+    std::vector<glm::uvec3> grid_triangles{};
+    for (unsigned y = 0; y < grid; ++y) {
+        for (unsigned x = 0; x < grid; ++x) {
+            unsigned a = y * (grid + 1) + x, b = a + 1, c = a + grid + 1, d = c + 1;
+            grid_triangles.push_back(glm::uvec3{a, b, d});
+            grid_triangles.push_back(glm::uvec3{a, d, c});
+        }
+    }
+    unsigned shuffle = 12345;
+    for (std::size_t i = grid_triangles.size() - 1; i > 0; --i) {
+        shuffle = shuffle * 1103515245u + 12345u;
+        std::swap(grid_triangles[i], grid_triangles[(shuffle >> 8) % (i + 1)]);
+    }
+    std::vector<GLfloat> grid_data{};
+    std::vector<GLuint> grid_indices{};
+    for (glm::uvec3 const &triangle : grid_triangles) {
+        for (int corner = 0; corner < 3; ++corner) {
+            grid_indices.push_back(GLuint(grid_indices.size()));
+            grid_data.push_back(float(triangle[corner] % (grid + 1)));
+            grid_data.push_back(float(triangle[corner] / (grid + 1)));
+            grid_data.push_back(0.0f);
+        }
+    }
+    model unindexed{grid_data, model::POSITION, grid_indices};
+    std::vector<GLuint> distinct_remap{};
+    assert(mesh_optimizer::deduplicate(unindexed.data, unindexed.vertex_num, distinct_remap) == (grid + 1) * (grid + 1));
+    assert(distinct_remap[0] == 0 && distinct_remap[1] == 1 && distinct_remap[2] == 2);
+
+    mesh_optimizer::report optimization{};
+    model optimized = mesh_optimizer::optimize(unindexed, &optimization);
+    assert(optimization.vertices_before == unindexed.vertex_num);
+    assert(optimized.vertex_num == (grid + 1) * (grid + 1) && optimization.vertices_after == optimized.vertex_num);
+    assert(optimization.before.acmr == 3.0f && optimization.after.acmr < 1.0f);
+    assert(optimization.after.acmr <= mesh_optimizer::analyze(optimized.indices, optimized.vertex_num).acmr);
+    // same triangles with the same winding, identified by the positions of their corners
+    auto triangle_set = [](model const &mesh) {
+        std::vector<std::vector<GLfloat>> triangles{};
+        for (std::size_t t = 0; t < mesh.indices.size(); t += 3) {
+            std::vector<std::vector<GLfloat>> corners{};
+            for (std::size_t corner = 0; corner < 3; ++corner) {
+                GLfloat const *vertex = mesh.data.data() + mesh.indices[t + corner] * 3;
+                corners.push_back(std::vector<GLfloat>{vertex, vertex + 3});
+            }
+            // rotate the smallest corner to the front, which keeps the winding
+            std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+            triangles.push_back(std::vector<GLfloat>{});
+            for (auto const &corner : corners)
+                triangles.back().insert(triangles.back().end(), corner.begin(), corner.end());
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    };
+    assert(triangle_set(optimized) == triangle_set(unindexed));
+    // vertices are stored in order of their first use
+    GLuint next_vertex = 0;
+    for (GLuint index : optimized.indices) {
+        assert(index <= next_vertex);
+        if (index == next_vertex)
+            ++next_vertex;
+    }
+    // dead ends restart from the best remaining triangle instead of the next one in input order,
+    // the separate triangles after the shuffled grid have the fewest remaining neighbors and come first
+    std::vector<GLuint> soup_indices{};
+    for (glm::uvec3 const &triangle : grid_triangles)
+        soup_indices.insert(soup_indices.end(), {triangle.x, triangle.y, triangle.z});
+    GLuint const grid_vertices = (grid + 1) * (grid + 1);
+    for (GLuint i = 0; i < 4; ++i)
+        soup_indices.insert(soup_indices.end(), {grid_vertices + i * 3, grid_vertices + i * 3 + 1, grid_vertices + i * 3 + 2});
+    std::vector<GLuint> soup_order = mesh_optimizer::optimize_cache(soup_indices, grid_vertices + 12);
+    for (GLuint i = 0; i < 12; ++i)
+        assert(soup_order[i] == grid_vertices + i);
+    assert(mesh_optimizer::analyze(soup_order, grid_vertices + 12).acmr < 1.0f);
+    // unreferenced vertices are removed by the fetch remap
+    std::vector<GLuint> fetch_remap{};
+    assert(mesh_optimizer::optimize_fetch({2, 3, 2}, 4, fetch_remap) == 2);
+    assert(fetch_remap[0] == mesh_optimizer::removed && fetch_remap[2] == 0 && fetch_remap[3] == 1);
+
     int c = 2;
 }
\ No newline at end of file
@@ -0,0 +1,24 @@
+#version 150
+// one direction of a separable gaussian blur, compiled with HORIZONTAL or VERTICAL
+// both passes together give the 3x3 kernel 1/16 * (1 2 1)^T (1 2 1)
+
+in vec2 pass_TexCoord;
+
+out vec4 out_Color;
+
+uniform sampler2D screenTexture;
+
+uniform vec2 textureSize;
+
+void main() {
+#ifdef HORIZONTAL
+    vec2 step = vec2(1.0 / textureSize.x, 0.0);
+#else
+    vec2 step = vec2(0.0, 1.0 / textureSize.y);
+#endif
+
+    vec3 color = texture(screenTexture, pass_TexCoord - step).rgb * 0.25
+               + texture(screenTexture, pass_TexCoord).rgb * 0.5
+               + texture(screenTexture, pass_TexCoord + step).rgb * 0.25;
+    out_Color = vec4(color, 1.0);
+}
@@ -0,0 +1,12 @@
+// values shared by all programs, written once per frame
+// std140 layout mirrored by frame_data in structs.hpp
+layout(std140) uniform FrameData {
+    mat4 ViewMatrix;
+    mat4 ProjectionMatrix;
+    // world space
+    vec4 LightPosition;
+    // rgb color, intensity in a
+    vec4 LightColor;
+    vec2 ViewportSize;
+    float Time;
+};
@@ -2,12 +2,20 @@
 #extension GL_ARB_explicit_attrib_location : require
 // glVertexAttribPointer mapped positions to first
 layout(location = 0) in vec3 in_Position;
+// index of the orbit the vertex belongs to
+layout(location = 1) in int in_Orbit;
 
-//Matrix Uniforms uploaded with glUniform*
-uniform mat4 ViewMatrix;
-uniform mat4 ModelMatrix;
-uniform mat4 ProjectionMatrix;
+// ViewMatrix and ProjectionMatrix
+#include "frame_data.glsl"
+
+// model matrices of all orbits, four texels per matrix
+uniform samplerBuffer ModelMatrices;
 
 void main() {
+    int base = in_Orbit * 4;
+    mat4 ModelMatrix = mat4(texelFetch(ModelMatrices, base),
+                            texelFetch(ModelMatrices, base + 1),
+                            texelFetch(ModelMatrices, base + 2),
+                            texelFetch(ModelMatrices, base + 3));
     gl_Position = (ProjectionMatrix  * ViewMatrix * ModelMatrix) * vec4(in_Position, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,24 @@
+// per instance data written by ApplicationSolar::updatePlanets(), nine texels per planet
+// mirrors planet_instance in application_solar.hpp
+uniform samplerBuffer Instances;
+// instance of the current batch with gl_InstanceID 0
+uniform int FirstInstance;
+
+mat4 fetch_matrix(int texel) {
+    return mat4(texelFetch(Instances, texel),
+                texelFetch(Instances, texel + 1),
+                texelFetch(Instances, texel + 2),
+                texelFetch(Instances, texel + 3));
+}
+
+void fetch_instance(out mat4 model_matrix, out mat4 normal_matrix, out int material, out float ambient_intensity,
+                    out vec2 texture_layers) {
+    int base = (FirstInstance + gl_InstanceID) * 9;
+    model_matrix = fetch_matrix(base);
+    normal_matrix = fetch_matrix(base + 4);
+    vec4 parameters = texelFetch(Instances, base + 8);
+    material = int(parameters.x);
+    ambient_intensity = parameters.y;
+    // layers of texture and normal map in their arrays
+    texture_layers = parameters.zw;
+}
@@ -1,25 +1,35 @@
 #version 150
-#extension GL_OES_standard_derivatives : enable
+// light data
+#include "frame_data.glsl"
 
 in vec3 pass_Normal, pass_Position, pass_Camera_Position;
+flat in int pass_Material;
+in float pass_AmbientIntensity;
 in mat4 pass_ViewMatrix, pass_ModelMatrix, pass_NormalMatrix;
+#ifndef CEL_SHADING
 in vec2 pass_TexCoord;
+in vec4 pass_Tangent;
+flat in vec2 pass_TextureLayers;
+#endif
 
 out vec4 out_Color;
 
-uniform sampler2D TextureSampler;
-uniform sampler2D NormalSampler;
-uniform vec3 planet_color;
-uniform vec3 light_color;
-uniform vec3 light_position;
-uniform float light_intensity;
-uniform float ambient_intensity;
+#ifndef CEL_SHADING
+// textures of all planets, layer per instance
+uniform sampler2DArray TextureSampler;
+uniform sampler2DArray NormalSampler;
+#endif
+// material colors indexed by pass_Material
+uniform vec3 MaterialColors[64];
 
 void main() {
+#ifdef CEL_SHADING
+  vec3 normal = normalize(pass_Normal);
+#else
   //get current diffuse color
-  vec4 planetTexture = texture(TextureSampler, pass_TexCoord);
+  vec4 planetTexture = texture(TextureSampler, vec3(pass_TexCoord, pass_TextureLayers.x));
   // get current normal from normal map
-  vec4 normalTexture = texture(NormalSampler, pass_TexCoord);
+  vec4 normalTexture = texture(NormalSampler, vec3(pass_TexCoord, pass_TextureLayers.y));
 
   //define scale of normals
   float normalScale = 5.0;
@@ -30,26 +40,16 @@ void main() {
   // multiply with a scaling factor
   mapN.xy = normalScale * mapN.xy;
 
-  vec3 normal = normalize(pass_Normal);
-  vec3 vertex_pos = pass_Position;
-
-  //calculate the difference in x and y direction on the vertex
-  vec3 q0 = dFdx(vertex_pos.xyz);
-  vec3 q1 = dFdy(vertex_pos.xyz);
-
-  //calculates the difference in x and y direction on the uv plane
-  vec2 st0 = dFdx(pass_TexCoord.st);
-  vec2 st1 = dFdy(pass_TexCoord.st);
-
-  // direct tangent calculation using the matrix equation explained here: https://learnopengl.com/Advanced-Lighting/Normal-Mapping
-  vec3 S = normalize(vec3(pass_NormalMatrix * vec4(normalize(q0 * st1.t - q1 * st0.t), 0.0)));
-  // direct bitangent calculation
-  vec3 T = normalize(vec3(pass_NormalMatrix * vec4(normalize(-q0 * st1.s + q1 * st0.s), 0.0)));
   // normal
-  vec3 N = normalize(normal);
+  vec3 N = normalize(pass_Normal);
+  // tangent generated at load time, orthogonalized again after the interpolation
+  vec3 S = normalize(pass_Tangent.xyz - N * dot(N, pass_Tangent.xyz));
+  // bitangent from the sign, which only mixes between mirrored faces
+  vec3 T = (pass_Tangent.w < 0.0 ? -1.0 : 1.0) * cross(N, S);
 
   mat3 tsn = mat3(S, T, N);
-  normal = normalize(tsn * mapN);
+  vec3 normal = normalize(tsn * mapN);
+#endif
 
 
   vec3 specular_color = vec3(1.0, 1.0, 1.0);
@@ -57,23 +57,50 @@ void main() {
   float diffuse_reflection_factor = 0.9;
   float specular_reflection_factor = 0.4;
   int n = 10;
+#ifdef CEL_SHADING
+  vec4 outline_color = vec4(1.0, 1.0, 1.0, 1.0);
+  float outline_thickness = 0.3;
+#endif
 
   vec3 camera_Position = pass_Camera_Position;
 
-  vec3 transformed_light_position = (pass_ViewMatrix * vec4(light_position, 1.0)).xyz;
+  vec3 transformed_light_position = (pass_ViewMatrix * LightPosition).xyz;
 
   vec3 light_Direction = normalize(transformed_light_position - pass_Position);
+#ifdef CEL_SHADING
+  vec3 view_Direction = normalize(camera_Position - pass_Position);
+#else
   vec3 view_Direction = normalize(-pass_Position);
+#endif
   vec3 h = normalize(view_Direction + light_Direction);
 
-  float diffuse_light_intensity = light_intensity * diffuse_reflection_factor * max(dot(normal, light_Direction), 0);
-  float specular_light_intensity = light_intensity * specular_reflection_factor * pow(max(dot(h, normal), 0), n);
+  float diffuse_light_intensity = LightColor.a * diffuse_reflection_factor * max(dot(normal, light_Direction), 0);
+  float specular_light_intensity = LightColor.a * specular_reflection_factor * pow(max(dot(h, normal), 0), n);
 
-  vec3 ambient = ambient_intensity * light_color;
-  vec3 diffuse = diffuse_light_intensity * light_color;
+  vec3 ambient = pass_AmbientIntensity * LightColor.rgb;
+  vec3 diffuse = diffuse_light_intensity * LightColor.rgb;
   vec3 specular =  specular_light_intensity * specular_color;
 
-  //out_Color = vec4((ambient + diffuse) * planet_color + specular * light_color,1.0);
-  out_Color = vec4((ambient + diffuse) * planetTexture.rgb + specular * light_color, 1.0);
+#ifdef CEL_SHADING
+  // outline at silhouettes, otherwise quantized diffuse light
+  if (abs(dot(normal, view_Direction)) < outline_thickness) {
+    out_Color = outline_color;
+  }
+  else {
+    if (diffuse_light_intensity > 0.95)
+      diffuse = 1.0 * LightColor.rgb;
+    else if (diffuse_light_intensity > 0.6)
+      diffuse = 0.7 * LightColor.rgb;
+    else if (diffuse_light_intensity > 0.2)
+      diffuse = 0.35 * LightColor.rgb;
+    else
+      diffuse = 0.1 * LightColor.rgb;
+
+    out_Color = vec4((ambient + diffuse) * MaterialColors[pass_Material], 1.0);
+  }
+#else
+  //out_Color = vec4((ambient + diffuse) * MaterialColors[pass_Material] + specular * LightColor.rgb,1.0);
+  out_Color = vec4((ambient + diffuse) * planetTexture.rgb + specular * LightColor.rgb, 1.0);
+#endif
 
 }
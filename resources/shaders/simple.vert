@@ -3,27 +3,51 @@
 // vertex attributes of VAO
 layout(location = 0) in vec3 in_Position;
 layout(location = 1) in vec3 in_Normal;
+#ifndef CEL_SHADING
 layout(location = 2) in vec2 in_TexCoord;
+// direction of increasing u, sign of the bitangent in w
+layout(location = 3) in vec4 in_Tangent;
+#endif
 
 
-//Matrix Uniforms as specified with glUniformMatrix4fv
-uniform mat4 ModelMatrix;
-uniform mat4 ViewMatrix;
-uniform mat4 ProjectionMatrix;
-uniform mat4 NormalMatrix;
+// ViewMatrix and ProjectionMatrix
+#include "frame_data.glsl"
+
+// model and normal matrix, material and ambient intensity of the instance
+#include "planet_instance.glsl"
+
+// positions are packed to [0, 1] in the bounds of the model, see vertex_quantization
+uniform vec3 PositionScale;
+uniform vec3 PositionOffset;
 
 out vec3 pass_Normal, pass_Position, pass_Camera_Position;
 out mat4 pass_ViewMatrix, pass_ModelMatrix, pass_NormalMatrix;
+flat out int pass_Material;
+out float pass_AmbientIntensity;
+#ifdef CEL_SHADING
+// cel shading is untextured
+vec2 pass_TextureLayers;
+#else
 out vec2 pass_TexCoord;
+out vec4 pass_Tangent;
+flat out vec2 pass_TextureLayers;
+#endif
 
 void main(void)
 {
-	gl_Position = (ProjectionMatrix  * ViewMatrix * ModelMatrix) * vec4(in_Position, 1.0);
+	mat4 ModelMatrix, NormalMatrix;
+	fetch_instance(ModelMatrix, NormalMatrix, pass_Material, pass_AmbientIntensity, pass_TextureLayers);
+	vec3 Position = PositionOffset + PositionScale * in_Position;
+
+	gl_Position = (ProjectionMatrix  * ViewMatrix * ModelMatrix) * vec4(Position, 1.0);
 	pass_Camera_Position = (inverse(transpose(ViewMatrix)) * vec4(0.0, 0.0, 0.0, 1.0)).xyz;
-	pass_Position = ((ViewMatrix * ModelMatrix) * vec4(in_Position, 1.0)).xyz;
+	pass_Position = ((ViewMatrix * ModelMatrix) * vec4(Position, 1.0)).xyz;
 	pass_ModelMatrix = ModelMatrix;
 	pass_ViewMatrix = ViewMatrix;
 	pass_Normal = mat3(NormalMatrix) * in_Normal;
 	pass_NormalMatrix = NormalMatrix;
+#ifndef CEL_SHADING
 	pass_TexCoord = in_TexCoord;
+	pass_Tangent = vec4(mat3(NormalMatrix) * in_Tangent.xyz, in_Tangent.w);
+#endif
 }
@@ -6,8 +6,8 @@
 
 layout(location = 0) in vec4 in_Position;
 
-uniform mat4 ProjectionMatrix;
-uniform mat4 ViewMatrix;
+// ViewMatrix and ProjectionMatrix
+#include "frame_data.glsl"
 
 out vec3 camDirection;
 
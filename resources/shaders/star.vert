@@ -0,0 +1,21 @@
+#version 150
+#extension GL_ARB_explicit_attrib_location : require
+// glVertexAttribPointer mapped positions to first
+layout(location = 0) in vec3 in_Position;
+// glVertexAttribPointer mapped color  to second attribute 
+layout(location = 1) in vec3 in_Color;
+// apparent magnitude, smaller is brighter
+layout(location = 2) in float in_Magnitude;
+
+// stars are placed in world space, ViewMatrix and ProjectionMatrix
+#include "frame_data.glsl"
+
+out vec3 pass_Color;
+
+void main() {
+	gl_Position = ProjectionMatrix * ViewMatrix * vec4(in_Position, 1.0);
+	// brightness ratio of 2.512 per magnitude, bright stars grow, faint ones fade
+	float brightness = pow(10.0, -0.4 * in_Magnitude);
+	gl_PointSize = clamp(2.0 * sqrt(brightness), 1.0, 4.0);
+	pass_Color = in_Color * clamp(brightness * 8.0, 0.15, 1.0);
+}
\ No newline at end of file